@@ -3,7 +3,7 @@
 
 class Alarm {
 public:
-    enum class Mode {
+    enum class Mode : uint8_t {
         OFF,
         EMERGENCY
     };
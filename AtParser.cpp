@@ -0,0 +1,104 @@
+#include "AtParser.h"
+#include <avr/pgmspace.h>
+
+// Line prefixes, matched from the first byte of a line
+static const char _patOk[] PROGMEM = "OK";
+static const char _patError[] PROGMEM = "ERROR";
+static const char _patCmeError[] PROGMEM = "+CME ERROR";
+static const char _patCmsError[] PROGMEM = "+CMS ERROR";
+static const char _patCmgs[] PROGMEM = "+CMGS:";
+static const char _patClip[] PROGMEM = "+CLIP:";
+static const char _patCmt[] PROGMEM = "+CMT:";
+static const char _patCreg[] PROGMEM = "+CREG:";
+static const char _patRing[] PROGMEM = "RING";
+static const char _patNoCarrier[] PROGMEM = "NO CARRIER";
+static const char _patBusy[] PROGMEM = "BUSY";
+static const char _patNoAnswer[] PROGMEM = "NO ANSWER";
+
+static const char* const _patterns[] PROGMEM = {
+    _patOk, _patError, _patCmeError, _patCmsError, _patCmgs, _patClip,
+    _patCmt, _patCreg, _patRing, _patNoCarrier, _patBusy, _patNoAnswer
+};
+
+static const AtParser::Token _tokens[] PROGMEM = {
+    AtParser::Token::OK, AtParser::Token::ERROR, AtParser::Token::ERROR,
+    AtParser::Token::ERROR, AtParser::Token::CMGS, AtParser::Token::CLIP,
+    AtParser::Token::CMT, AtParser::Token::CREG, AtParser::Token::RING,
+    AtParser::Token::CALL_END, AtParser::Token::CALL_END, AtParser::Token::CALL_END
+};
+
+static constexpr uint8_t PATTERN_COUNT = sizeof(_patterns) / sizeof(_patterns[0]);
+static constexpr uint16_t ALL_PATTERNS = (1U << PATTERN_COUNT) - 1;
+static constexpr uint8_t NO_MATCH = 0xFF;
+
+// Patterns that must be the whole line: OK, ERROR, RING, NO CARRIER, BUSY, NO ANSWER
+static constexpr uint16_t EXACT_PATTERNS = 0x0F03;
+
+AtParser::Token AtParser::feed(char c) {
+    if(c == '\r' || c == '\n') {
+        return _inLine ? _endLine() : Token::NONE;
+    }
+
+    if(!_inLine) {
+        if(_skipSpace && c == ' ') {
+            _skipSpace = false;
+            return Token::NONE;
+        }
+        _skipSpace = false;
+        if(c == '>' && _promptEnabled) {
+            // "> " has no line terminator
+            _skipSpace = true;
+            return Token::PROMPT;
+        }
+        _inLine = true;
+        _col = 0;
+        _candidates = ALL_PATTERNS;
+        _matched = NO_MATCH;
+    }
+
+    if(_col < LINE_SIZE - 1) _line[_col] = c;
+
+    // A whole-line pattern followed by more text is just a line
+    if(_matched != NO_MATCH && (EXACT_PATTERNS & (1U << _matched))) {
+        _matched = NO_MATCH;
+    }
+
+    for(uint8_t i = 0; _candidates >> i; i++) {
+        if(!(_candidates & (1U << i))) continue;
+        const char* pattern = (const char*)pgm_read_ptr(&_patterns[i]);
+        if(pgm_read_byte(pattern + _col) != c) {
+            _candidates &= ~(1U << i);
+        } else if(pgm_read_byte(pattern + _col + 1) == '\0') {
+            _matched = i;
+            _candidates &= ~(1U << i);
+        }
+    }
+
+    if(_col < 0xFF) _col++;
+    return Token::NONE;
+}
+
+void AtParser::reset() {
+    _inLine = false;
+    _skipSpace = false;
+    _lineLen = 0;
+    _candidates = 0;
+    _matched = NO_MATCH;
+}
+
+uint8_t AtParser::getLine(char* buffer, uint8_t size) const {
+    if(!size) return 0;
+    uint8_t len = min(_lineLen, (uint8_t)(size - 1));
+    memcpy(buffer, _line, len);
+    buffer[len] = '\0';
+    return len;
+}
+
+AtParser::Token AtParser::_endLine() {
+    _inLine = false;
+    _truncated = _col >= LINE_SIZE;
+    _lineLen = _truncated ? LINE_SIZE - 1 : _col;
+
+    if(_matched == NO_MATCH) return Token::LINE;
+    return static_cast<Token>(pgm_read_byte(&_tokens[_matched]));
+}
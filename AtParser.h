@@ -0,0 +1,53 @@
+#ifndef AT_PARSER_H
+#define AT_PARSER_H
+
+#include <Arduino.h>
+
+// Streaming AT response parser. Bytes are fed one at a time; every known
+// line prefix has its own match position, so classification costs a fixed
+// number of compares per byte and the token is known when the line ends.
+// The start of the line is kept in a fixed buffer, no heap is used.
+class AtParser {
+public:
+    enum class Token : uint8_t {
+        NONE,       // line not complete yet
+        OK,
+        ERROR,      // ERROR, +CME ERROR, +CMS ERROR
+        PROMPT,     // "> " of AT+CMGS, reported on the '>' itself
+        CMGS,       // +CMGS: <mr>
+        CLIP,       // +CLIP: "<number>",...
+        CMT,        // +CMT: "<number>",...; text follows on the next line
+        CREG,       // +CREG: ...
+        RING,
+        CALL_END,   // NO CARRIER, BUSY, NO ANSWER
+        LINE        // any other non-empty line
+    };
+
+    // Enough for the number in a +CMT/+CLIP header and for an SMS command
+    static constexpr uint8_t LINE_SIZE = 32;
+
+    Token feed(char c);
+    void reset();
+    void expectPrompt(bool enable) { _promptEnabled = enable; }
+
+    // Last completed line; returns its length. Valid until the next line
+    // starts; longer lines keep their first LINE_SIZE - 1 bytes.
+    uint8_t getLine(char* buffer, uint8_t size) const;
+    uint8_t getLineLength() const { return _lineLen; }
+    bool isTruncated() const { return _truncated; }
+
+private:
+    char _line[LINE_SIZE];
+    uint8_t _col = 0;           // bytes in the current line (saturating)
+    uint8_t _lineLen = 0;       // length of the last completed line
+    uint16_t _candidates = 0;   // patterns still matching the current line
+    uint8_t _matched = 0xFF;    // pattern whose text has fully matched
+    bool _inLine = false;
+    bool _truncated = false;
+    bool _promptEnabled = false;
+    bool _skipSpace = false;
+
+    Token _endLine();
+};
+
+#endif
@@ -6,7 +6,7 @@
   
 class Buzzer {
 public:
-    enum class PlayMode {
+    enum class PlayMode : uint8_t {
         SINGLE,
         REPEAT
     };
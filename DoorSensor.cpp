@@ -21,37 +21,57 @@ bool DoorSensor::readSensor() {
     bool interpreted = (_sensorType == SensorType::NORMALLY_OPEN) ? !reading : reading;
 
     if (reading != _lastRawReading) {
-        _lastDebounceTime = millis() / 1000;
+        _lastDebounceTime = millis();
     }
     _lastRawReading = reading;
 
-    if ((millis()/1000 - _lastDebounceTime) > (_debounceDelay/1000)) {
+    if (millis() - _lastDebounceTime > _debounceDelay) {
         return interpreted;
     }
     return _state;
-	
-	if (millis()/1000 < _lastDebounceTime) { // Произошло переполнение
-    _lastDebounceTime = 0;
-}
 }
 
 DoorSensor::StateChange DoorSensor::update() {
-    bool newState = readSensor();
-
-    if (newState != _state) {
-        StateChange change = newState ? StateChange::OPENED : StateChange::CLOSED;
-        _lastStateChangeTime = millis() / 1000; // Сохраняем секунды
-        _lastStableState = _state;
-        _state = newState;
-        
-        if (_stateChangeCallback) {
-            _stateChangeCallback(change);
+    if (_input) {
+        // Каждое изменение с прошлого вызова: короткое открытие во время
+        // блокирующего обмена с модемом даёт OPENED, затем CLOSED
+        StateChange change = StateChange::NO_CHANGE;
+        bool level;
+        uint16_t time;
+        while (_input->fetch(_pin, level, time)) {
+            bool interpreted = (_sensorType == SensorType::NORMALLY_OPEN) ? !level : level;
+            _lastRawReading = level;
+            if (interpreted == _state) continue;
+            change = _setState(interpreted);
         }
         return change;
     }
+
+    bool newState = readSensor();
+    if (newState != _state) {
+        return _setState(newState);
+    }
     return StateChange::NO_CHANGE;
 }
 
+bool DoorSensor::attachInput(InputSampler& input) {
+    if (!input.watch(_pin)) return false;
+    _input = &input;
+    return true;
+}
+
+DoorSensor::StateChange DoorSensor::_setState(bool newState) {
+    StateChange change = newState ? StateChange::OPENED : StateChange::CLOSED;
+    _lastStateChangeTime = millis() / 1000; // Сохраняем секунды
+    _lastStableState = _state;
+    _state = newState;
+
+    if (_stateChangeCallback) {
+        _stateChangeCallback(change);
+    }
+    return change;
+}
+
 bool DoorSensor::isOperational() const {
     bool currentReading = digitalRead(_pin);
     return (currentReading == HIGH || currentReading == LOW);
@@ -2,10 +2,11 @@
 #define DOORSENSOR_H
 
 #include <Arduino.h>
+#include <InputSampler.h>
 
 class DoorSensor {
 public:
-    enum class StateChange {
+    enum class StateChange : uint8_t {
         OPENED,
         CLOSED,
         NO_CHANGE
@@ -13,7 +14,7 @@ public:
 
     typedef void (*StateChangeCallback)(StateChange change);
 
-    enum class SensorType {
+    enum class SensorType : uint8_t {
         NORMALLY_OPEN,
         NORMALLY_CLOSED
     };
@@ -23,11 +24,14 @@ private:
     bool _state;
     bool _lastStableState;
     bool _lastRawReading;
-    uint16_t _lastDebounceTime = 0;  // В секундах
+    unsigned long _lastDebounceTime = 0; // В миллисекундах
     uint16_t _debounceDelay = 50;    // В миллисекундах
     SensorType _sensorType;
     uint32_t _lastStateChangeTime = 0; // В секундах (хватит на 136 лет работы)
     StateChangeCallback _stateChangeCallback = nullptr;
+    InputSampler* _input = nullptr;    // shared debounced inputs, if attached
+
+    StateChange _setState(bool newState);
 
 public:
     explicit DoorSensor(byte pin, SensorType type = SensorType::NORMALLY_OPEN);
@@ -44,10 +48,13 @@ public:
     uint32_t getLastChangeTime() const { return _lastStateChangeTime; }
     
     // Configuration
-    void setDebounceDelay(uint16_t delayMs) { _debounceDelay = delayMs; }
+    void setDebounceDelay(uint16_t delayMs) { _debounceDelay = delayMs; } // without an InputSampler
     void setSensorType(SensorType type) { _sensorType = type; }
     void setStateChangeCallback(StateChangeCallback callback) { _stateChangeCallback = callback; }
     
+    // Debounced by the InputSampler instead of polling, for pins A0..A5
+    bool attachInput(InputSampler& input);
+
     // Operations
     StateChange update();
     bool hasChanged() const { return _state != _lastStableState; }
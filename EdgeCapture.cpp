@@ -0,0 +1,49 @@
+#include "EdgeCapture.h"
+#include <avr/interrupt.h>
+
+EdgeCapture* EdgeCapture::_instance = nullptr;
+
+ISR(PCINT1_vect) {
+    EdgeCapture::handleInterrupt();
+}
+
+void EdgeCapture::begin() {
+    _instance = this;
+    _lastPort = PINC;
+    PCIFR = 1 << PCIF1;     // drop a stale request
+    PCICR |= 1 << PCIE1;
+}
+
+bool EdgeCapture::watch(uint8_t pin) {
+    if(!isCapturable(pin)) return false;
+    uint8_t bit = 1 << (pin - A0);
+    noInterrupts();
+    _lastPort = (_lastPort & ~bit) | (PINC & bit);
+    _mask |= bit;
+    PCMSK1 |= bit;
+    interrupts();
+    return true;
+}
+
+void EdgeCapture::handleInterrupt() {
+    EdgeCapture* capture = _instance;
+    if(!capture) return;
+    uint8_t port = PINC;
+    uint8_t changed = (port ^ capture->_lastPort) & capture->_mask;
+    capture->_lastPort = port;
+    if(!changed) return;
+
+    Edge& edge = capture->_ring[capture->_head & (RING_SIZE - 1)];
+    edge.time = millis();
+    edge.port = port;
+    edge.changed = changed;
+    capture->_head = capture->_head + 1;
+}
+
+bool EdgeCapture::read(uint8_t index, Edge& edge) const {
+    // The copy is only good if the ISR did not come round to the same slot
+    // while it was made
+    if((uint8_t)(_head - index) > RING_SIZE) return false;
+    edge = _ring[index & (RING_SIZE - 1)];
+    return (uint8_t)(_head - index) <= RING_SIZE;
+}
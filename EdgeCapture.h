@@ -0,0 +1,43 @@
+#ifndef EDGE_CAPTURE_H
+#define EDGE_CAPTURE_H
+
+#include <Arduino.h>
+
+// Pin change capture for the A0..A5 inputs (PORTC, PCINT1). The ISR stamps
+// every edge with the low 16 bits of millis() into a ring, so the port
+// level at any moment since the last read can be recovered, even one that
+// passed during a blocking GSM exchange (up to 32 s). InputSampler is the
+// reader. The GSM port (GsmSerial) only claims PCINT2.
+class EdgeCapture {
+public:
+    static constexpr uint8_t RING_SIZE = 8;     // power of two; a burst past it resyncs from PINC
+
+    struct Edge {
+        uint16_t time;          // millis(), low 16 bits
+        uint8_t port;           // PINC after the edge
+        uint8_t changed;        // watched PINC bits that changed
+    };
+
+    static bool isCapturable(uint8_t pin) { return pin >= A0 && pin <= A5; }
+
+    void begin();
+    bool watch(uint8_t pin);
+
+    // Edges are numbered by a free-running 8-bit counter. read() copies
+    // edge number `index`; false once the ISR has reused its slot.
+    uint8_t getHead() const { return _head; }
+    bool read(uint8_t index, Edge& edge) const;
+
+    // From PCINT1_vect only
+    static void handleInterrupt();
+
+private:
+    Edge _ring[RING_SIZE];
+    volatile uint8_t _head = 0;         // next slot, only the ISR writes it
+    volatile uint8_t _lastPort = 0;
+    uint8_t _mask = 0;
+
+    static EdgeCapture* _instance;
+};
+
+#endif
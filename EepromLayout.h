@@ -0,0 +1,43 @@
+#ifndef EEPROM_LAYOUT_H
+#define EEPROM_LAYOUT_H
+
+#include <Arduino.h>
+
+// EEPROM map of the ATmega328P (1 KB). Every persistent block takes its
+// address from here so a new block cannot silently overlap another one.
+static constexpr uint16_t EEPROM_SIZE = 1024;
+
+// MultiDS18B20 ROM map, 8 locations. It took the first 11 log records
+// when the key store came in; the map rescans itself if it is lost.
+static constexpr uint16_t EEPROM_TEMP_MAP = 0;
+static constexpr uint8_t EEPROM_TEMP_MAP_SIZE = 1 + 8 * 8 + 1;
+static constexpr uint16_t EEPROM_TEMP_MAP_END = EEPROM_TEMP_MAP + EEPROM_TEMP_MAP_SIZE;
+
+// EventLogger ring, 6-byte records. Starts on a record boundary of the
+// old 100-record ring, so the remaining records are still read back. Cut
+// to 82 records when the key store records gained their ROM CRC, then to
+// 74 to make room for the hourly temperatures.
+static constexpr uint16_t EEPROM_EVENT_LOG = EEPROM_TEMP_MAP_END;
+static constexpr uint16_t EEPROM_EVENT_LOG_ENTRIES = 74;
+static constexpr uint16_t EEPROM_EVENT_LOG_END = EEPROM_EVENT_LOG + EEPROM_EVENT_LOG_ENTRIES * 6;
+static_assert(EEPROM_EVENT_LOG % 6 == 0, "event log off its record boundary");
+
+// TempHistory hourly ring, 24 bytes per probe
+static constexpr uint16_t EEPROM_TEMP_HOURLY = EEPROM_EVENT_LOG_END;
+static constexpr uint16_t EEPROM_TEMP_HOURLY_SIZE = 2 * 24;
+static constexpr uint16_t EEPROM_TEMP_HOURLY_END = EEPROM_TEMP_HOURLY + EEPROM_TEMP_HOURLY_SIZE;
+
+// SmokeSensor R0 calibration, one slot per MQ-7. Keeps its address from
+// before the hourly ring came in.
+static constexpr uint16_t EEPROM_SMOKE_CAL = EEPROM_TEMP_HOURLY_END;
+static constexpr uint8_t EEPROM_SMOKE_CAL_SLOT = 6;
+static constexpr uint16_t EEPROM_SMOKE_CAL_END = EEPROM_SMOKE_CAL + 2 * EEPROM_SMOKE_CAL_SLOT;
+
+// KeyStore, 64 iButton serials with their ROM CRC
+static constexpr uint16_t EEPROM_KEY_STORE = EEPROM_SMOKE_CAL_END;
+static constexpr uint16_t EEPROM_KEY_STORE_SIZE = 2 + 64 * 7 + 1;
+static constexpr uint16_t EEPROM_KEY_STORE_END = EEPROM_KEY_STORE + EEPROM_KEY_STORE_SIZE;
+
+static_assert(EEPROM_KEY_STORE_END <= EEPROM_SIZE, "EEPROM layout exceeds 1 KB");
+
+#endif
@@ -1,55 +1,104 @@
 #include "EventLogger.h"
+#include <avr/pgmspace.h>
+#include <util/crc16.h>
 
 EventLogger::EventLogger(uint16_t startAddress, uint16_t maxEntries) 
-    : _startAddr(startAddress), _maxEntries(maxEntries) {
-		 if (startAddress + (maxEntries * sizeof(LogEntry)) > 1024) {
-        Serial.println("EEPROM o/f!");
+    : _startAddr(startAddress), _maxEntries(min(maxEntries, (uint16_t)MAX_ENTRIES)) {
+		 if (startAddress + (_maxEntries * RECORD_SIZE) > 1024) {
+        Serial.println(F("EEPROM o/f!"));
         while(1); // Halt if out of space
     }
 }
 
-bool EventLogger::_isValidType(EventType type) const {
-    return type >= ALARM_TRIGGERED && type <= SMOKE_DETECTED;
-}
+void EventLogger::begin() {
+    _currentIndex = 0;
+    _wrappedAround = false;
+    _nextSeq = 0;
+    _lastTime = 0;
+    _bootPending = true;
+    _indexReset();
 
-bool EventLogger::logEvent(EventType type, const char* message) {
-    if (!_isValidType(type)) {
-        return false;
+    uint8_t first = _readSeq(0);
+    if (first == ERASED_SEQ) return;
+
+    // Slots before the head hold the current lap, the head and everything
+    // after it are erased or one lap older than slot 0. That test is false
+    // up to the head and true from it on, so bisect for the first true.
+    uint16_t lo = 1;
+    uint16_t hi = _maxEntries;
+    while (lo < hi) {
+        uint16_t mid = lo + (hi - lo) / 2;
+        uint8_t seq = _readSeq(mid);
+        if (seq == ERASED_SEQ || _isOlder(seq, first)) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
     }
 
-    // You might want to store the message somewhere or print it
-    Serial.print("Ev: ");
-    Serial.print(eventTypeToString(type));
-    Serial.print(" - Mes: ");
-    Serial.println(message);
+    uint8_t last = _readSeq(lo - 1);
+    _nextSeq = (uint8_t)(last + 1) == ERASED_SEQ ? 0 : last + 1;
+    _currentIndex = lo % _maxEntries;
+    _wrappedAround = lo == _maxEntries || _readSeq(lo) != ERASED_SEQ;
 
-    LogEntry entry = {millis() / 1000, type};
-    return _writeEntry(entry);
+    // The one full pass: index every valid record, oldest first
+    uint16_t stored = _getActualEntryCount();
+    uint16_t start = _wrappedAround ? _currentIndex : 0;
+    uint32_t time = 0;
+    LogEntry entry;
+    for (uint16_t i = 0; i < stored; i++) {
+        uint16_t idx = (start + i) % _maxEntries;
+        if (_readEntry(idx, entry, time)) {
+            _indexAdd(idx, entry);
+        }
+    }
 }
 
-bool EventLogger::logEvent(const char* message) {
-    
-    Serial.print("Mes: ");
-    Serial.println(message);
-
-    LogEntry entry = {millis() / 1000, UNKNOWN_EVENT};
-    return _writeEntry(entry);
+void EventLogger::update() {
+    if (_staged && millis() - _stagedSince >= FLUSH_INTERVAL) {
+        flush();
+    }
 }
 
-bool EventLogger::logEvent(EventType type) {
-    if (!_isValidType(type)) {
-        return false;
+void EventLogger::flush() {
+    if (!_staged) return;
+    for (uint8_t i = 0; i < _staged; i++) {
+        _writeEntry(_stage[i]);
     }
+    _staged = 0;
+}
+
+void EventLogger::setCodeNames(const char* const* names, uint8_t count) {
+    _codeNames = names;
+    _codeNameCount = count;
+}
+
+bool EventLogger::logEvent(uint8_t code, int16_t data, bool critical) {
+    uint32_t now = millis() / 1000; // Сохраняем в секундах
 
-    LogEntry entry = {millis() / 1000, type}; // Сохраняем в секундах
-    
-    if (_writeEntry(entry)) {
-        if (_currentIndex == 0 && !_wrappedAround) {
-            _wrappedAround = true;
+    // Fold a repeat into the last staged record
+    if (_staged) {
+        LogEntry& last = _stage[_staged - 1];
+        if (last.code == code && last.data == data &&
+            now - last.timestamp <= COALESCE_SEC && last.count < 0x7F) {
+            last.count++;
+            return true;
         }
-        return true;
     }
-    return false;
+
+    if (_staged == STAGE_SIZE) {
+        flush();
+    }
+    if (!_staged) {
+        _stagedSince = millis();
+    }
+    _stage[_staged++] = {now, code, 1, data, false};
+
+    // Critical events must survive a reset that follows right after them
+    if (critical || _staged == STAGE_SIZE) {
+        flush();
+    }
+    return true;
 }
 
 bool EventLogger::_writeEntry(const LogEntry& entry) {
@@ -57,55 +106,127 @@ bool EventLogger::_writeEntry(const LogEntry& entry) {
         return false;
     }
 
-    uint16_t address = _startAddr + (_currentIndex * sizeof(LogEntry));
-    
-    // Write each byte of the struct manually
-    const uint8_t* p = (const uint8_t*)(&entry);
-    for (size_t i = 0; i < sizeof(LogEntry); i++) {
-        EEPROM.update(address + i, p[i]); // Update only if changed
-    }
+    // Time since the previous record of this boot, or since the reset
+    uint8_t delta = _encodeDelta(entry.timestamp - (_bootPending ? 0 : _lastTime));
+    _lastTime = (_bootPending ? 0 : _lastTime) + _decodeDelta(delta);
+    _indexRemove(_currentIndex);
+
+    uint16_t address = _startAddr + (_currentIndex * RECORD_SIZE);
+    EEPROM.update(address + 1, entry.code);
+    EEPROM.update(address + 2, delta);
+    EEPROM.update(address + 3, entry.count | (_bootPending ? 0x80 : 0));
+    EEPROM.put(address + 4, entry.data); // put() updates only changed bytes
+    // The sequence number goes last: a record torn by a reset keeps the
+    // old one and begin() takes it for the head
+    EEPROM.update(address, _nextSeq);
+
+    _indexAdd(_currentIndex, entry);
 
+    _bootPending = false;
+    _nextSeq = (uint8_t)(_nextSeq + 1) == ERASED_SEQ ? 0 : _nextSeq + 1;
     _currentIndex = (_currentIndex + 1) % _maxEntries;
+    if (_currentIndex == 0) {
+        _wrappedAround = true;
+    }
     return true;
 }
 
-bool EventLogger::_readEntry(uint16_t index, LogEntry& entry) const {
-    if (index >= _maxEntries) {
+bool EventLogger::_readEntry(uint16_t index, LogEntry& entry, uint32_t& time) const {
+    if (index >= _maxEntries || _readSeq(index) == ERASED_SEQ) {
         return false;
     }
 
-    uint16_t address = _startAddr + (index * sizeof(LogEntry));
-    EEPROM.get(address, entry);
-    return entry.timestamp != 0xFFFFFFFF && _isValidType(entry.type);
+    uint16_t address = _startAddr + (index * RECORD_SIZE);
+    uint8_t flags = EEPROM.read(address + 3);
+    entry.code = EEPROM.read(address + 1);
+    entry.count = flags & 0x7F;
+    entry.boot = flags & 0x80;
+    EEPROM.get(address + 4, entry.data);
+
+    time = (entry.boot ? 0 : time) + _decodeDelta(EEPROM.read(address + 2));
+    entry.timestamp = time;
+    return entry.count != 0;
+}
+
+bool EventLogger::_next(Cursor& cursor, LogEntry& entry) const {
+    uint16_t stored = _getActualEntryCount();
+    uint16_t start = _wrappedAround ? _currentIndex : 0;
+    while (cursor.n < stored) {
+        uint16_t idx = (start + cursor.n++) % _maxEntries;
+        if (_isIndexed(idx) && _readEntry(idx, entry, cursor.time)) return true;
+    }
+    if (cursor.n - stored < _staged) {
+        entry = _stage[cursor.n++ - stored];
+        return true;
+    }
+    return false;
+}
+
+uint8_t EventLogger::_readSeq(uint16_t index) const {
+    return EEPROM.read(_startAddr + index * RECORD_SIZE);
+}
+
+bool EventLogger::_isOlder(uint8_t seq, uint8_t than) const {
+    // Wrapping compare, valid while the ring is shorter than 128 records
+    return (int8_t)(seq - than) < 0;
+}
+
+uint8_t EventLogger::_encodeDelta(uint32_t seconds) {
+    // 0sssssss seconds, 10mmmmmm minutes, 11hhhhhh hours (saturates at 63 h)
+    if (seconds < 128) return seconds;
+    if (seconds < 64UL * 60) return 0x80 | (seconds / 60);
+    return 0xC0 | min(seconds / 3600, 63UL);
+}
+
+uint32_t EventLogger::_decodeDelta(uint8_t delta) {
+    if (!(delta & 0x80)) return delta;
+    if (!(delta & 0x40)) return (delta & 0x3FUL) * 60;
+    return (delta & 0x3FUL) * 3600;
 }
 
 void EventLogger::printLogs() const {
+    Cursor cursor = {0, _walkBase};
     LogEntry entry;
-    uint16_t start = _wrappedAround ? _currentIndex : 0;
-    uint16_t count = _getActualEntryCount();
 
-    Serial.println("= Ev Log =");
-    for(uint16_t i = 0; i < count; i++) {
-        uint16_t idx = (start + i) % _maxEntries;
-        if(_readEntry(idx, entry)) {
-            Serial.print("[");
-            Serial.print(entry.timestamp);
-            Serial.print("] Ev: ");
-            Serial.println(eventTypeToString(entry.type));
+    Serial.println(F("= Ev Log ="));
+    while(_next(cursor, entry)) {
+        if(entry.boot) Serial.print('*');
+        Serial.print('[');
+        Serial.print(entry.timestamp);
+        Serial.print(F("] Ev: "));
+        if(entry.code < _codeNameCount) {
+            Serial.print((const __FlashStringHelper*)pgm_read_ptr(&_codeNames[entry.code]));
+        } else {
+            Serial.print(entry.code);
+        }
+        Serial.print(' ');
+        Serial.print(entry.data);
+        if(entry.count > 1) {
+            Serial.print(F(" x"));
+            Serial.print(entry.count);
         }
+        Serial.println();
     }
 }
 
-uint16_t EventLogger::getEventCount(EventType type) const {
+uint16_t EventLogger::getEventCount(uint8_t code) const {
     uint16_t count = 0;
-    LogEntry entry;
-    uint16_t totalEntries = _getActualEntryCount();
-    uint16_t start = _wrappedAround ? _currentIndex : 0;
+    if(code == ANY_CODE) {
+        count = _totalCount;
+    } else {
+        // Not indexed, read the records
+        uint32_t time = 0;
+        LogEntry entry;
+        for(uint16_t i = 0; i < _getActualEntryCount(); i++) {
+            if(_isIndexed(i) && _readEntry(i, entry, time) && entry.code == code) {
+                count += entry.count;
+            }
+        }
+    }
 
-    for(uint16_t i = 0; i < totalEntries; i++) {
-        uint16_t idx = (start + i) % _maxEntries;
-        if(_readEntry(idx, entry) && (type == UNKNOWN_EVENT || entry.type == type)) {
-            count++;
+    for(uint8_t i = 0; i < _staged; i++) {
+        if(code == ANY_CODE || _stage[i].code == code) {
+            count += _stage[i].count;
         }
     }
     return count;
@@ -116,46 +237,153 @@ bool EventLogger::getLastEvents(LogEntry* buffer, uint16_t count) const {
         return false;
     }
 
-    uint16_t totalEntries = _getActualEntryCount();
-    count = min(count, totalEntries);
-    uint16_t start = (_currentIndex + _maxEntries - count) % _maxEntries;
+    // Timestamps are deltas, so walk from the oldest record
+    Cursor cursor = {0, _walkBase};
+    LogEntry entry;
+    uint16_t total = 0;
+    while(_next(cursor, entry)) total++;
 
-    for(uint16_t i = 0; i < count; i++) {
-        uint16_t idx = (start + i) % _maxEntries;
-        if(!_readEntry(idx, buffer[i])) {
-            return false;
-        }
+    uint16_t skip = total > count ? total - count : 0;
+    cursor = {0, _walkBase};
+    for(uint16_t i = 0; _next(cursor, entry); i++) {
+        if(i >= skip) buffer[i - skip] = entry;
     }
     return true;
 }
 
 void EventLogger::clearLog() {
+    // Only the sequence numbers: erased records are what begin() stops at
+    for(uint16_t i = 0; i < _maxEntries; i++) {
+        EEPROM.update(_startAddr + i * RECORD_SIZE, ERASED_SEQ);
+    }
     _currentIndex = 0;
     _wrappedAround = false;
+    _staged = 0;
+    _indexReset();
 }
 
 bool EventLogger::clearEEPROM() {
-    for(uint16_t i = 0; i < _maxEntries; i++) {
-        uint16_t address = _startAddr + (i * sizeof(LogEntry));
-        LogEntry emptyEntry{0, UNKNOWN_EVENT};
-        const uint8_t* p = (const uint8_t*)(&emptyEntry);
-        for (size_t j = 0; j < sizeof(LogEntry); j++) {
-            EEPROM.update(address + j, p[j]);
-        }
+    uint16_t end = _startAddr + _maxEntries * RECORD_SIZE;
+    for(uint16_t address = _startAddr; address < end; address++) {
+        EEPROM.update(address, 0xFF);
     }
+    _currentIndex = 0;
+    _wrappedAround = false;
+    _staged = 0;
+    _nextSeq = 0;
+    _indexReset();
     return true;
 }
 
-String EventLogger::eventTypeToString(EventType type) const {
-    switch(type) {
-        case ALARM_TRIGGERED: return "A";
-        case DOOR_OPENED: return "B";
-        case MOTION_DETECTED: return "C";
-        case SMOKE_DETECTED: return "D";
-        default: return "Z";
+void EventLogger::formatSummary(char* buffer, size_t size) const {
+    // "LOG 57: FIRE 52@3710 ARMED@3600 ..." with x<count> for folded events
+    LogEntry recent[RECENT_SIZE];
+    uint16_t total = _validCount + _staged;
+    uint8_t n = min(total, (uint16_t)RECENT_SIZE);
+    snprintf_P(buffer, size, PSTR("LOG %u:"), getEventCount());
+    if(!n || !getLastEvents(recent, n)) return;
+
+    for(int8_t i = n - 1; i >= 0; i--) {
+        const LogEntry& e = recent[i];
+        char item[32];
+        char name[12];
+        if(e.code < _codeNameCount) {
+            strncpy_P(name, (const char*)pgm_read_ptr(&_codeNames[e.code]), sizeof(name) - 1);
+            name[sizeof(name) - 1] = '\0';
+        } else {
+            snprintf_P(name, sizeof(name), PSTR("#%u"), e.code);
+        }
+        int len = snprintf_P(item, sizeof(item), PSTR(" %s"), name);
+        if(e.data) len += snprintf_P(item + len, sizeof(item) - len, PSTR(" %d"), e.data);
+        if(e.count > 1) len += snprintf_P(item + len, sizeof(item) - len, PSTR(" x%u"), e.count);
+        snprintf_P(item + len, sizeof(item) - len, PSTR("@%lu"), (unsigned long)e.timestamp);
+
+        size_t used = strlen(buffer);
+        if(used + strlen(item) + 1 > size) break;
+        strcpy(buffer + used, item);
+    }
+}
+
+void EventLogger::exportLog(Print& out) {
+    flush();
+
+    uint16_t count = _getActualEntryCount();
+    uint32_t uptime = millis() / 1000;
+    uint8_t header[EXPORT_HEADER_SIZE];
+    memcpy_P(header, PSTR("GLOG"), 4);
+    header[4] = EXPORT_VERSION;
+    header[5] = RECORD_SIZE;
+    header[6] = count & 0xFF;
+    header[7] = count >> 8;
+    for (uint8_t i = 0; i < 4; i++) {
+        header[8 + i] = _walkBase >> (8 * i);
+        header[12 + i] = uptime >> (8 * i);
+    }
+    uint16_t crc = _exportBytes(out, header, sizeof(header), 0xFFFF);
+
+    // Oldest first: from the head to the end of the area, then from its
+    // start, EXPORT_CHUNK bytes per read and write
+    uint16_t start = _wrappedAround ? _currentIndex : 0;
+    uint16_t first = min(count, (uint16_t)(_maxEntries - start));
+    uint16_t spans[2][2] = {{start, first}, {0, (uint16_t)(count - first)}};
+    uint8_t chunk[EXPORT_CHUNK];
+    for (uint8_t s = 0; s < 2; s++) {
+        uint16_t address = _startAddr + spans[s][0] * RECORD_SIZE;
+        uint16_t left = spans[s][1] * RECORD_SIZE;
+        while (left) {
+            uint8_t n = min(left, (uint16_t)EXPORT_CHUNK);
+            for (uint8_t i = 0; i < n; i++) {
+                chunk[i] = EEPROM.read(address + i);
+            }
+            crc = _exportBytes(out, chunk, n, crc);
+            address += n;
+            left -= n;
+        }
+    }
+
+    out.write(crc & 0xFF);
+    out.write(crc >> 8);
+}
+
+uint16_t EventLogger::_exportBytes(Print& out, const uint8_t* data, uint8_t size, uint16_t crc) const {
+    for (uint8_t i = 0; i < size; i++) {
+        crc = _crc_xmodem_update(crc, data[i]);
     }
+    out.write(data, size);
+    return crc;
 }
 
 uint16_t EventLogger::_getActualEntryCount() const {
     return _wrappedAround ? _maxEntries : _currentIndex;
+}
+
+void EventLogger::_indexReset() {
+    memset(_validMap, 0, sizeof(_validMap));
+    _totalCount = 0;
+    _validCount = 0;
+    _walkBase = 0;
+}
+
+void EventLogger::_indexAdd(uint16_t index, const LogEntry& entry) {
+    _validMap[index >> 3] |= 1 << (index & 7);
+    _validCount++;
+    _totalCount += entry.count;
+}
+
+void EventLogger::_indexRemove(uint16_t index) {
+    // The slot is about to be overwritten: take back what it counted and
+    // move the walk base past it, so walks keep the times the index has
+    if (!_isIndexed(index)) return;
+    uint16_t address = _startAddr + (index * RECORD_SIZE);
+    uint8_t flags = EEPROM.read(address + 3);
+    uint8_t count = flags & 0x7F;
+    _walkBase = ((flags & 0x80) ? 0 : _walkBase) + _decodeDelta(EEPROM.read(address + 2));
+
+    _validMap[index >> 3] &= ~(1 << (index & 7));
+    _validCount--;
+    _totalCount -= count;
+}
+
+bool EventLogger::_isIndexed(uint16_t index) const {
+    return _validMap[index >> 3] & (1 << (index & 7));
 }
\ No newline at end of file
@@ -4,43 +4,112 @@
 #include <EEPROM.h>
 #include <Arduino.h>
 
+// Event log in an EEPROM ring. Events are staged in RAM and written in
+// batches: repeats of the same event are folded into one record, and the
+// batch goes out when it fills, when a critical event arrives or once a
+// minute from update(). Records are written round-robin, so every slot
+// wears at the same rate. Each record carries a sequence number; the head
+// is found again at boot with a binary search, nothing else is stored.
+//
+// Record, 6 bytes: seq, code, time delta, count (bit 7: first record after
+// a reset), 16-bit payload. Codes and payloads are the caller's
+// (SystemManager::MsgID and e.g. ppm, 0.1 C, health mask).
+//
+// A RAM index is built by one pass at boot and kept up to date on every
+// write: the event total and a bitmap of valid slots, so the total needs
+// no EEPROM reads. Per-code counts and recent-event queries walk the
+// records (only on request).
+//
+// exportLog() writes the log as one binary frame: "GLOG", version, record
+// size, record count (LE16), walk base and uptime in seconds (LE32 each),
+// the raw records oldest first, then CRC-16/CCITT-FALSE of everything
+// before it (LE16). sim/tools/log_decode turns it into CSV.
 class EventLogger {
 public:
-    enum EventType {
-        ALARM_TRIGGERED = 1,
-        DOOR_OPENED,
-        MOTION_DETECTED,
-        SMOKE_DETECTED,
-        UNKNOWN_EVENT = 255
-    };
-
     struct LogEntry {
-        uint32_t timestamp;
-        EventType type;
+        uint32_t timestamp;  // seconds since the reset it was logged after
+        uint8_t code;
+        uint8_t count;       // identical events folded into this one
+        int16_t data;
+        bool boot;           // first record after a reset
     };
 
+    static constexpr uint8_t ANY_CODE = 0xFF;
+    static constexpr uint8_t MAX_ENTRIES = 80;            // RAM bitmap; 8-bit sequences allow 127
+    static constexpr uint8_t STAGE_SIZE = 2;             // distinct events per batch; repeats fold
+    static constexpr uint8_t COALESCE_SEC = 10;           // fold repeats this close together
+    static constexpr unsigned long FLUSH_INTERVAL = 60000; // ms a staged event may wait
+    static constexpr uint8_t RECORD_SIZE = 6;
+    static constexpr uint8_t ERASED_SEQ = 0xFF;           // never issued
+    static constexpr uint8_t RECENT_SIZE = 4;             // newest records in a summary, an SMS worth
+    static constexpr uint8_t EXPORT_VERSION = 1;
+    static constexpr uint8_t EXPORT_HEADER_SIZE = 16;
+    static constexpr uint8_t EXPORT_CHUNK = 32;           // EEPROM bytes per write()
+
     EventLogger(uint16_t startAddress = 0, uint16_t maxEntries = 100);
     
-    bool logEvent(EventType type);  // Type only
-    bool logEvent(EventType type, const char* message);  // Type + message
-    bool logEvent(const char* message);  // Raw string message
+    void begin();   // Find the ring head (O(log n)), then build the index
+    void update();  // Flush the staged events once they are old enough
+    void flush();
+    
+    // PROGMEM table of code names for printLogs()
+    void setCodeNames(const char* const* names, uint8_t count);
+
+    bool logEvent(uint8_t code, int16_t data = 0, bool critical = false);
     void clearLog();
     bool clearEEPROM(); // Полная очистка выделенной области
     void printLogs() const;
-    uint16_t getEventCount(EventType type = UNKNOWN_EVENT) const;
+    uint16_t getEventCount(uint8_t code = ANY_CODE) const;
     bool getLastEvents(LogEntry* buffer, uint16_t count) const;
-    String eventTypeToString(EventType type) const;
+    uint8_t getStagedCount() const { return _staged; }
+    void formatSummary(char* buffer, size_t size) const; // for SMS, newest first
+
+    // Flushes the stage first. Blocks for the whole frame (~0.65 s for
+    // 100 records at 9600 baud) so no other output lands inside it.
+    void exportLog(Print& out);
 
 private:
+    // Walks the log oldest first, EEPROM then stage, rebuilding timestamps
+    struct Cursor {
+        uint16_t n;
+        uint32_t time;
+    };
+
     uint16_t _startAddr;
     uint16_t _maxEntries;
     uint16_t _currentIndex = 0;
     bool _wrappedAround = false;
+    uint8_t _nextSeq = 0;
+    uint32_t _lastTime = 0;     // as decoded, so rounding never accumulates
+    bool _bootPending = true;
+
+    LogEntry _stage[STAGE_SIZE];
+    uint8_t _staged = 0;
+    unsigned long _stagedSince = 0;
+
+    const char* const* _codeNames = nullptr;
+    uint8_t _codeNameCount = 0;
+
+    // Index over the records in EEPROM (staged ones are scanned directly)
+    uint16_t _totalCount = 0;   // events, folds included
+    uint16_t _validCount = 0;   // records
+    uint32_t _walkBase = 0;     // time before the oldest record, for walks
+    uint8_t _validMap[(MAX_ENTRIES + 7) / 8];
     
-    bool _isValidType(EventType type) const;
     bool _writeEntry(const LogEntry& entry);
-    bool _readEntry(uint16_t index, LogEntry& entry) const;
+    bool _readEntry(uint16_t index, LogEntry& entry, uint32_t& time) const;
+    bool _next(Cursor& cursor, LogEntry& entry) const;
+    uint8_t _readSeq(uint16_t index) const;
+    bool _isOlder(uint8_t seq, uint8_t than) const;
     uint16_t _getActualEntryCount() const;
+    void _indexReset();
+    void _indexAdd(uint16_t index, const LogEntry& entry);
+    void _indexRemove(uint16_t index);
+    bool _isIndexed(uint16_t index) const;
+    uint16_t _exportBytes(Print& out, const uint8_t* data, uint8_t size, uint16_t crc) const;
+
+    static uint8_t _encodeDelta(uint32_t seconds);
+    static uint32_t _decodeDelta(uint8_t delta);
 };
 
 #endif
\ No newline at end of file
@@ -1,98 +1,153 @@
 #include "GSMController.h"
+#include <avr/pgmspace.h>
 
-GSMController::GSMController(uint8_t rxPin, uint8_t txPin, uint8_t powerPin) 
+// Init sequence, sent one by one once the modem has booted
+static const char _initAt[] PROGMEM = "AT";
+static const char _initEcho[] PROGMEM = "ATE0";                // Disable echo
+static const char _initCmee[] PROGMEM = "AT+CMEE=1";           // Enable verbose errors
+static const char _initCmgf[] PROGMEM = "AT+CMGF=1";           // Text mode
+static const char _initCnmi[] PROGMEM = "AT+CNMI=1,2,0,0,0";   // SMS delivered as +CMT
+static const char _initClip[] PROGMEM = "AT+CLIP=1";           // Caller ID
+static const char* const _initCommands[] PROGMEM = {
+    _initAt, _initEcho, _initCmee, _initCmgf, _initCnmi, _initClip
+};
+static constexpr uint8_t INIT_COMMANDS = sizeof(_initCommands) / sizeof(_initCommands[0]);
+
+static const char _cmdCreg[] PROGMEM = "AT+CREG?";
+static const char _cmdSms[] PROGMEM = "AT+CMGS=\"%s\"";
+static const char _cmdDial[] PROGMEM = "ATD%s;";
+static const char _cmdHangUp[] PROGMEM = "ATH";
+static const char _cmdRadioOff[] PROGMEM = "AT+CFUN=0";
+static const char _cmdRadioOn[] PROGMEM = "AT+CFUN=1";
+
+GSMController::GSMController(uint8_t rxPin, uint8_t txPin, uint8_t powerPin)
     : _serial(rxPin, txPin), _powerPin(powerPin) {}
 
-bool GSMController::begin(unsigned long timeout) {
+bool GSMController::begin() {
+    // Restart only when never started or the modem stopped answering;
+    // a lost registration is recovered by the background AT+CREG? poll
+    if(_phase != Phase::OFF && _status != NetworkStatus::ERROR) return true;
+
     _serial.begin(9600);
-    delay(1000); // Initial delay
-    
-    if(_powerPin != -1) {
+    _flushQueue();
+    _parser.reset();
+    _smsBodyNext = false;
+    _timeouts = 0;
+    _initStep = 0;
+    _lastCregPoll = millis() - CREG_POLL_SEARCHING;
+    _changeStatus(NetworkStatus::DISCONNECTED);
+
+    if(_powerPin != NO_POWER_PIN) {
         pinMode(_powerPin, OUTPUT);
         digitalWrite(_powerPin, LOW); // Ensure power is off first
-        delay(1000);
-        digitalWrite(_powerPin, HIGH);
-        delay(3000); // Increased delay for power stabilization
+        _phase = Phase::POWER_DOWN;
+        _holdUntil = millis() + 2000;
+    } else {
+        _phase = Phase::POWER_UP;
+        _holdUntil = millis() + 1000;
     }
+    return true;
+}
 
-    // Check if module responds
-    if (!_sendATCommand("AT", "OK", 3000)) {
-        _changeStatus(NetworkStatus::ERROR);
-        return false;
+void GSMController::update() {
+    if(_phase == Phase::OFF) return;
+
+    for(uint8_t n = 0; n < MAX_BYTES_PER_UPDATE && _serial.available(); n++) {
+        _receive(_serial.read());
+    }
+
+    unsigned long now = millis();
+    bool holdOver = (long)(now - _holdUntil) >= 0;
+
+    switch(_phase) {
+        case Phase::POWER_DOWN:
+            if(holdOver) {
+                digitalWrite(_powerPin, HIGH);
+                _phase = Phase::POWER_UP;
+                _holdUntil = now + 3000; // Power stabilization
+            }
+            return;
+        case Phase::POWER_UP:
+            if(holdOver) _phase = Phase::READY;
+            return;
+        default:
+            break;
     }
 
-    // Add delays between commands
-    _sendATCommand("ATE0", "OK", 1000); // Disable echo
-    delay(500);
-    _sendATCommand("AT+CMEE=1", "OK", 1000); // Enable verbose errors
-    delay(500);
-    _sendATCommand("AT+CMGF=1", "OK", 1000); // Text mode
-    delay(500);
-    _sendATCommand("AT+CNMI=1,2,0,0,0", "OK", 1000); // SMS notifications
-    delay(500);
-    _sendATCommand("AT+CLIP=1", "OK", 1000); // Caller ID
-    delay(500);
-    
-    // Check CREG with more retries
-    for (int i = 0; i < 3; i++) {
-        if (_waitForNetwork(5000)) {
-            return true;
+    if(_status == NetworkStatus::ERROR) {
+        if(holdOver) {
+            _phase = Phase::OFF;
+            begin();
         }
-        delay(1000);
+        return;
     }
-    
-    _changeStatus(NetworkStatus::ERROR);
-    return false;
-}
 
-void GSMController::update() {
-    if(_serial.available()) {
-        String data = _readSerial();
-        if(data.length() > 0) {
-            _processIncomingData(data);
-            _lastResponseTime = millis();
+    if(_active) {
+        if(now - _sentAt >= _current().timeoutMs) {
+            _complete(false);
+            if(++_timeouts >= MAX_TIMEOUTS) {
+                _flushQueue();
+                _changeStatus(NetworkStatus::ERROR);
+                _holdUntil = now + RESTART_DELAY;
+            }
+        }
+        return;
+    }
+
+    if(!holdOver) return;
+
+    if(_initStep < INIT_COMMANDS) {
+        bool probe = _initStep == 0;
+        if(_enqueue((PGM_P)pgm_read_ptr(&_initCommands[_initStep]), nullptr,
+                    Response::OK, probe ? 3000 : 1000, 100,
+                    probe ? _onAtReply : nullptr, this)) {
+            _initStep++;
+        }
+    } else if(!_queueCount) {
+        unsigned long poll = _status == NetworkStatus::REGISTERED_HOME ?
+                             CREG_POLL_REGISTERED : CREG_POLL_SEARCHING;
+        if(now - _lastCregPoll >= poll) {
+            _lastCregPoll = now;
+            _enqueue(_cmdCreg, nullptr, Response::CREG, 2000, 0, _onCregReply, this);
         }
     }
+
+    _startNext();
+}
+
+bool GSMController::sendSMS(const char* number, const char* text,
+                            CommandCallback callback, void* context) {
+    if(_status != NetworkStatus::REGISTERED_HOME) return false;
+
+    uint8_t slot = 0;
+    while(slot < SMS_SLOTS && _sms[slot].used) slot++;
+    if(slot == SMS_SLOTS) return false;
+
+    _sms[slot].text = text;
+    if(!_enqueue(_cmdSms, number, Response::PROMPT, 5000, 0, callback, context, slot)) return false;
+    _sms[slot].used = true;
+    return true;
 }
 
-bool GSMController::sendSMS(const String& number, const String& text) {
-    if(_status < NetworkStatus::REGISTERED_HOME) return false;
-
-    _serial.print("AT+CMGS=\"");
-    _serial.print(number);
-    _serial.println("\"");
-    
-    if(!_waitForResponse(">", 2000)) return false;
-    
-    _serial.print(text);
-    _serial.write(26); // Ctrl+Z
-    delay(100); // Short delay after Ctrl+Z
-    
-    return _waitForResponse("+CMGS:", 10000); // Longer timeout for SMS sending
+bool GSMController::makeCall(const char* number) {
+    if(_status != NetworkStatus::REGISTERED_HOME) return false;
+    return _enqueue(_cmdDial, number, Response::OK, 3000, CALL_GAP, _onCallReply, this);
 }
 
-bool GSMController::makeCall(const String& number) {
-    if(_status < NetworkStatus::REGISTERED_HOME) return false;
-    
-    _serial.print("ATD");
-    _serial.print(number);
-    _serial.println(";");
-    
-    if(!_waitForResponse("OK", 3000)) {
+void GSMController::endCall() {
+    if(_enqueue(_cmdHangUp, nullptr, Response::OK, 1000, 0, nullptr, nullptr)) {
         _callStatus = CallStatus::NO_CALL;
-        return false;
     }
-    
-    _callStatus = CallStatus::ACTIVE_CALL;
-    return true;
 }
 
 void GSMController::setLowPowerMode(bool enable) {
-    if (enable) {
-        _sendATCommand("AT+CFUN=0", "OK", 1000);
-    } else {
-        _sendATCommand("AT+CFUN=1", "OK", 1000);
-    }
+    _enqueue(enable ? _cmdRadioOff : _cmdRadioOn, nullptr, Response::OK, 10000, 0, nullptr, nullptr);
+}
+
+bool GSMController::sendCommand(PGM_P cmd, Response expect, uint16_t timeoutMs,
+                                CommandCallback callback, void* context) {
+    if(expect == Response::PROMPT) return false;
+    return _enqueue(cmd, nullptr, expect, timeoutMs, 0, callback, context);
 }
 
 // Callbacks
@@ -109,106 +164,173 @@ void GSMController::onNetworkChange(StatusCallback callback) {
 }
 
 // Private methods
-String GSMController::_readSerial(unsigned long timeout) {
-    String data;
-    unsigned long start = millis();
-    while(millis() - start < timeout) {
-        while(_serial.available()) {
-            char c = _serial.read();
-            data += c;
-            // Keep reading until timeout or we get a complete response
-            if(data.endsWith("\r\nOK\r\n") || data.endsWith("\r\nERROR\r\n")) {
-                return data;
-            }
-        }
+bool GSMController::_enqueue(PGM_P format, const char* arg, Response expect, uint16_t timeoutMs, uint16_t gapMs,
+                             CommandCallback callback, void* context, uint8_t sms) {
+    if(_queueCount >= QUEUE_SIZE) return false;
+
+    Command& c = _queue[(_queueHead + _queueCount) % QUEUE_SIZE];
+    c.format = format;
+    c.arg = arg;
+    c.expect = expect;
+    c.timeoutMs = timeoutMs;
+    c.gapMs = gapMs;
+    c.callback = callback;
+    c.context = context;
+    c.sms = sms;
+    _queueCount++;
+    return true;
+}
+
+void GSMController::_startNext() {
+    if(_active || !_queueCount) return;
+
+    const Command& c = _current();
+    char line[CMD_BUFFER_SIZE];
+    if(c.arg) {
+        snprintf_P(line, sizeof(line), c.format, c.arg);
+    } else {
+        strncpy_P(line, c.format, sizeof(line) - 1);
+        line[sizeof(line) - 1] = '\0';
     }
-    return data;
+
+    _info[0] = '\0';
+    _promptSeen = false;
+    _parser.expectPrompt(c.expect == Response::PROMPT);
+    _active = true;
+    _sentAt = millis();
+    _serial.println(line);
 }
 
-String GSMController::_sendATCommand(const char* cmd, const char* expected, unsigned long timeout, bool storeResponse = false) {
-    _serial.println(cmd);
-    String response;
-    unsigned long start = millis();
-    
-    while (millis() - start < timeout) {
-        if (_serial.available()) {
-            char c = _serial.read();
-            response += c;
-            
-            if (response.endsWith("\r\n") || response.endsWith("OK\r\n") || 
-                response.endsWith("ERROR\r\n") || response.indexOf(expected) != -1) {
-                break;
-            }
-        }
+void GSMController::_complete(bool success) {
+    // The slot is freed first: the callback may queue the next command
+    const Command& c = _current();
+    CommandCallback callback = c.callback;
+    void* context = c.context;
+    _active = false;
+    _parser.expectPrompt(false);
+    if(c.sms != NO_SMS) _sms[c.sms].used = false;
+    _holdUntil = millis() + c.gapMs;
+    _queueHead = (_queueHead + 1) % QUEUE_SIZE;
+    _queueCount--;
+
+    if(callback) {
+        callback(context, success, _info);
+    }
+}
+
+void GSMController::_flushQueue() {
+    // Every dropped command still reports failure to its owner, the
+    // running one first
+    while(_queueCount) {
+        _info[0] = '\0';
+        _complete(false);
     }
-    
-    if (storeResponse) {
-        return response;
+    for(uint8_t i = 0; i < SMS_SLOTS; i++) {
+        _sms[i].used = false;
     }
-    return response.indexOf(expected) != -1 ? "OK" : "";
 }
 
+void GSMController::_receive(char c) {
+    AtParser::Token token = _parser.feed(c);
+    if(token == AtParser::Token::NONE) return;
 
-bool GSMController::_waitForResponse(const char* expected, unsigned long timeout) {
-    unsigned long start = millis();
-    String response;
-    
-    while(millis() - start < timeout) {
-        if(_serial.available()) {
-            char c = _serial.read();
-            response += c;
-            
-            if(response.indexOf(expected) != -1) {
-                return true;
-            }
-            if(response.indexOf("ERROR") != -1) {
-                return false;
-            }
+    if(token == AtParser::Token::PROMPT) {
+        // Only enabled while an AT+CMGS waits for it
+        _promptSeen = true;
+        _parser.expectPrompt(false);
+        if(_current().sms == NO_SMS) {
+            _serial.write(27); // ESC, nothing to send
+            return;
         }
+        _serial.print(_sms[_current().sms].text);
+        _serial.write(26); // Ctrl+Z
+        _sentAt = millis();
+        _current().timeoutMs = SMS_TIMEOUT;
+        return;
     }
-    return false;
-}
 
-void GSMController::_processIncomingData(const String& data) {
-    if(data.startsWith("+CMTI:")) {
-        // Новое SMS
-        if(_smsCallback) {
-            int index = data.indexOf(',');
-            String smsIndex = data.substring(index + 1);
-            _serial.println("AT+CMGR=" + smsIndex);
-            String smsData = _readSerial(1000);
-            // Парсим номер и текст сообщения
-            String number = _extractNumber(smsData);
-            String text = smsData.substring(smsData.indexOf('\n') + 1);
-            _smsCallback(number, text);
-        }
+    _lastResponseTime = millis();
+    char line[AtParser::LINE_SIZE];
+
+    if(_smsBodyNext) {
+        // Текст SMS, что бы в нём ни было (даже "OK")
+        _smsBodyNext = false;
+        _parser.getLine(line, sizeof(line));
+        if(_smsCallback) _smsCallback(_smsFrom, line);
+        return;
     }
-    else if(data.startsWith("+CLIP:")) {
-        // Входящий звонок с определением номера
-        if(_callCallback) {
-            String number = _extractNumber(data);
+
+    switch(token) {
+        case AtParser::Token::CMT:
+            // Новое SMS: заголовок, текст в следующей строке
+            _parser.getLine(line, sizeof(line));
+            _extractNumber(line, _smsFrom, sizeof(_smsFrom));
+            _smsBodyNext = true;
+            return;
+
+        case AtParser::Token::CLIP: {
+            // Входящий звонок с определением номера
+            char number[NUMBER_SIZE];
+            _parser.getLine(line, sizeof(line));
+            _extractNumber(line, number, sizeof(number));
             _callStatus = CallStatus::INCOMING_CALL;
-            _callCallback(number, _callStatus);
+            if(_callCallback) _callCallback(number, _callStatus);
+            return;
         }
+
+        case AtParser::Token::RING:
+            return;
+
+        case AtParser::Token::CALL_END:
+            // Звонок завершен; для ATD это ещё и итоговый ответ
+            if(_active && _current().format == _cmdDial) {
+                _timeouts = 0;
+                _complete(false);
+            }
+            _callStatus = CallStatus::CALL_ENDED;
+            if(_callCallback) _callCallback("", _callStatus);
+            return;
+
+        case AtParser::Token::CREG:
+            if(!(_active && _current().expect == Response::CREG)) {
+                // Изменение статуса сети
+                _parser.getLine(line, sizeof(line));
+                _parseCreg(line, false);
+                return;
+            }
+            break;
+
+        default:
+            break;
     }
-    else if(data.startsWith("NO CARRIER") || data.startsWith("BUSY")) {
-        // Звонок завершен
-        _callStatus = CallStatus::CALL_ENDED;
-        if(_callCallback) {
-            _callCallback("", _callStatus);
-        }
+
+    if(!_active) return;
+
+    switch(token) {
+        case AtParser::Token::OK:
+            _timeouts = 0;
+            _complete(_current().expect == Response::OK || _info[0]);
+            break;
+
+        case AtParser::Token::ERROR:
+            _timeouts = 0;
+            _complete(false);
+            break;
+
+        case AtParser::Token::CMGS:
+        case AtParser::Token::CREG:
+        case AtParser::Token::LINE:
+            // +CMGS: for AT+CMGS, +CREG: for AT+CREG?, +CSQ: ... for the rest
+            if(token == AtParser::Token::LINE && _current().expect == Response::PROMPT) break;
+            if(_parser.getLine(line, sizeof(line)) && line[0] == '+') {
+                strncpy(_info, line, sizeof(_info) - 1);
+                _info[sizeof(_info) - 1] = '\0';
+            }
+            break;
+
+        default:
+            break;
     }
-	else if(data.startsWith("+CREG:")) {
-		// Изменение статуса сети
-		int status = data.charAt(data.length() - 1) - '0';
-		NetworkStatus newStatus;
-		switch(status) {
-			case 1: newStatus = NetworkStatus::REGISTERED_HOME; break;
-			case 0: newStatus = NetworkStatus::DISCONNECTED; break;
-			default: newStatus = NetworkStatus::ERROR;
-		}
-		_changeStatus(newStatus);
-	}	
 }
 
 void GSMController::_changeStatus(NetworkStatus newStatus) {
@@ -220,32 +342,53 @@ void GSMController::_changeStatus(NetworkStatus newStatus) {
     }
 }
 
-String GSMController::_extractNumber(const String& data) const {
-    int start = data.indexOf('\"') + 1;
-    int end = data.indexOf('\"', start);
-    return data.substring(start, end);
-}
-
-bool GSMController::_waitForNetwork(unsigned long timeout) {
-    unsigned long start = millis();
-    while(millis() - start < timeout) {
-        // Более гибкая проверка ответа CREG
-        String response = _sendATCommand("AT+CREG?", "+CREG:", 2000, true);
-        
-        if (response.indexOf("+CREG: 0,1") != -1 || response.indexOf("+CREG: 1,1") != -1) {
+void GSMController::_parseCreg(const char* line, bool solicited) {
+    // "+CREG: <n>,<stat>" in reply to AT+CREG?, "+CREG: <stat>" unsolicited
+    const char* p = strchr(line, ':');
+    if(!p) return;
+    if(solicited) {
+        p = strchr(p, ',');
+        if(!p) return;
+    }
+    switch(atoi(p + 1)) {
+        case 1:  // home
+        case 5:  // roaming
             _changeStatus(NetworkStatus::REGISTERED_HOME);
-            return true;
-        }
-        delay(1000);
+            break;
+        default: // not registered, searching, denied, unknown
+            _changeStatus(NetworkStatus::DISCONNECTED);
     }
-    
-    // Если не удалось зарегистрироваться, проверяем базовую работоспособность
-    if (_sendATCommand("AT", "OK", 1000)) {
-        _changeStatus(NetworkStatus::DISCONNECTED);
-    } else {
-        _changeStatus(NetworkStatus::ERROR);
+}
+
+void GSMController::_extractNumber(const char* data, char* number, size_t size) {
+    number[0] = '\0';
+    const char* start = strchr(data, '\"');
+    if(!start) return;
+    start++;
+    const char* end = strchr(start, '\"');
+    size_t len = end ? (size_t)(end - start) : strlen(start);
+    if(len >= size) len = size - 1;
+    memcpy(number, start, len);
+    number[len] = '\0';
+}
+
+void GSMController::_onAtReply(void* context, bool success, const char*) {
+    GSMController* self = static_cast<GSMController*>(context);
+    if(!success) {
+        // Modem does not answer: power-cycle it later
+        self->_flushQueue();
+        self->_changeStatus(NetworkStatus::ERROR);
+        self->_holdUntil = millis() + RESTART_DELAY;
     }
-    return false;
+}
+
+void GSMController::_onCregReply(void* context, bool success, const char* info) {
+    if(success) static_cast<GSMController*>(context)->_parseCreg(info, true);
+}
+
+void GSMController::_onCallReply(void* context, bool success, const char*) {
+    GSMController* self = static_cast<GSMController*>(context);
+    self->_callStatus = success ? CallStatus::ACTIVE_CALL : CallStatus::NO_CALL;
 }
 
 GSMController::NetworkStatus GSMController::getNetworkStatus() const {
@@ -253,17 +396,9 @@ GSMController::NetworkStatus GSMController::getNetworkStatus() const {
 }
 
 bool GSMController::isOperational() const {
-    // Быстрая проверка питания
-    if(_powerPin != -1 && digitalRead(_powerPin) != HIGH) {
+    // Только кэшированное состояние: без AT-команд, не блокирует loop()
+    if(_powerPin != NO_POWER_PIN && digitalRead(_powerPin) != HIGH) {
         return false;
     }
-
-    // Проверяем, отвечает ли модуль
-    if (!_sendATCommand("AT", "OK", 1000)) {
-        return false;
-    }
-
-    // Проверяем регистрацию в сети
-    String cregResponse = _sendATCommand("AT+CREG?", "+CREG:", 2000, true);
-    return (cregResponse.indexOf(",1") != -1 || cregResponse.indexOf(",5") != -1);
-}
\ No newline at end of file
+    return _status == NetworkStatus::REGISTERED_HOME;
+}
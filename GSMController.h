@@ -1,65 +1,156 @@
 #ifndef GSM_CONTROLLER_H
 #define GSM_CONTROLLER_H
-#define SMS_BUFFER_SIZE 32    
-#define CMD_BUFFER_SIZE 32   
-#include <SoftwareSerial.h>
+#define SMS_BUFFER_SIZE 48    // SMS text, including terminator
+#define CMD_BUFFER_SIZE 32    // AT command line, including terminator
+#include <AtParser.h>
+#include <GsmSerial.h>
 #include <Arduino.h>
 
+// Asynchronous SIM800 driver. Commands are queued and update() feeds the
+// modem output byte by byte through AtParser, so no public method waits
+// for the modem.
 class GSMController {
 public:
 
+	// Power pin and cached registration state; never talks to the modem
 	bool isOperational() const;
-    
-enum class NetworkStatus {
+
+enum class NetworkStatus : uint8_t {
     DISCONNECTED,      // 0 - не зарегистрирован
     REGISTERED_HOME,   // 2 - зарегистрирован в домашней сети
     ERROR              // 4 - ошибка
 };
 
-    enum class CallStatus {
+    enum class CallStatus : uint8_t {
         NO_CALL,
         INCOMING_CALL,
         ACTIVE_CALL,
         CALL_ENDED
     };
 
-    typedef void (*SmsCallback)(const String& number, const String& text);
-    typedef void (*CallCallback)(const String& number, CallStatus status);
+    // Response that completes a command successfully
+    enum class Response : uint8_t {
+        OK,        // final "OK"
+        PROMPT,    // "> " of AT+CMGS, then "+CMGS:" and "OK"
+        CREG       // "+CREG:" line, then "OK"
+    };
+
+    // text is the receive line buffer, the handler may edit it in place
+    typedef void (*SmsCallback)(const char* number, char* text);
+    typedef void (*CallCallback)(const char* number, CallStatus status);
     typedef void (*StatusCallback)(NetworkStatus status);
+    // info: last information line of the response ("+CREG: 0,1"), or ""
+    typedef void (*CommandCallback)(void* context, bool success, const char* info);
 
     GSMController(uint8_t rxPin, uint8_t txPin, uint8_t powerPin = -1);
-    
-    bool begin(unsigned long timeout = 10000);
+
+    bool begin(); // Starts power-up and init; returns at once
     void update();
-    bool sendSMS(const String& number, const String& text);
-    bool makeCall(const String& number);
+    // true if queued; number and text are sent from the caller's buffers,
+    // which must stay unchanged until the callback
+    bool sendSMS(const char* number, const char* text,
+                 CommandCallback callback = nullptr, void* context = nullptr);
+    bool makeCall(const char* number);  // true if queued; number is read when dialled
     void endCall();
     void setLowPowerMode(bool enable);
     NetworkStatus getNetworkStatus() const;
-    
+
+    // Generic queued command, a flash string (PSTR); false if the queue is
+    // full. PROMPT is only for AT+CMGS with a message body, so use
+    // sendSMS() for that.
+    bool sendCommand(PGM_P cmd, Response expect = Response::OK, uint16_t timeoutMs = 1000,
+                     CommandCallback callback = nullptr, void* context = nullptr);
+    bool isBusy() const { return _active || _queueCount; }
+
     // Callbacks
     void onSmsReceived(SmsCallback callback);
     void onCallEvent(CallCallback callback);
     void onNetworkChange(StatusCallback callback);
 
 private:
-    SoftwareSerial _serial;
+    static constexpr uint8_t NO_POWER_PIN = 0xFF;
+    static constexpr uint8_t QUEUE_SIZE = 4;     // the running command stays at the head
+    static constexpr uint8_t SMS_SLOTS = 1;      // SmsQueue feeds one message at a time
+    static constexpr uint8_t NO_SMS = 0xFF;
+    static constexpr uint8_t NUMBER_SIZE = 16;
+    static constexpr uint8_t INFO_SIZE = 16;     // "+CREG: 0,1", "+CMGS: 123"
+    static constexpr uint8_t MAX_BYTES_PER_UPDATE = 64;
+    static constexpr uint16_t SMS_TIMEOUT = 60000;   // +CMGS can take up to 60 s
+    static constexpr uint16_t CALL_GAP = 5000;       // let a call set up before the next command
+    static constexpr uint16_t CREG_POLL_REGISTERED = 30000;
+    static constexpr uint16_t CREG_POLL_SEARCHING = 5000;
+    static constexpr uint8_t MAX_TIMEOUTS = 3;       // then the modem counts as dead
+    static constexpr uint16_t RESTART_DELAY = 30000; // before power-cycling a dead modem
+
+    enum class Phase : uint8_t {
+        OFF,        // begin() not called yet
+        POWER_DOWN, // power pin low
+        POWER_UP,   // power pin high, waiting for the modem to boot
+        READY       // init commands queued, engine running
+    };
+
+    // The line is formatted when it is sent, so a queued command holds
+    // two pointers instead of its text
+    struct Command {
+        PGM_P format;             // flash; one %s for arg, if any
+        const char* arg;          // the caller's string, or nullptr
+        Response expect;
+        uint16_t timeoutMs;
+        uint16_t gapMs;           // idle time after completion
+        CommandCallback callback;
+        void* context;
+        uint8_t sms;              // SMS slot for AT+CMGS, or NO_SMS
+    };
+
+    struct Sms {
+        bool used;
+        const char* text;         // the caller's buffer, see sendSMS()
+    };
+
+    GsmSerial _serial;
     uint8_t _powerPin;
     NetworkStatus _status = NetworkStatus::DISCONNECTED;
     CallStatus _callStatus = CallStatus::NO_CALL;
     unsigned long _lastResponseTime = 0;
-    
+
+    // Engine state
+    Phase _phase = Phase::OFF;
+    unsigned long _holdUntil = 0;     // no command is sent before this
+    uint8_t _initStep = 0;
+    Command _queue[QUEUE_SIZE];
+    uint8_t _queueHead = 0;
+    uint8_t _queueCount = 0;
+    bool _active = false;
+    bool _promptSeen = false;
+    unsigned long _sentAt = 0;
+    uint8_t _timeouts = 0;
+    unsigned long _lastCregPoll = 0;
+    Sms _sms[SMS_SLOTS];
+
+    // Receive state
+    AtParser _parser;
+    char _info[INFO_SIZE];
+    char _smsFrom[NUMBER_SIZE];
+    bool _smsBodyNext = false;        // next line is the text of a +CMT
+
     SmsCallback _smsCallback = nullptr;
     CallCallback _callCallback = nullptr;
     StatusCallback _statusCallback = nullptr;
-    
-    String _readSerial(unsigned long timeout = 100);
-    String _sendATCommand(const char* cmd, const char* expected, unsigned long timeout, bool storeResponse = false);
-    void _processIncomingData(const String& data);
+
+    bool _enqueue(PGM_P format, const char* arg, Response expect, uint16_t timeoutMs, uint16_t gapMs,
+                  CommandCallback callback, void* context, uint8_t sms = NO_SMS);
+    Command& _current() { return _queue[_queueHead]; }    // while _active
+    void _startNext();
+    void _complete(bool success);
+    void _flushQueue();
+    void _receive(char c);
     void _changeStatus(NetworkStatus newStatus);
-    String _extractNumber(const String& data) const;
-    bool _waitForNetwork(unsigned long timeout);
-	bool _waitForResponse(const char* expected, unsigned long timeout);
+    void _parseCreg(const char* line, bool solicited);
+    static void _extractNumber(const char* data, char* number, size_t size);
+
+    static void _onAtReply(void* context, bool success, const char* info);
+    static void _onCregReply(void* context, bool success, const char* info);
+    static void _onCallReply(void* context, bool success, const char* info);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,118 @@
+#include "GsmSerial.h"
+#include <avr/interrupt.h>
+#include <util/delay_basic.h>
+
+GsmSerial* GsmSerial::_instance = nullptr;
+
+ISR(PCINT2_vect) {
+    GsmSerial::handleInterrupt();
+}
+
+static uint16_t _subtractCap(uint16_t value, uint16_t sub) {
+    // _delay_loop_2(0) would wait 65536 loops
+    return value > sub ? value - sub : 1;
+}
+
+GsmSerial::GsmSerial(uint8_t rxPin, uint8_t txPin)
+    : _rxPin(rxPin), _txPin(txPin) {}
+
+void GsmSerial::begin(long speed) {
+    _instance = this;
+    _txBit = digitalPinToBitMask(_txPin);
+    _txPort = portOutputRegister(digitalPinToPort(_txPin));
+    _rxBit = digitalPinToBitMask(_rxPin);
+    _rxPort = portInputRegister(digitalPinToPort(_rxPin));
+    digitalWrite(_txPin, HIGH);     // idle line
+    pinMode(_txPin, OUTPUT);
+    pinMode(_rxPin, INPUT_PULLUP);
+
+    // One bit in delay loops, less the cycles spent around each delay
+    // (the offsets SoftwareSerial uses for the same loop structure)
+    uint16_t bitDelay = (F_CPU / speed) / 4;
+    _txDelay = _subtractCap(bitDelay, 15 / 4);
+    _rxCentering = _subtractCap(bitDelay / 2, (4 + 4 + 75 + 17 - 23) / 4);
+    _rxIntrabit = _subtractCap(bitDelay, 23 / 4);
+    _rxStopbit = _subtractCap(bitDelay * 3 / 4, (37 + 11) / 4);
+
+    // PCINT16..23 are D0..D7; other pins would need another vector
+    if(_rxPin > 7) return;
+    uint8_t oldSREG = SREG;
+    noInterrupts();
+    PCMSK2 |= _rxBit;
+    PCIFR = 1 << PCIF2;     // drop a stale request
+    PCICR |= 1 << PCIE2;
+    SREG = oldSREG;
+}
+
+bool GsmSerial::overflow() {
+    bool dropped = _overflow;
+    _overflow = false;
+    return dropped;
+}
+
+int GsmSerial::available() {
+    return (uint8_t)(_tail - _head) & (RX_BUFFER_SIZE - 1);
+}
+
+int GsmSerial::read() {
+    if(_head == _tail) return -1;
+    uint8_t data = _buffer[_head];
+    _head = (_head + 1) & (RX_BUFFER_SIZE - 1);
+    return data;
+}
+
+int GsmSerial::peek() {
+    if(_head == _tail) return -1;
+    return _buffer[_head];
+}
+
+size_t GsmSerial::write(uint8_t byte) {
+    if(!_txPort) return 0;      // begin() not called
+
+    // An interrupt inside the frame would stretch a bit
+    uint8_t oldSREG = SREG;
+    noInterrupts();
+    *_txPort &= ~_txBit;        // start bit
+    _delay_loop_2(_txDelay);
+    for(uint8_t i = 0; i < 8; i++) {
+        if(byte & 1) *_txPort |= _txBit;
+        else *_txPort &= ~_txBit;
+        _delay_loop_2(_txDelay);
+        byte >>= 1;
+    }
+    *_txPort |= _txBit;         // stop bit
+    SREG = oldSREG;
+    _delay_loop_2(_txDelay);
+    return 1;
+}
+
+void GsmSerial::handleInterrupt() {
+    if(_instance) _instance->_receive();
+}
+
+void GsmSerial::_receive() {
+    // Only a falling edge starts a frame
+    if(*_rxPort & _rxBit) return;
+
+    // The data bits must not retrigger the vector
+    PCMSK2 &= ~_rxBit;
+    _delay_loop_2(_rxCentering);
+    uint8_t data = 0;
+    for(uint8_t i = 0; i < 8; i++) {
+        _delay_loop_2(_rxIntrabit);
+        data >>= 1;
+        if(*_rxPort & _rxBit) data |= 0x80;
+    }
+
+    uint8_t next = (_tail + 1) & (RX_BUFFER_SIZE - 1);
+    if(next != _head) {
+        _buffer[_tail] = data;
+        _tail = next;
+    } else {
+        _overflow = true;
+    }
+
+    // Skip to the middle of the stop bit so its edge does not count
+    _delay_loop_2(_rxStopbit);
+    PCMSK2 |= _rxBit;
+}
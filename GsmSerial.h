@@ -0,0 +1,55 @@
+#ifndef GSM_SERIAL_H
+#define GSM_SERIAL_H
+
+#include <Arduino.h>
+
+// Bit-banged 8N1 port for the SIM800. The stock SoftwareSerial defines all
+// three pin change vectors in one file, which clashes with EdgeCapture's
+// PCINT1_vect at link time; this port receives on a PORTD pin (D0..D7) and
+// claims PCINT2_vect only. Timing follows SoftwareSerial: a byte is read
+// inside the pin change ISR (about 1 ms at 9600 baud) and write() blocks
+// with interrupts off for one frame. One instance.
+class GsmSerial : public Stream {
+public:
+    static constexpr uint8_t RX_BUFFER_SIZE = 64;   // power of two
+
+    GsmSerial(uint8_t rxPin, uint8_t txPin);
+
+    void begin(long speed);
+    bool overflow();            // bytes were dropped; cleared by the call
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t byte) override;
+    using Print::write;
+    void flush() override {}
+
+    // From PCINT2_vect only
+    static void handleInterrupt();
+
+private:
+    uint8_t _rxPin;
+    uint8_t _txPin;
+    volatile uint8_t* _rxPort = nullptr;    // PIND
+    volatile uint8_t* _txPort = nullptr;    // PORTx of the TX pin
+    uint8_t _rxBit = 0;
+    uint8_t _txBit = 0;
+
+    // _delay_loop_2 counts (4 cycles each)
+    uint16_t _rxCentering = 0;
+    uint16_t _rxIntrabit = 0;
+    uint16_t _rxStopbit = 0;
+    uint16_t _txDelay = 0;
+
+    uint8_t _buffer[RX_BUFFER_SIZE];
+    volatile uint8_t _head = 0;         // next byte to read
+    volatile uint8_t _tail = 0;         // next free slot, only the ISR writes it
+    volatile bool _overflow = false;
+
+    static GsmSerial* _instance;
+
+    void _receive();
+};
+
+#endif
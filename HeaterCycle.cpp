@@ -0,0 +1,95 @@
+#include "HeaterCycle.h"
+
+HeaterCycle::HeaterCycle(byte pin) : _pin(pin) {}
+
+bool HeaterCycle::attach(SmokeSensor& sensor) {
+    if(_count >= MAX_SENSORS) return false;
+    sensor.setExternalHeater(true);
+    sensor.setSampleWindow(_sampleWindow);
+    _sensors[_count++] = &sensor;
+    return true;
+}
+
+void HeaterCycle::begin() {
+    pinMode(_pin, OUTPUT);
+    for(uint8_t i = 0; i < _count; i++) {
+        _sensors[i]->beginMeasurement();
+    }
+    _enter(Phase::HIGH_HEAT, SmokeSensor::SensorState::HEATING);
+}
+
+void HeaterCycle::stop() {
+    for(uint8_t i = 0; i < _count; i++) {
+        _sensors[i]->stopMeasurement();
+    }
+    digitalWrite(_pin, LOW);
+    _phase = Phase::OFF;
+}
+
+void HeaterCycle::update() {
+    // Sensors first, so the last reading of a window is in before it closes;
+    // with the heater off they still run a calibration
+    for(uint8_t i = 0; i < _count; i++) {
+        _sensors[i]->update();
+    }
+    if(_phase == Phase::OFF) return;
+
+    unsigned long elapsed = millis() - _phaseStart;
+    switch(_phase) {
+        case Phase::HIGH_HEAT:
+            if(elapsed >= _highSec * 1000UL) {
+                _enter(Phase::LOW_HEAT, SmokeSensor::SensorState::COOLING);
+            }
+            break;
+
+        case Phase::LOW_HEAT:
+            if(elapsed >= _lowSec * 1000UL - _sampleWindow) {
+                _enter(Phase::SAMPLING, SmokeSensor::SensorState::MEASURING);
+            }
+            break;
+
+        case Phase::SAMPLING:
+            if(elapsed >= _lowSec * 1000UL) {
+                _enter(Phase::HIGH_HEAT, SmokeSensor::SensorState::HEATING);
+            }
+            break;
+
+        default: break;
+    }
+}
+
+void HeaterCycle::setDurations(uint16_t highSec, uint16_t lowSec) {
+    _highSec = highSec;
+    _lowSec = lowSec;
+    if(_sampleWindow > lowSec * 1000UL) setSampleWindow(lowSec * 1000UL);
+}
+
+void HeaterCycle::setSampleWindow(uint16_t windowMs) {
+    _sampleWindow = min((unsigned long)windowMs, _lowSec * 1000UL);
+    for(uint8_t i = 0; i < _count; i++) {
+        _sensors[i]->setSampleWindow(_sampleWindow);
+    }
+}
+
+void HeaterCycle::onWindowClosed(WindowCallback callback, void* context) {
+    _windowCallback = callback;
+    _windowContext = context;
+}
+
+unsigned long HeaterCycle::getPhaseElapsed() const {
+    return _phase == Phase::OFF ? 0 : millis() - _phaseStart;
+}
+
+void HeaterCycle::_enter(Phase phase, SmokeSensor::SensorState state) {
+    // Sampling is the tail of the low phase: same duty, same timer
+    bool windowClosed = _phase == Phase::SAMPLING;
+    if(phase != Phase::SAMPLING) {
+        _phaseStart = millis();
+        analogWrite(_pin, phase == Phase::HIGH_HEAT ? HIGH_DUTY : LOW_DUTY);
+    }
+    _phase = phase;
+    for(uint8_t i = 0; i < _count; i++) {
+        _sensors[i]->heaterPhase(state);
+    }
+    if(windowClosed && _windowCallback) _windowCallback(_windowContext);
+}
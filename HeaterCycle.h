@@ -0,0 +1,59 @@
+#ifndef HEATER_CYCLE_H
+#define HEATER_CYCLE_H
+
+#include <Arduino.h>
+#include <SmokeSensor.h>
+
+// Heater of the MQ-7 sensors sharing one pin. Runs the datasheet profile,
+// 60 s at 5 V to burn off and 90 s at 1.4 V (PWM) to measure, and drives
+// the phases of the attached sensors so they all sample at the end of the
+// same low phase. The sensors' own timers and pin writes are switched off.
+class HeaterCycle {
+public:
+    static constexpr uint8_t MAX_SENSORS = 2;
+    static constexpr uint8_t HIGH_DUTY = 255;   // 5.0 V
+    static constexpr uint8_t LOW_DUTY = 71;     // 1.4 V
+
+    enum class Phase : uint8_t {
+        OFF,
+        HIGH_HEAT,
+        LOW_HEAT,
+        SAMPLING    // end of the low phase, sensors take their readings
+    };
+
+    // Called when a sampling window closes, after every sensor has its reading
+    typedef void (*WindowCallback)(void* context);
+
+    explicit HeaterCycle(byte pin);
+
+    bool attach(SmokeSensor& sensor);
+    void begin();   // Start the sensors and the first high phase
+    void stop();
+    void update();  // Sensors sample, then the phase advances
+
+    // Configuration, takes effect at the next phase
+    void setDurations(uint16_t highSec, uint16_t lowSec);
+    void setSampleWindow(uint16_t windowMs);
+    void onWindowClosed(WindowCallback callback, void* context);
+
+    Phase getPhase() const { return _phase; }
+    unsigned long getPhaseElapsed() const;
+    uint8_t getSensorCount() const { return _count; }
+
+private:
+    byte _pin;
+    SmokeSensor* _sensors[MAX_SENSORS];
+    uint8_t _count = 0;
+
+    Phase _phase = Phase::OFF;
+    unsigned long _phaseStart = 0;       // of the high or low phase
+    uint16_t _highSec = 60;
+    uint16_t _lowSec = 90;
+    uint16_t _sampleWindow = 8000;       // ms
+    WindowCallback _windowCallback = nullptr;
+    void* _windowContext = nullptr;
+
+    void _enter(Phase phase, SmokeSensor::SensorState state);
+};
+
+#endif
@@ -0,0 +1,109 @@
+#include "InputSampler.h"
+#include <avr/io.h>
+
+InputSampler::InputSampler(EdgeCapture& capture) : _capture(capture) {
+    for(uint8_t i = 0; i < LINES; i++) {
+        _edgeTime[i] = 0;
+        _changeTime[i] = 0;
+        _pulseTime[i] = 0;
+    }
+}
+
+bool InputSampler::watch(uint8_t pin) {
+    if(!_capture.watch(pin)) return false;
+    uint8_t bit = _bit(pin);
+    uint8_t port = PINC;
+    _mask |= bit;
+    _state = (_state & ~bit) | (port & bit);
+    _reported = (_reported & ~bit) | (port & bit);
+    _port = (_port & ~bit) | (port & bit);
+    return true;
+}
+
+void InputSampler::begin() {
+    _next = _capture.getHead();
+    _port = PINC;
+    _lastTick = millis();
+}
+
+void InputSampler::update() {
+    uint16_t now = millis();
+    uint8_t period = _period;
+    uint16_t due = (uint16_t)(now - _lastTick) / period;
+    if(!due) return;
+
+    // After a very long stall only the last ticks are worth replaying
+    if(due > MAX_REPLAY) {
+        _lastTick += (due - MAX_REPLAY) * period;
+        _replayUntil(_lastTick);
+        due = MAX_REPLAY;
+    }
+
+    // Missed ticks take the port level of their own time from the edges,
+    // the current one reads the port
+    while(due-- > 1) {
+        _lastTick += period;
+        _replayUntil(_lastTick);
+        _tick(_port);
+    }
+    _lastTick += period;
+    _replayUntil(now);
+    _tick(PINC);
+}
+
+void InputSampler::setSamplePeriod(uint8_t ms) {
+    _period = max(ms, (uint8_t)1);
+}
+
+bool InputSampler::fetch(uint8_t pin, bool& level, uint16_t& time) {
+    uint8_t bit = _bit(pin);
+    if(!(_changed & bit)) return false;
+    // Back at the reported level means it went and came back: the first
+    // call gives the pulse, the second the level it returned to
+    bool pulse = !((_state ^ _reported) & bit);
+    _reported ^= bit;
+    level = _reported & bit;
+    time = pulse ? _pulseTime[pin - A0] : _changeTime[pin - A0];
+    if(!pulse) _changed &= ~bit;
+    return true;
+}
+
+void InputSampler::_replayUntil(uint16_t time) {
+    EdgeCapture::Edge edge;
+    while(_next != _capture.getHead()) {
+        if(!_capture.read(_next, edge)) {
+            // Overwritten before it was read: carry on from the live port
+            _next = _capture.getHead();
+            _port = PINC;
+            return;
+        }
+        if((int16_t)(edge.time - time) > 0) return;
+        _next++;
+        _port = edge.port;
+        for(uint8_t i = 0; i < LINES; i++) {
+            if(edge.changed & (1 << i)) _edgeTime[i] = edge.time;
+        }
+    }
+}
+
+void InputSampler::_tick(uint8_t sample) {
+    // 2-bit vertical counters: where a line differs from its debounced
+    // state its counter steps 3, 2, 1, 0, where it agrees it goes back to
+    // 3; the step after 0 toggles the line
+    uint8_t delta = (sample ^ _state) & _mask;
+    _ct0 = ~(_ct0 & delta);
+    _ct1 = _ct0 ^ (_ct1 & delta);
+    uint8_t toggle = delta & _ct0 & _ct1;
+    if(!toggle) return;
+
+    // Back to the reported level with a change still unfetched: that
+    // change becomes the start of a pulse
+    uint8_t pulse = _changed & toggle & ~(_state ^ toggle ^ _reported);
+    _state ^= toggle;
+    _changed |= toggle;
+    for(uint8_t i = 0; i < LINES; i++) {
+        if(!(toggle & (1 << i))) continue;
+        if(pulse & (1 << i)) _pulseTime[i] = _changeTime[i];
+        _changeTime[i] = _edgeTime[i];
+    }
+}
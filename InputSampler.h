@@ -0,0 +1,61 @@
+#ifndef INPUT_SAMPLER_H
+#define INPUT_SAMPLER_H
+
+#include <Arduino.h>
+#include <EdgeCapture.h>
+
+// Debounces the digital inputs on A0..A5 together. Every tick takes one
+// PINC snapshot and runs it through 2-bit vertical counters, one bit-slice
+// per line, so a line changes state after SAMPLES equal samples in a row
+// whatever the others do. Ticks missed while the loop was blocked are
+// replayed from the EdgeCapture ring with the port level of their own time,
+// so the result is the same as with a timer-driven sampler.
+class InputSampler {
+public:
+    static constexpr uint8_t SAMPLES = 4;           // debounce = 4 ticks
+    static constexpr uint8_t MAX_REPLAY = 250;      // ticks caught up per update
+
+    explicit InputSampler(EdgeCapture& capture);
+
+    bool watch(uint8_t pin);            // A0..A5
+    void begin();
+    void update();                      // ticks that are due, call often
+
+    // Tick period (ms); a line settles after SAMPLES periods
+    void setSamplePeriod(uint8_t ms);
+    uint16_t getDebounceTime() const { return _period * SAMPLES; }
+
+    // Debounced levels, PINC bit order
+    uint8_t getState() const { return _state; }
+    bool read(uint8_t pin) const { return _state & _bit(pin); }
+
+    // Changes not yet taken by the pin's driver, oldest first, with the
+    // millis() (low 16 bits) of the edge that started each level. A pulse
+    // that came and went between two calls is returned as both of its levels.
+    bool fetch(uint8_t pin, bool& level, uint16_t& time);
+
+private:
+    static constexpr uint8_t LINES = 6;
+
+    EdgeCapture& _capture;
+    uint8_t _mask = 0;
+    uint8_t _state = 0;                 // debounced
+    uint8_t _reported = 0;              // as last returned by fetch()
+    uint8_t _changed = 0;               // toggled since the last fetch()
+    uint8_t _ct0 = 0xFF;                // vertical counter, low bits
+    uint8_t _ct1 = 0xFF;                // vertical counter, high bits
+    uint8_t _port = 0;                  // PINC as of the last edge read
+    uint8_t _next = 0;                  // next edge to read
+    uint8_t _period = 13;               // ms, ~50 ms debounce
+    // Times are millis(), low 16 bits: a stall is replayed up to 32 s back
+    uint16_t _lastTick = 0;
+    uint16_t _edgeTime[LINES];          // last raw edge per line
+    uint16_t _changeTime[LINES];        // edge that led to the debounced level
+    uint16_t _pulseTime[LINES];         // start of a pulse not yet fetched
+
+    static uint8_t _bit(uint8_t pin) { return EdgeCapture::isCapturable(pin) ? 1 << (pin - A0) : 0; }
+    void _replayUntil(uint16_t time);
+    void _tick(uint8_t sample);
+};
+
+#endif
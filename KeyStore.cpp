@@ -0,0 +1,203 @@
+#include "KeyStore.h"
+#include <EEPROM.h>
+#include <OneWire.h>
+#include <util/crc16.h>
+
+#define STORE_VERSION 0x4B  // first byte of the EEPROM block ('K')
+
+bool KeyStore::begin(uint16_t address) {
+    _address = address;
+    _recovered = false;
+    if(EEPROM.read(_address) != STORE_VERSION) {
+        // Erased, or another layout. The count is cleared so a cut during
+        // the first add cannot leave a stale count behind the new version.
+        _count = 0;
+        EEPROM.update(_address + 1, 0);
+        return false;
+    }
+
+    uint8_t count = EEPROM.read(_address + 1);
+    _count = count < MAX_KEYS ? count : MAX_KEYS;
+    if(_checksum() != EEPROM.read(_crcAddress())) {
+        _recovered = true;
+        _recover();
+    }
+    return true;
+}
+
+bool KeyStore::contains(const uint8_t* key) const {
+    return isValidKey(key) && _find(key + 1) < MAX_KEYS;
+}
+
+KeyStore::Result KeyStore::add(const uint8_t* key) {
+    if(!isValidKey(key)) return Result::BAD_KEY;
+    if(_find(key + 1) < MAX_KEYS) return Result::EXISTS;
+    if(_count >= MAX_KEYS) return Result::FULL;
+
+    // Past the count, so a cut here leaves the store as it was
+    _writeRecord(_count, key);
+    _count++;
+    _save();
+    return Result::OK;
+}
+
+KeyStore::Result KeyStore::remove(const uint8_t* key) {
+    if(!isValidKey(key)) return Result::BAD_KEY;
+    uint8_t slot = _find(key + 1);
+    if(slot >= MAX_KEYS) return Result::NOT_FOUND;
+
+    // The last record fills the hole so the table stays packed. A cut
+    // before the count is written leaves it twice or the hole torn, which
+    // begin() sorts out. The vacated record's ROM CRC is broken before the
+    // commit, so the rebuild in _recover() cannot bring back a removed key
+    // that sat in the last slot.
+    _count--;
+    if(slot != _count) {
+        for(uint8_t i = 0; i < RECORD_SIZE; i++) {
+            EEPROM.update(_recordAddress(slot) + i, EEPROM.read(_recordAddress(_count) + i));
+        }
+    }
+    uint16_t romCrc = _recordAddress(_count) + RECORD_SIZE - 1;
+    EEPROM.update(romCrc, ~EEPROM.read(romCrc));
+    _save();
+    return Result::OK;
+}
+
+void KeyStore::getKey(uint8_t index, uint8_t* key) const {
+    if(index < _count) {
+        _readRecord(index, key);
+    } else {
+        memset(key, 0, 8);
+    }
+}
+
+void KeyStore::printKeys(Print& out) const {
+    uint8_t key[8];
+    for(uint8_t k = 0; k < _count; k++) {
+        getKey(k, key);
+        out.print(k + 1);
+        out.print(' ');
+        for(uint8_t i = 0; i < 8; i++) {
+            if(key[i] < 0x10) out.print('0');
+            out.print(key[i], HEX);
+            if(i < 7) out.print(':');
+        }
+        out.println();
+    }
+}
+
+void KeyStore::formatKeys(char* buffer, size_t size) const {
+    size_t len = snprintf_P(buffer, size, PSTR("KEYS %u"), _count);
+    uint8_t key[8];
+    for(uint8_t k = 0; k < _count; k++) {
+        if(len + 1 + SERIAL_SIZE * 2 >= size) break;
+        getKey(k, key);
+        buffer[len++] = ' ';
+        for(uint8_t i = 1; i <= SERIAL_SIZE; i++) {
+            len += snprintf_P(buffer + len, size - len, PSTR("%02X"), key[i]);
+        }
+    }
+}
+
+bool KeyStore::parseKey(const char* text, uint8_t* key) {
+    uint8_t digits = 0;
+    uint8_t bytes[8] = {0};
+    for(; *text; text++) {
+        char c = *text;
+        if(c == ':' || c == '-' || c == ' ') continue;
+        uint8_t nibble;
+        if(c >= '0' && c <= '9') nibble = c - '0';
+        else if(c >= 'A' && c <= 'F') nibble = c - 'A' + 10;
+        else if(c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+        else return false;
+        if(digits >= 16) return false;
+        bytes[digits / 2] = (bytes[digits / 2] << 4) | nibble;
+        digits++;
+    }
+
+    if(digits == 16) {
+        memcpy(key, bytes, 8);
+    } else if(digits == SERIAL_SIZE * 2) {
+        key[0] = FAMILY;
+        memcpy(key + 1, bytes, SERIAL_SIZE);
+        key[7] = OneWire::crc8(key, 7);
+    } else {
+        return false;
+    }
+    return isValidKey(key);
+}
+
+bool KeyStore::isValidKey(const uint8_t* key) {
+    return key[0] == FAMILY && OneWire::crc8(key, 7) == key[7];
+}
+
+uint8_t KeyStore::_find(const uint8_t* serial) const {
+    for(uint8_t slot = 0; slot < _count; slot++) {
+        if(_matches(slot, serial)) return slot;
+    }
+    return MAX_KEYS;
+}
+
+bool KeyStore::_matches(uint8_t slot, const uint8_t* serial) const {
+    for(uint8_t i = 0; i < SERIAL_SIZE; i++) {
+        if(EEPROM.read(_recordAddress(slot) + i) != serial[i]) return false;
+    }
+    return true;
+}
+
+bool KeyStore::_readRecord(uint8_t slot, uint8_t* key) const {
+    key[0] = FAMILY;
+    for(uint8_t i = 0; i < RECORD_SIZE; i++) {
+        key[1 + i] = EEPROM.read(_recordAddress(slot) + i);
+    }
+    return isValidKey(key);
+}
+
+void KeyStore::_writeRecord(uint8_t slot, const uint8_t* key) {
+    // Serial first, ROM CRC last: a torn record fails its CRC
+    for(uint8_t i = 0; i < RECORD_SIZE; i++) {
+        EEPROM.update(_recordAddress(slot) + i, key[1 + i]);
+    }
+}
+
+void KeyStore::_recover() {
+    // An add cut before its count: the block CRC is already for one more
+    uint8_t crc = EEPROM.read(_crcAddress());
+    if(_count < MAX_KEYS) {
+        _count++;
+        if(_checksum() == crc) {
+            EEPROM.update(_address + 1, _count);
+            return;
+        }
+        _count--;
+    }
+
+    // Otherwise a remove was cut: keep every record whose ROM CRC checks,
+    // once, packed, and commit again
+    uint8_t count = _count;
+    uint8_t key[8];
+    _count = 0;
+    for(uint8_t slot = 0; slot < count; slot++) {
+        if(!_readRecord(slot, key) || _find(key + 1) < MAX_KEYS) continue;
+        if(slot != _count) _writeRecord(_count, key);
+        _count++;
+    }
+    _save();
+}
+
+void KeyStore::_save() {
+    // The CRC for the new count goes before the count; see _recover()
+    EEPROM.update(_address, STORE_VERSION);
+    EEPROM.update(_crcAddress(), _checksum());
+    EEPROM.update(_address + 1, _count);
+}
+
+uint8_t KeyStore::_checksum() const {
+    // Version, count and the records in use
+    uint8_t crc = _crc8_ccitt_update(0, STORE_VERSION);
+    crc = _crc8_ccitt_update(crc, _count);
+    for(uint16_t i = 0; i < _count * RECORD_SIZE; i++) {
+        crc = _crc8_ccitt_update(crc, EEPROM.read(_recordAddress(0) + i));
+    }
+    return crc;
+}
@@ -0,0 +1,68 @@
+#ifndef KEY_STORE_H
+#define KEY_STORE_H
+
+#include <Arduino.h>
+
+// Authorized iButton keys, kept in EEPROM as
+// [version][count][MAX_KEYS x (6-byte serial, ROM CRC)][CRC-8]. Only DS1990A
+// keys (family 0x01) are accepted, so the family byte is not stored. The
+// serials stay in EEPROM and a lookup scans them there, stopping at the
+// first byte that differs; RAM only holds the count.
+//
+// A change writes the records first, then the block CRC for the new count,
+// then the count. After a power cut the block either still checks, checks
+// with one more key (an add whose count was not written), or is rebuilt
+// from the records whose ROM CRC checks.
+class KeyStore {
+public:
+    static constexpr uint8_t MAX_KEYS = 64;
+    static constexpr uint8_t FAMILY = 0x01;             // DS1990A
+    static constexpr uint8_t SERIAL_SIZE = 6;
+    static constexpr uint8_t RECORD_SIZE = SERIAL_SIZE + 1;    // serial, ROM CRC
+    static constexpr uint16_t STORE_SIZE = 2 + MAX_KEYS * RECORD_SIZE + 1;
+
+    enum class Result : uint8_t {
+        OK,
+        EXISTS,
+        FULL,
+        NOT_FOUND,
+        BAD_KEY     // wrong family or ROM CRC
+    };
+
+    // false if the block holds no key store at all; the store is then
+    // empty. A torn block is repaired and still counts as stored.
+    bool begin(uint16_t address);
+    bool wasRecovered() const { return _recovered; }
+
+    // 8-byte ROMs as read from the reader
+    bool contains(const uint8_t* key) const;
+    Result add(const uint8_t* key);
+    Result remove(const uint8_t* key);
+
+    uint8_t getCount() const { return _count; }
+    void getKey(uint8_t index, uint8_t* key) const;
+    void printKeys(Print& out) const;
+    // "KEYS 2 668427550000 45E813000000", as many serials as fit
+    void formatKeys(char* buffer, size_t size) const;
+
+    // "01:66:84:27:55:00:00:20", 16 hex digits, or the 12-digit serial
+    static bool parseKey(const char* text, uint8_t* key);
+    static bool isValidKey(const uint8_t* key);
+
+private:
+    uint16_t _address = 0;
+    uint8_t _count = 0;
+    bool _recovered = false;
+
+    uint16_t _recordAddress(uint8_t slot) const { return _address + 2 + slot * RECORD_SIZE; }
+    uint16_t _crcAddress() const { return _address + STORE_SIZE - 1; }
+    uint8_t _find(const uint8_t* serial) const;     // slot, or MAX_KEYS
+    bool _matches(uint8_t slot, const uint8_t* serial) const;
+    bool _readRecord(uint8_t slot, uint8_t* serial) const;     // false if its CRC fails
+    void _writeRecord(uint8_t slot, const uint8_t* serial);
+    void _recover();
+    void _save();
+    uint8_t _checksum() const;
+};
+
+#endif
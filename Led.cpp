@@ -1,7 +1,6 @@
 #include "Led.h"
 
-Led::Led(uint8_t pin, uint16_t shortOn, uint16_t shortOff, uint16_t longOn, uint16_t longOff) 
-    : _pin(pin), _shortBlinkOn(shortOn), _shortBlinkOff(shortOff), _longBlinkOn(longOn), _longBlinkOff(longOff) {}
+Led::Led(uint8_t pin) : _pin(pin) {}
 
 void Led::begin() {
     pinMode(_pin, OUTPUT);
@@ -38,7 +37,7 @@ uint8_t Led::getPin() const {
 
 void Led::shortBlink() {
     unsigned long now = millis();
-    uint16_t duration = _state ? _shortBlinkOn : _shortBlinkOff;
+    uint16_t duration = _state ? SHORT_BLINK_ON : SHORT_BLINK_OFF;
     if (now - _lastBlinkTime >= duration) {
         toggle();
         _lastBlinkTime = now;
@@ -47,23 +46,13 @@ void Led::shortBlink() {
 
 void Led::longBlink() {
     unsigned long now = millis();
-    uint16_t duration = _state ? _longBlinkOn : _longBlinkOff;
+    uint16_t duration = _state ? LONG_BLINK_ON : LONG_BLINK_OFF;
     if (now - _lastBlinkTime >= duration) {
         toggle();
         _lastBlinkTime = now;
     }
 }
 
-void Led::setShortBlink(uint16_t onTime, uint16_t offTime) {
-    _shortBlinkOn = onTime;
-    _shortBlinkOff = offTime;
-}
-
-void Led::setLongBlink(uint16_t onTime, uint16_t offTime) {
-    _longBlinkOn = onTime;
-    _longBlinkOff = offTime;
-}
-
 void Led::blink(uint16_t interval, uint16_t offTime, uint8_t count) {
     // Handle all cases in one method
     if (count > 0) {
@@ -5,7 +5,11 @@
 
 class Led {
 public:
-    Led(uint8_t pin, uint16_t shortOn = 200, uint16_t shortOff = 600, uint16_t longOn = 400, uint16_t longOff = 1500);
+    // shortBlink() and longBlink() timings (ms)
+    static constexpr uint16_t SHORT_BLINK_ON = 200, SHORT_BLINK_OFF = 600;
+    static constexpr uint16_t LONG_BLINK_ON = 400, LONG_BLINK_OFF = 1500;
+
+    explicit Led(uint8_t pin);
     void begin();
     void on();
     void off();
@@ -15,8 +19,6 @@ public:
     uint8_t getPin() const;
     void shortBlink();
     void longBlink();
-    void setShortBlink(uint16_t onTime, uint16_t offTime);
-    void setLongBlink(uint16_t onTime, uint16_t offTime);
     void blink(uint16_t interval, uint16_t offTime = 0, uint8_t count = 0);
     void stopBlinking();
 	void set(bool state) {
@@ -28,7 +30,6 @@ private:
     uint8_t _pin;
     bool _state;
     unsigned long _lastBlinkTime = 0;
-    uint16_t _shortBlinkOn, _shortBlinkOff, _longBlinkOn, _longBlinkOff;
 	uint8_t _remainingBlinks = 0;
 };
 
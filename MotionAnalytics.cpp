@@ -0,0 +1,67 @@
+#include "MotionAnalytics.h"
+
+void MotionAnalytics::setRule(uint8_t pulses, uint16_t windowSec) {
+    _required = constrain(pulses, 1, HISTORY);
+    _windowSec = windowSec;
+}
+
+void MotionAnalytics::reset() {
+    _count = 0;
+    _perimeterSeen = false;
+    _pending = false;
+    _reason = Reason::NONE;
+}
+
+MotionAnalytics::Verdict MotionAnalytics::addPulse(unsigned long time) {
+    _pulses[_head] = time;
+    _head = (_head + 1) & (HISTORY - 1);
+    if(_count < HISTORY) _count++;
+    _activeSince = time;
+
+    if(getPulseCount(time) >= _required) return _confirm(Reason::PULSES);
+    if(_perimeterSeen && time - _perimeter <= _correlationSec * 1000UL) return _confirm(Reason::PERIMETER);
+
+    if(!_pending) {
+        _pending = true;
+        _pendingSince = time;
+    }
+    return Verdict::PENDING;
+}
+
+MotionAnalytics::Verdict MotionAnalytics::addPerimeter(unsigned long time) {
+    _perimeter = time;
+    _perimeterSeen = true;
+    // Motion first, then the door: someone inside is leaving
+    if(_pending && time - _activeSince <= _correlationSec * 1000UL) return _confirm(Reason::PERIMETER);
+    return Verdict::NONE;
+}
+
+MotionAnalytics::Verdict MotionAnalytics::evaluate(unsigned long now, bool active) {
+    if(!_pending) return Verdict::NONE;
+    if(active) {
+        // Someone moving about keeps a retriggering PIR high: one long pulse
+        if(now - _activeSince >= _sustainSec * 1000UL) return _confirm(Reason::SUSTAINED);
+        return Verdict::PENDING;
+    }
+    if(now - _pendingSince > _windowSec * 1000UL) {
+        _pending = false;
+        return Verdict::DISMISSED;
+    }
+    return Verdict::PENDING;
+}
+
+uint8_t MotionAnalytics::getPulseCount(unsigned long now) const {
+    uint8_t count = 0;
+    for(uint8_t i = 0; i < _count; i++) {
+        unsigned long time = _pulses[(_head - 1 - i) & (HISTORY - 1)];
+        if(now - time > _windowSec * 1000UL) break;
+        count++;
+    }
+    return count;
+}
+
+MotionAnalytics::Verdict MotionAnalytics::_confirm(Reason reason) {
+    _pending = false;
+    _reason = reason;
+    return Verdict::CONFIRMED;
+}
@@ -0,0 +1,64 @@
+#ifndef MOTION_ANALYTICS_H
+#define MOTION_ANALYTICS_H
+
+#include <Arduino.h>
+
+// Intrusion decision from the PIR. A single pulse (sunlight, a heater
+// switching, an insect on the lens) is held back: it only becomes an
+// intrusion when more pulses follow within the window, when the PIR stays
+// triggered, or when the door or gate opened around the same time. A lone
+// pulse that stays alone is dismissed. Times are millis().
+class MotionAnalytics {
+public:
+    static constexpr uint8_t HISTORY = 4;           // pulses kept, power of two; most a rule can ask
+
+    enum class Verdict : uint8_t {
+        NONE,
+        PENDING,    // lone pulse, waiting for confirmation
+        CONFIRMED,
+        DISMISSED   // lone pulse that was not confirmed in time
+    };
+
+    enum class Reason : uint8_t {
+        NONE,
+        PULSES,     // enough pulses in the window
+        SUSTAINED,  // PIR held active
+        PERIMETER   // door or gate opened around the pulse
+    };
+
+    // Configuration
+    void setRule(uint8_t pulses, uint16_t windowSec);
+    void setSustainTime(uint16_t sec) { _sustainSec = sec; }
+    void setCorrelationWindow(uint16_t sec) { _correlationSec = sec; }
+
+    Verdict addPulse(unsigned long time);
+    Verdict addPerimeter(unsigned long time);   // door or gate opened
+    Verdict evaluate(unsigned long now, bool active);
+    void reset();
+
+    // Results
+    bool isPending() const { return _pending; }
+    Reason getReason() const { return _reason; }
+    uint8_t getPulseCount(unsigned long now) const;     // within the window
+
+private:
+    unsigned long _pulses[HISTORY];
+    uint8_t _head = 0;                  // next write position
+    uint8_t _count = 0;
+    unsigned long _perimeter = 0;       // last door/gate opening
+    bool _perimeterSeen = false;
+    bool _pending = false;
+    unsigned long _pendingSince = 0;    // first unconfirmed pulse
+    unsigned long _activeSince = 0;     // latest pulse
+
+    uint8_t _required = 2;
+    uint16_t _windowSec = 30;
+    uint16_t _sustainSec = 10;
+    uint16_t _correlationSec = 30;
+
+    Reason _reason = Reason::NONE;
+
+    Verdict _confirm(Reason reason);
+};
+
+#endif
@@ -13,19 +13,19 @@ bool MovingSensor::readSensor() {
     return digitalRead(_pin) == _activeLevel;
 }
 
-bool MovingSensor::applySensitivity(bool rawState) {
+bool MovingSensor::applySensitivity(bool rawState, unsigned long time) {
     if(!rawState) return false;
     
     switch(_sensitivity) {
         case Sensitivity::LOWSENS:
             // Only trigger if no recent detections (3 seconds)
-            return (seconds() - _lastDetectionTime > 3); 
+            return (time - _lastDetectionTime > 3000); 
         case Sensitivity::HIGHSENS:
             // Always trigger on detection
             return true; 
         default: // MEDIUM
             // Trigger unless very recent detection (1 second)
-            return (seconds() - _lastDetectionTime > 1);
+            return (time - _lastDetectionTime > 1000);
     }
 }
 
@@ -39,18 +39,21 @@ void MovingSensor::handleDetection(bool detected) {
 }
 
 bool MovingSensor::update() {
+    if(_input) return updateFromInput();
+
+    unsigned long now = millis();
     bool rawState = readSensor();
-    bool processedState = applySensitivity(rawState);
+    bool processedState = applySensitivity(rawState, now);
     
     // Debounce logic
     if(processedState != _lastStableState) {
-        _lastDebounceTime = seconds();
+        _lastDebounceTime = now;
     }
     
-    if(seconds() - _lastDebounceTime > _debounceDelay) {
+    if(now - _lastDebounceTime > _debounceDelay * 1000UL) {
         if(processedState != _state) {
             _state = processedState;
-            if(_state) _lastDetectionTime = seconds();
+            if(_state) _lastDetectionTime = now;
             handleDetection(_state);
             return true;
         }
@@ -60,10 +63,37 @@ bool MovingSensor::update() {
     return false;
 }
 
+bool MovingSensor::updateFromInput() {
+    // The sampler has already debounced the pin, so every change it returns
+    // is a real change of the PIR output, even one that ended before now
+    bool changed = false;
+    bool level;
+    uint16_t time;
+    while(_input->fetch(_pin, level, time)) {
+        // The edge may be from a while back if loop() was blocked
+        unsigned long now = millis();
+        unsigned long at = now - (uint16_t)((uint16_t)now - time);
+        bool processedState = applySensitivity(level == _activeLevel, at);
+        if(processedState == _state) continue;
+        _state = processedState;
+        if(_state) _lastDetectionTime = at;
+        handleDetection(_state);
+        _lastStableState = _state;
+        changed = true;
+    }
+    return changed;
+}
+
+bool MovingSensor::attachInput(InputSampler& input) {
+    if(!input.watch(_pin)) return false;
+    _input = &input;
+    return true;
+}
+
 bool MovingSensor::isMotionDetected() {
     update();
     return _state && (_detectionMode == DetectionMode::PULSE || 
-                     (seconds() - _lastDetectionTime <= _holdDuration));
+                     (millis() - _lastDetectionTime <= _holdDuration * 1000UL));
 }
 
 bool MovingSensor::isActive() const {
@@ -71,11 +101,11 @@ bool MovingSensor::isActive() const {
 }
 
 unsigned long MovingSensor::getLastDetectionTime() const {
-    return _lastDetectionTime;
+    return _lastDetectionTime / 1000;
 }
 
 unsigned long MovingSensor::getInactiveDuration() const {
-    return _state ? 0 : seconds() - _lastDetectionTime;
+    return _state ? 0 : (millis() - _lastDetectionTime) / 1000;
 }
 
 void MovingSensor::setDebounceDelay(uint16_t delay) {
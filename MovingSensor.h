@@ -2,18 +2,19 @@
 #define MY_MOVINGSENSOR_H
 
 #include <Arduino.h>
+#include <InputSampler.h>
 
 class MovingSensor {
 public:
     // Sensitivity levels for motion detection
-    enum class Sensitivity {
+    enum class Sensitivity : uint8_t {
         LOWSENS,      // Minimal sensitivity (fewer false positives)
         MEDIUMSENS,   // Balanced sensitivity/reliability
         HIGHSENS      // Maximum sensitivity (detects all movement)
     };
 
     // Detection behavior modes
-    enum class DetectionMode {
+    enum class DetectionMode : uint8_t {
         PULSE,    // Brief trigger on movement
         HOLD      // Sustained output during movement
     };
@@ -23,19 +24,20 @@ private:
     bool _state;                   // Current debounced state
     bool _lastStableState;         // Previous confirmed state
     bool _activeLevel;             // Active-high or active-low sensor
-    unsigned long _lastDetectionTime = 0;  // Last valid detection timestamp (seconds)
-    unsigned long _lastDebounceTime = 0;   // Debounce timer (seconds)
+    unsigned long _lastDetectionTime = 0;  // Last valid detection timestamp (ms)
+    unsigned long _lastDebounceTime = 0;   // Debounce timer (ms)
     uint16_t _debounceDelay = 1;   // Seconds to wait for stable signal
     uint16_t _holdDuration = 5;    // How long to maintain HOLD state (seconds)
     Sensitivity _sensitivity = Sensitivity::MEDIUMSENS;
     DetectionMode _detectionMode = DetectionMode::HOLD;
     void (*_onDetectCallback)() = nullptr;  // Movement detected callback
     void (*_onEndCallback)() = nullptr;     // Movement ended callback
+    InputSampler* _input = nullptr;        // Shared debounced inputs, if attached
     
     bool readSensor();
-    bool applySensitivity(bool rawState);
+    bool applySensitivity(bool rawState, unsigned long time);
     void handleDetection(bool detected);
-    unsigned long seconds() { return millis() / 1000; } // Helper function
+    bool updateFromInput();
 
 public:
     explicit MovingSensor(byte pin, bool activeLevel = HIGH);
@@ -44,7 +46,8 @@ public:
     void begin();                          // Initialize hardware
     bool isMotionDetected();               // Check current motion state
     bool isActive() const;                 // Get current active state
-    unsigned long getLastDetectionTime() const; // Get last detection timestamp
+    unsigned long getLastDetectionTime() const; // Get last detection timestamp (seconds)
+    unsigned long getLastDetectionMillis() const { return _lastDetectionTime; }
     unsigned long getInactiveDuration() const;  // Get seconds since last detection
     
     // Configuration
@@ -54,6 +57,9 @@ public:
     void setActiveLevel(bool level);       // Set active-high/low mode
     void setDetectionMode(DetectionMode mode); // Set detection behavior
     
+    // Debounced by the InputSampler instead of polling, for pins A0..A5
+    bool attachInput(InputSampler& input);
+
     // State management
     bool update(); // Update state, returns true if changed
     
@@ -1,133 +1,310 @@
 #include "MultiDS18B20.h"
 #include <Arduino.h>
+#include <EEPROM.h>
+#include <avr/pgmspace.h>
+#include <util/crc16.h>
 
-MultiDS18B20::MultiDS18B20(uint8_t pin) 
-    : _oneWire(pin), _sensors(&_oneWire) {}
+#define MAP_VERSION 1       // first byte of the EEPROM map
 
-void MultiDS18B20::begin() {
-    _sensors.begin();
+static const char _locationNames[MultiDS18B20::MAX_PROBES][4] PROGMEM = {
+    "Gar", "Out", "Att", "Frz", "P5", "P6", "P7", "P8"
+};
+
+MultiDS18B20::MultiDS18B20(uint8_t pin)
+    : _oneWire(pin), _sensors(&_oneWire) {
+    for(uint8_t i = 0; i < MAX_PROBES; i++) {
+        _raw[i] = NOT_READ;
+    }
+}
+
+void MultiDS18B20::begin(uint16_t mapAddress) {
+    _mapAddress = mapAddress;
     _sensors.setWaitForConversion(false); // Enable async mode
-    discoverSensors();
+
+    // Every stored probe answering by address is enough, no search needed.
+    // Probes must be externally powered: parasite mode is only detected by
+    // the search in DallasTemperature::begin().
+    if(_loadMap() && _verifyMap()) {
+        Serial.print(F("DS18B20 map: "));
+        Serial.println(getProbeCount());
+        setResolution(_resolution);
+    } else {
+        discoverSensors();
+    }
 }
 
 void MultiDS18B20::update() {
     unsigned long currentMillis = millis();
-    
-    // Time for new reading request
-    if(currentMillis - _lastRequestTime >= _requestInterval) {
-        requestTemperatures();
-        _lastRequestTime = currentMillis;
-    }
-    
-    // Process completed conversion
-    if(_sensors.isConversionComplete()) {
-        if(_garageFound) {
-            _garageTemp = _sensors.getTempC(_garageAddr);
-            if(_tempCallback) _tempCallback("Gar", _garageTemp);
-        }
-        
-        if(_outdoorFound) {
-            _outdoorTemp = _sensors.getTempC(_outdoorAddr);
-            if(_tempCallback) _tempCallback("Out", _outdoorTemp);
-        }
-        
-        // Restart conversion
-        requestTemperatures();
+
+    switch(_state) {
+        case State::IDLE:
+            // First conversion right away, then one per interval
+            if(!_requested || currentMillis - _lastRequestTime >= _requestInterval) {
+                requestTemperatures();
+            }
+            break;
+
+        case State::CONVERTING:
+            // Timed from the resolution instead of polling the bus
+            if(currentMillis - _lastRequestTime >= _conversionTime) {
+                _state = State::READING;
+                _readIndex = 0;
+            }
+            break;
+
+        case State::READING:
+            // One probe per call keeps each pass to a single scratchpad read
+            while(_readIndex < MAX_PROBES && !(_assigned & (1 << _readIndex))) {
+                _readIndex++;
+            }
+            if(_readIndex >= MAX_PROBES) {
+                _state = State::IDLE;
+                break;
+            }
+            {
+                uint8_t location = _readIndex++;
+                uint8_t addr[8];
+                _readRom(location, addr);
+                int32_t raw = _sensors.getTemp(addr);
+                _raw[location] = raw;
+                if(raw <= DEVICE_DISCONNECTED_RAW) {
+                    _failed |= 1 << location;
+                } else {
+                    _failed &= ~(1 << location);
+                }
+                if(_tempCallback) _tempCallback(location, getTemp(location));
+            }
+            break;
     }
 }
 
 void MultiDS18B20::requestTemperatures() {
+    // CONVERT T after skip ROM: every probe converts at once
     _sensors.requestTemperatures();
+    _lastRequestTime = millis();
+    _requested = true;
+    _state = State::CONVERTING;
+}
+
+void MultiDS18B20::setResolution(uint8_t bits) {
+    _resolution = constrain(bits, 9, 12);
+    _conversionTime = DallasTemperature::millisToWaitForConversion(_resolution);
+    // By address: without a search the library does not know the probes
+    uint8_t addr[8];
+    for(uint8_t i = 0; i < MAX_PROBES; i++) {
+        if(getAddress(i, addr)) _sensors.setResolution(addr, _resolution);
+    }
+}
+
+void MultiDS18B20::setRequestInterval(unsigned long interval) {
+    _requestInterval = interval;
+}
+
+float MultiDS18B20::getTemp(uint8_t location) const {
+    if(location >= MAX_PROBES || _raw[location] == NOT_READ) {
+        return DEVICE_DISCONNECTED_C;
+    }
+    return DallasTemperature::rawToCelsius(_raw[location]);
 }
 
-float MultiDS18B20::getGarageTemp() const {
-    return _garageTemp;
+bool MultiDS18B20::isAssigned(uint8_t location) const {
+    return location < MAX_PROBES && (_assigned & (1 << location));
 }
 
-float MultiDS18B20::getOutdoorTemp() const {
-    return _outdoorTemp;
+bool MultiDS18B20::getAddress(uint8_t location, uint8_t* addr) const {
+    if(!isAssigned(location)) return false;
+    _readRom(location, addr);
+    return true;
 }
 
-bool MultiDS18B20::setSensorAddress(const char* location, const uint8_t* addr) {
-    if(strcmp(location, "Gar") == 0) {
-        memcpy(_garageAddr, addr, 8);
-        _garageFound = true;
-        return true;
+uint8_t MultiDS18B20::getProbeCount() const {
+    uint8_t count = 0;
+    for(uint8_t bits = _assigned; bits; bits &= bits - 1) {
+        count++;
     }
-    else if(strcmp(location, "Out") == 0) {
-        memcpy(_outdoorAddr, addr, 8);
-        _outdoorFound = true;
-        return true;
+    return count;
+}
+
+uint8_t MultiDS18B20::findLocation(const uint8_t* addr) const {
+    for(uint8_t i = 0; i < MAX_PROBES; i++) {
+        if(!(_assigned & (1 << i))) continue;
+        uint8_t j = 0;
+        while(j < 8 && EEPROM.read(_romAddress(i) + j) == addr[j]) j++;
+        if(j == 8) return i;
+    }
+    return NO_LOCATION;
+}
+
+const char* MultiDS18B20::getLocationName(uint8_t location) {
+    return _locationNames[location < MAX_PROBES ? location : 0];
+}
+
+bool MultiDS18B20::setSensorAddress(uint8_t location, const uint8_t* addr) {
+    if(location >= MAX_PROBES || OneWire::crc8(addr, 7) != addr[7]) {
+        return false;
+    }
+    // A ROM lives at one location only
+    uint8_t previous = findLocation(addr);
+    if(previous != NO_LOCATION && previous != location) {
+        clearSensor(previous);
+    }
+    _assign(location, addr);
+    _sensors.setResolution(addr, _resolution);
+    _saveMap();
+    return true;
+}
+
+void MultiDS18B20::clearSensor(uint8_t location) {
+    if(location >= MAX_PROBES) return;
+    for(uint8_t j = 0; j < 8; j++) {
+        EEPROM.update(_romAddress(location) + j, 0);
     }
-    return false;
+    _assigned &= ~(1 << location);
+    _failed &= ~(1 << location);
+    _raw[location] = NOT_READ;
+    _saveMap();
 }
 
 void MultiDS18B20::setTemperatureCallback(TemperatureCallback callback) {
     _tempCallback = callback;
 }
 
-void MultiDS18B20::discoverSensors() {
-    Serial.println("Scan DS18B20");
+uint8_t MultiDS18B20::discoverSensors() {
+    Serial.println(F("Scan DS18B20"));
+    _sensors.begin();
     int deviceCount = _sensors.getDeviceCount();
-    
+
     if(deviceCount == 0) {
-        Serial.println("No found!");
-        return;
-    }
-    
-    Serial.print("Found ");
-    Serial.print(deviceCount);
-    Serial.println(" sen");
-    
+        Serial.println(F("No found!"));
+    }
+
+    // Stored probes that are not on the bus keep their location, they may
+    // be unplugged for a while; clearSensor() frees it for good
+    uint8_t present = 0;
+    uint8_t added = 0;
     uint8_t addr[8];
     for(int i = 0; i < deviceCount; i++) {
-        if(_sensors.getAddress(addr, i)) {
-            Serial.print("Sensor ");
-            Serial.print(i + 1);
-            Serial.print(": ");
-            printAddress(addr);
-            
-            // Auto-assign first sensor as Garage
-            if(!_garageFound) {
-                setSensorAddress("Garage", addr);
-                Serial.println(" (As as Gar)");
-            } 
-            // Second as Outdoor
-            else if(!_outdoorFound) {
-                setSensorAddress("Outdoor", addr);
-                Serial.println(" (As as Out)");
+        if(!_sensors.getAddress(addr, i)) continue;
+        Serial.print(F("Sensor "));
+        printAddress(Serial, addr);
+
+        uint8_t location = findLocation(addr);
+        if(location == NO_LOCATION) {
+            for(location = 0; location < MAX_PROBES && (_assigned & (1 << location)); location++);
+            if(location == MAX_PROBES) {
+                Serial.println(F(" (no slot)"));
+                continue;
             }
+            _assign(location, addr);
+            added++;
         }
+        present |= 1 << location;
+        _sensors.setResolution(addr, _resolution);
+        Serial.print(F(" -> "));
+        Serial.println((const __FlashStringHelper*)getLocationName(location));
     }
+    _failed = _assigned & ~present;
+    if(added) _saveMap();
+
+    // The search and the reads above used the bus: start a fresh cycle
+    _state = State::IDLE;
+    _requested = false;
+    return added;
 }
 
-void MultiDS18B20::printAddress(const uint8_t* addr) {
+void MultiDS18B20::printMap(Print& out) const {
+    for(uint8_t i = 0; i < MAX_PROBES; i++) {
+        if(!(_assigned & (1 << i))) continue;
+        out.print((const __FlashStringHelper*)getLocationName(i));
+        out.print(' ');
+        uint8_t addr[8];
+        _readRom(i, addr);
+        printAddress(out, addr);
+        out.print(' ');
+        float temp = getTemp(i);
+        if(temp == DEVICE_DISCONNECTED_C) {
+            out.println(F("--"));
+        } else {
+            out.println(temp, 1);
+        }
+    }
+}
+
+void MultiDS18B20::printAddress(Print& out, const uint8_t* addr) {
     for(uint8_t i = 0; i < 8; i++) {
-        if(addr[i] < 16) Serial.print("0");
-        Serial.print(addr[i], HEX);
-        if(i < 7) Serial.print(" ");
+        if(addr[i] < 16) out.print('0');
+        out.print(addr[i], HEX);
+        if(i < 7) out.print(' ');
     }
 }
 
 bool MultiDS18B20::isOperational() const {
-    // Check if we have any sensors connected
-    if(_sensors.getDeviceCount() == 0) {
-        return false;
+    // At least one probe, and every one of them answering
+    return _assigned && !_failed;
+}
+
+bool MultiDS18B20::_loadMap() {
+    // [version][8 ROMs][CRC-8]; an erased or torn map counts as empty
+    uint8_t version = EEPROM.read(_mapAddress);
+    uint8_t crc = _crc8_ccitt_update(0, version);
+    for(uint8_t k = 1; k < MAP_SIZE - 1; k++) {
+        crc = _crc8_ccitt_update(crc, EEPROM.read(_mapAddress + k));
     }
-    
-    // Check if we found our expected sensors
-    if(!_garageFound && !_outdoorFound) {
+    _assigned = 0;
+    if(version != MAP_VERSION || crc != EEPROM.read(_mapAddress + MAP_SIZE - 1)) {
+        // Free slots must read as zero before discovery fills them
+        for(uint8_t k = 1; k < MAP_SIZE - 1; k++) {
+            EEPROM.update(_mapAddress + k, 0);
+        }
         return false;
     }
-    
-    // Check if temperatures are valid (not disconnected)
-    if(_garageFound && _garageTemp == DEVICE_DISCONNECTED_C) {
-        return false;
+
+    uint8_t addr[8];
+    for(uint8_t i = 0; i < MAX_PROBES; i++) {
+        _readRom(i, addr);
+        if(addr[0] && OneWire::crc8(addr, 7) == addr[7]) {
+            _assigned |= 1 << i;
+        }
     }
-    
-    if(_outdoorFound && _outdoorTemp == DEVICE_DISCONNECTED_C) {
-        return false;
+    return _assigned != 0;
+}
+
+void MultiDS18B20::_saveMap() {
+    // The ROMs are already in place; seal them with the version and CRC
+    uint8_t crc = _crc8_ccitt_update(0, MAP_VERSION);
+    EEPROM.update(_mapAddress, MAP_VERSION);
+    for(uint8_t k = 1; k < MAP_SIZE - 1; k++) {
+        crc = _crc8_ccitt_update(crc, EEPROM.read(_mapAddress + k));
     }
-    
-    return true;
-}
\ No newline at end of file
+    EEPROM.update(_mapAddress + MAP_SIZE - 1, crc);
+}
+
+bool MultiDS18B20::_verifyMap() {
+    // One scratchpad read per stored probe instead of a full bus search
+    _failed = 0;
+    uint8_t addr[8];
+    for(uint8_t i = 0; i < MAX_PROBES; i++) {
+        if(getAddress(i, addr) && !_sensors.isConnected(addr)) {
+            _failed |= 1 << i;
+        }
+    }
+    return !_failed;
+}
+
+void MultiDS18B20::_assign(uint8_t location, const uint8_t* addr) {
+    _writeRom(location, addr);
+    _assigned |= 1 << location;
+    _raw[location] = NOT_READ;
+}
+
+void MultiDS18B20::_readRom(uint8_t location, uint8_t* addr) const {
+    for(uint8_t j = 0; j < 8; j++) {
+        addr[j] = EEPROM.read(_romAddress(location) + j);
+    }
+}
+
+void MultiDS18B20::_writeRom(uint8_t location, const uint8_t* addr) {
+    for(uint8_t j = 0; j < 8; j++) {
+        EEPROM.update(_romAddress(location) + j, addr[j]);
+    }
+}
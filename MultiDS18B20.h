@@ -1,64 +1,119 @@
-#ifndef MULTI_DS18B20_H
-#define MULTI_DS18B20_H
-
-#include <OneWire.h>
-#include <DallasTemperature.h>
-
-class MultiDS18B20 {
-public:
-
-	// Check if sensors not fail
-	bool isOperational() const;
-    
-	// Callback type for temperature readings
-    typedef void (*TemperatureCallback)(const char* location, float temp);
-
-    // Constructor with OneWire bus pin
-    explicit MultiDS18B20(uint8_t pin);
-    
-    // Initialization
-    void begin();
-    
-    // Main update function (call in loop())
-    void update();
-    
-    // Trigger new temperature conversion
-    void requestTemperatures();
-    
-    // Get stored temperatures
-    float getGarageTemp() const;
-    float getOutdoorTemp() const;
-    
-    // Manual sensor address assignment
-    bool setSensorAddress(const char* location, const uint8_t* addr);
-    
-    // Set callback for new readings
-    void setTemperatureCallback(TemperatureCallback callback);
-    
-    // Scan bus and auto-assign sensors
-    void discoverSensors();
-
-private:
-    OneWire _oneWire;                  // OneWire bus instance
-    DallasTemperature _sensors;        // DS18B20 controller
-    TemperatureCallback _tempCallback; // Reading callback
-    
-    // Sensor addresses
-    uint8_t _garageAddr[8] = {0};     // Garage sensor ROM
-    uint8_t _outdoorAddr[8] = {0};    // Outdoor sensor ROM
-    bool _garageFound = false;         // Garage sensor status
-    bool _outdoorFound = false;        // Outdoor sensor status
-    
-    // Temperature storage
-    float _garageTemp = DEVICE_DISCONNECTED_C;
-    float _outdoorTemp = DEVICE_DISCONNECTED_C;
-    
-    // Timing control
-    unsigned long _lastRequestTime = 0;
-    const unsigned long _requestInterval = 60000; // Reading interval (ms)
-    
-    // Helper to print ROM addresses
-    void printAddress(const uint8_t* addr);
-};
-
-#endif
\ No newline at end of file
+#ifndef MULTI_DS18B20_H
+#define MULTI_DS18B20_H
+
+#include <Arduino.h>
+#include <OneWire.h>
+#include <DallasTemperature.h>
+
+// DS18B20 probes on one bus, kept in a table indexed by location ID. The
+// ROM of each location lives only in the EEPROM map and is read from there
+// by index when the probe is addressed. At boot the stored probes are
+// checked by address and the bus is only searched when one of them does
+// not answer (or the map is empty), then new probes take free locations.
+class MultiDS18B20 {
+public:
+    static constexpr uint8_t MAX_PROBES = 8;
+    static constexpr uint8_t NO_LOCATION = 0xFF;
+    static constexpr uint8_t MAP_SIZE = 1 + MAX_PROBES * 8 + 1;   // [version][ROMs][CRC-8]
+
+    // Location IDs, the index of the probe table. A scan fills them in order.
+    enum Location : uint8_t {
+        GARAGE = 0,
+        OUTDOOR,
+        ATTIC,
+        FREEZER
+        // 4..7 spare
+    };
+
+    // Check if sensors not fail
+    bool isOperational() const;
+
+    // Callback type for temperature readings
+    typedef void (*TemperatureCallback)(uint8_t location, float temp);
+
+    // Constructor with OneWire bus pin
+    explicit MultiDS18B20(uint8_t pin);
+
+    // Initialization; mapAddress is the EEPROM block of the ROM map
+    void begin(uint16_t mapAddress);
+
+    // Main update function (call in loop()). Runs the request/wait/read
+    // cycle; only talks to the bus when a step is due.
+    void update();
+
+    // Start a conversion on every probe now (skip-ROM broadcast)
+    void requestTemperatures();
+
+    // 9..12 bits: 0.5..0.0625 C, 94..750 ms per conversion
+    void setResolution(uint8_t bits);
+    uint8_t getResolution() const { return _resolution; }
+    void setRequestInterval(unsigned long interval);
+    bool isConverting() const { return _state != State::IDLE; }
+
+    // Get stored temperatures, DEVICE_DISCONNECTED_C if none yet
+    float getTemp(uint8_t location) const;
+    float getGarageTemp() const { return getTemp(GARAGE); }
+    float getOutdoorTemp() const { return getTemp(OUTDOOR); }
+
+    // Registry
+    bool isAssigned(uint8_t location) const;
+    bool getAddress(uint8_t location, uint8_t* addr) const; // false if unassigned
+    uint8_t getProbeCount() const;
+    uint8_t findLocation(const uint8_t* addr) const;     // NO_LOCATION if unknown
+    static const char* getLocationName(uint8_t location); // PROGMEM, 3 chars
+
+    // Manual sensor address assignment, saved to the map
+    bool setSensorAddress(uint8_t location, const uint8_t* addr);
+    void clearSensor(uint8_t location);
+
+    // Set callback for new readings
+    void setTemperatureCallback(TemperatureCallback callback);
+
+    // Search the bus: known probes keep their location, new ones take the
+    // first free one. Returns the number of probes added.
+    uint8_t discoverSensors();
+
+    // One line per assigned location: "Gar 28 A1 .. AC 21.5"
+    void printMap(Print& out) const;
+
+private:
+    enum class State : uint8_t {
+        IDLE,          // waiting for the next request
+        CONVERTING,    // conversion running, bus left alone
+        READING        // one probe's scratchpad per update()
+    };
+
+    static constexpr int16_t NOT_READ = -32768;
+
+    OneWire _oneWire;                  // OneWire bus instance
+    DallasTemperature _sensors;        // DS18B20 controller
+    TemperatureCallback _tempCallback = nullptr; // Reading callback
+
+    // Probe table, indexed by location; the ROMs are in the EEPROM map
+    int16_t _raw[MAX_PROBES];           // last reading, 1/128 C
+    uint8_t _assigned = 0;              // bit per location
+    uint8_t _failed = 0;                // missing at boot or last read failed
+    uint16_t _mapAddress = 0;
+
+    // Timing control
+    State _state = State::IDLE;
+    uint8_t _readIndex = 0;            // next location to read
+    uint8_t _resolution = 10;          // bits
+    uint16_t _conversionTime = 188;    // ms, follows _resolution
+    bool _requested = false;           // a conversion was ever started
+    unsigned long _lastRequestTime = 0;
+    unsigned long _requestInterval = 60000; // Reading interval (ms)
+
+    bool _loadMap();
+    void _saveMap();
+    bool _verifyMap();
+    void _assign(uint8_t location, const uint8_t* addr);
+    uint16_t _romAddress(uint8_t location) const { return _mapAddress + 1 + location * 8; }
+    void _readRom(uint8_t location, uint8_t* addr) const;
+    void _writeRom(uint8_t location, const uint8_t* addr);
+
+    // Helper to print ROM addresses
+    static void printAddress(Print& out, const uint8_t* addr);
+};
+
+#endif
@@ -5,6 +5,7 @@
 #include <DallasTemperature.h>
 #include <DoorSensor.h>
 #include <EEPROM.h>
+#include <EepromLayout.h>
 #include <EventLogger.h>
 #include <GarageLight.h>
 #include <GSMController.h>
@@ -13,10 +14,10 @@
 #include <MovingSensor.h>
 #include <MultiDS18B20.h>
 #include <OneWire.h>
+#include <PerfMonitor.h>
 #include <SmokeRelay.h>
 #include <SmokeSensor.h>
 #include <SystemManager.h>
-#include <Wire.h>
 
 #define DEBUG_MODE 0
 #if DEBUG_MODE
@@ -47,7 +48,15 @@ const uint8_t MQ7_HEAT_PIN = 10;
 const uint8_t IBUTTON_PIN = 11;
 const uint8_t LIGHT_FEEDBACK_PIN = 12;
 const uint8_t GREEN_LED = 13;
-const uint16_t EEPROM_START_ADDR = 0;
+
+#if PERF_MONITOR
+// Замеры loop(): весь проход и часть скетча; задачи SystemManager - отдельно
+static const char PERF_LOOP_NAME[] PROGMEM = "LOOP";
+static const char PERF_SKETCH_NAME[] PROGMEM = "SKCH";
+static uint8_t perfLoopSlot;
+static uint8_t perfSketchSlot;
+const unsigned long PERF_REPORT_INTERVAL = 60000;
+#endif
 
 
 // Module instances
@@ -66,9 +75,11 @@ SmokeSensor smokeSensor2(MQ7_2_PIN, MQ7_HEAT_PIN);
 SmokeRelay smokeRelay(SMOKE_RELAY_PIN);
 MovingSensor motionSensor(MOTION_PIN, true);
 MultiDS18B20 temps(TEMP_PIN);
-EventLogger logger(EEPROM_START_ADDR);
+EventLogger logger(EEPROM_EVENT_LOG, EEPROM_EVENT_LOG_ENTRIES);
+static_assert(EEPROM_EVENT_LOG_ENTRIES <= EventLogger::MAX_ENTRIES, "event log past the RAM index");
+static_assert(EEPROM_TEMP_MAP_SIZE == MultiDS18B20::MAP_SIZE, "DS18B20 map size");
 SystemManager systemManager(gsm, alarm, smokeSensor1, smokeSensor2, doorSensor, gateSensor, ibutton, logger, buzzer, temps, smokeRelay, redLed, yellowLed, greenLed, motionSensor, garageLight);
-static void callEventHandler(const String& number, GSMController::CallStatus status) {
+static void callEventHandler(const char* number, GSMController::CallStatus status) {
   if (status == GSMController::CallStatus::INCOMING_CALL) {
     systemManager.handleIncomingCall(number);
   }
@@ -80,7 +91,7 @@ void setup() {
   /*playMelody();
   */
   Serial.begin(9600);
-  gsm.begin(10000);
+  gsm.begin();
   DEBUG_PRINTLN(F("GSM init"));
   ibutton.begin();
   alarm.init();
@@ -89,23 +100,19 @@ void setup() {
   greenLed.begin();
   garageLight.begin();
   motionSensor.begin();
-  temps.begin();
+  temps.begin(EEPROM_TEMP_MAP);
   systemManager.begin();
   systemManager.setSmokeDifferential(20.0);
-  ibutton.setAccessGrantedCallback([](const uint8_t* keyId) {
-    DEBUG_PRINT("Acc all! Key ID: ");
-    iButtonAccess::printKey(keyId);
-  });
-
-  ibutton.setAccessDeniedCallback([](const uint8_t* keyId) {
-    DEBUG_PRINT("Acc den! Key ID: ");
-    iButtonAccess::printKey(keyId);
-  });
-  gsm.onCallEvent([](const String& num, GSMController::CallStatus status) {
+  gsm.onSmsReceived(handleSms);
+  gsm.onCallEvent([](const char* num, GSMController::CallStatus status) {
     if (status == GSMController::CallStatus::INCOMING_CALL) {
       systemManager.handleIncomingCall(num);
     }
   });
+#if PERF_MONITOR
+  perfLoopSlot = PERF_ADD_SLOT(PERF_LOOP_NAME);
+  perfSketchSlot = PERF_ADD_SLOT(PERF_SKETCH_NAME);
+#endif
 }
 
 void printGSMStatus() {
@@ -129,18 +136,9 @@ void printGSMStatus() {
 
 void handleSystemState() {
   static uint16_t lastCheckSec = 0;      // 2 байта (вместо 4)
-  static uint16_t lastGsmCheckSec = 0;   // 2 байта (вместо 4)
   const uint16_t nowSec = millis() / 1000; // Точность в секундах
 
-  // Проверка GSM каждые 5 секунд (было 5000ms)
-  if ((uint16_t)(nowSec - lastGsmCheckSec) >= 5) {
-    lastGsmCheckSec = nowSec;
-    
-    if (gsm.getNetworkStatus() < GSMController::NetworkStatus::REGISTERED_HOME) {
-      DEBUG_PRINTLN(F("GSM reconnect"));
-      gsm.begin(10000);
-    }
-  }
+  // Переподключение GSM ведёт сам GSMController (RESTART_DELAY, опрос CREG)
 
   // Проверка здоровья системы каждые 5 минут (было 300000ms)
   if ((uint16_t)(nowSec - lastCheckSec) >= 300) { // 300 сек = 5 мин
@@ -162,6 +160,10 @@ void handleSystemState() {
     case SystemManager::SystemState::ARMED:
       break;
 
+    case SystemManager::SystemState::ENTRY_DELAY:
+      handleEntryState();
+      break;
+
     case SystemManager::SystemState::FIRE_ALERT:
     case SystemManager::SystemState::INTRUSION_ALERT:
       handleAlertState(currentState);
@@ -174,13 +176,70 @@ void handleSystemState() {
 }
 
 void loop() {
+  PERF_START(loopStart);
   printGSMStatus();
-  systemManager.update();  // Основной цикл обработки
-  gsm.update();
+  systemManager.update();  // Основной цикл обработки: только задачи, срок которых подошёл
+  PERF_START(sketchStart);
   handleSystemState();
-  delay(10);
+  handleSerialCommand();
+  PERF_STOP(perfSketchSlot, sketchStart);
+  PERF_STOP(perfLoopSlot, loopStart);
+#if PERF_MONITOR
+  reportPerf();
+#endif
+  delay(systemManager.getTimeToNextWakeup());  // Спим до следующей задачи
+}
+
+void handleSerialCommand() {
+  // Команды с консоли: DUMP - двоичный дамп журнала (sim/tools/log_decode), LOG - текстом,
+  // CAL - калибровка MQ-7 на чистом воздухе, SCAN - поиск новых DS18B20 и карта датчиков,
+  // HIST - история температур (час/сутки/прошлые сутки и средние по часам),
+  // KEYS - список ключей, KEY ADD/DEL <ключ>, KEY LEARN - добавить следующий приложенный
+  static char line[32];
+  static uint8_t len = 0;
+  while (Serial.available()) {
+    char c = Serial.read();
+    if (c != '\r' && c != '\n') {
+      if (len < sizeof(line) - 1) line[len++] = toupper(c);
+      continue;
+    }
+    line[len] = '\0';
+    len = 0;
+    if (strcmp_P(line, PSTR("DUMP")) == 0) {
+      logger.exportLog(Serial);
+    } else if (strcmp_P(line, PSTR("LOG")) == 0) {
+      logger.printLogs();
+    } else if (strcmp_P(line, PSTR("CAL")) == 0) {
+      Serial.println(systemManager.calibrateSmokeSensors() ? F("Smk cal start") : F("Smk cal busy"));
+    } else if (strcmp_P(line, PSTR("SCAN")) == 0) {
+      temps.discoverSensors();
+      temps.printMap(Serial);
+    } else if (strcmp_P(line, PSTR("HIST")) == 0) {
+      systemManager.printTemperatureHistory(Serial);
+    } else if (strcmp_P(line, PSTR("KEYS")) == 0) {
+      systemManager.getKeyStore().printKeys(Serial);
+    } else {
+      char reply[24];
+      if (handleKeyCommand(line, reply, sizeof(reply))) Serial.println(reply);
+    }
+  }
 }
 
+#if PERF_MONITOR
+void reportPerf() {
+  // По одной строке за проход, чтобы не ждать буфер Serial
+  static unsigned long lastReport = 0;
+  static uint8_t nextSlot = 0xFF;
+  if (nextSlot < perfMonitor.getSlotCount()) {
+    perfMonitor.reportSlot(Serial, nextSlot++);
+  } else if (millis() - lastReport >= PERF_REPORT_INTERVAL) {
+    lastReport = millis();
+    perfMonitor.reportHeader(Serial);
+    nextSlot = 0;
+  }
+}
+#endif
+
 void handleDisarmedState() {
   // Nothing special needed here - all handled by callbacks
 }
@@ -191,6 +250,12 @@ void handleArmingState() {
   DEBUG_PRINTLN(remaining / 1000);
 }
 
+void handleEntryState() {
+  unsigned long remaining = systemManager.getEntryRemaining();
+  DEBUG_PRINT("Disarm in: ");
+  DEBUG_PRINTLN(remaining / 1000);
+}
+
 
 void handleAlertState(SystemManager::SystemState alertType) {
   // Periodic alert updates (every minute)
@@ -198,22 +263,18 @@ void handleAlertState(SystemManager::SystemState alertType) {
   if (millis() - lastAlertUpdate > 60000) {
     lastAlertUpdate = millis();
 
-    String alertMsg = (alertType == SystemManager::SystemState::FIRE_ALERT) ? "FIRE AL ACT" : "INTR AL ACT";
-    alertMsg += " for " + String(systemManager.getStateDuration() / 60000) + " minutes";
+    bool fire = alertType == SystemManager::SystemState::FIRE_ALERT;
+    char alertMsg[SMS_BUFFER_SIZE];
+    snprintf_P(alertMsg, sizeof(alertMsg),
+               fire ? PSTR("FIRE AL ACT for %lu minutes") : PSTR("INTR AL ACT for %lu minutes"),
+               systemManager.getStateDuration() / 60000);
 
     DEBUG_PRINTLN(alertMsg);
 
-    // Send to all registered numbers
-    gsm.sendSMS(systemManager.getAdminPhone1(), alertMsg);
-    if (!systemManager.hasAdminPhone2()) {
-      gsm.sendSMS(systemManager.getAdminPhone2(), alertMsg);
-    }
-    if (!systemManager.hasUserPhone1()) {
-      gsm.sendSMS(systemManager.getUserPhone1(), alertMsg);
-    }
-    if (!systemManager.hasUserPhone2()) {
-      gsm.sendSMS(systemManager.getUserPhone2(), alertMsg);
-    }
+    // Send to all registered numbers; a newer reminder replaces an unsent one
+    SmsQueue::Priority priority = fire ? SmsQueue::Priority::FIRE : SmsQueue::Priority::INTRUSION;
+    systemManager.getSmsQueue().enqueue(priority, SmsQueue::ALL, alertMsg,
+                                        SmsQueue::Topic::ALERT_REPEAT);
   }
 }
 
@@ -226,35 +287,86 @@ void handleMaintenanceState() {
   }
 }
 
-void handleSms(const String& number, const String& text) {
+// KEY ADD <ключ>, KEY DEL <ключ>, KEY LEARN; false если это не команда ключей
+bool handleKeyCommand(const char* command, char* reply, size_t size) {
+  if (strncmp_P(command, PSTR("KEY "), 4) != 0) return false;
+  const char* args = command + 4;
+  uint8_t key[8];
+  KeyStore::Result result;
+  if (strcmp_P(args, PSTR("LEARN")) == 0) {
+    systemManager.learnKey();
+    strncpy_P(reply, PSTR("Touch new key"), size);
+    return true;
+  } else if (strncmp_P(args, PSTR("ADD "), 4) == 0 && KeyStore::parseKey(args + 4, key)) {
+    result = systemManager.addAuthorizedKey(key);
+  } else if (strncmp_P(args, PSTR("DEL "), 4) == 0 && KeyStore::parseKey(args + 4, key)) {
+    result = systemManager.removeAuthorizedKey(key);
+  } else {
+    result = KeyStore::Result::BAD_KEY;
+  }
+
+  // Отдельные строки: литералы внутри PROGMEM-таблицы остались бы в RAM
+  static const char resultOk[] PROGMEM = "Key OK";
+  static const char resultExists[] PROGMEM = "Key exists";
+  static const char resultFull[] PROGMEM = "Keys full";
+  static const char resultNotFound[] PROGMEM = "Key not found";
+  static const char resultBadKey[] PROGMEM = "Bad key";
+  static const char* const results[] PROGMEM = {
+    resultOk, resultExists, resultFull, resultNotFound, resultBadKey
+  };
+  strncpy_P(reply, (const char*)pgm_read_ptr(&results[static_cast<uint8_t>(result)]), size);
+  return true;
+}
+
+void replySms(const char* number, const char* text) {
+  SmsQueue& sms = systemManager.getSmsQueue();
+  sms.enqueue(SmsQueue::Priority::STATUS, sms.findRecipient(number), text);
+}
+
+// Ответ из PROGMEM: строковые литералы иначе занимают ОЗУ
+void replySms_P(const char* number, PGM_P text) {
+  char reply[SMS_BUFFER_SIZE];
+  strncpy_P(reply, text, sizeof(reply) - 1);
+  reply[sizeof(reply) - 1] = '\0';
+  replySms(number, reply);
+}
+
+void handleSms(const char* number, char* text) {
   // Verify sender is authorized
-  if (!systemManager.verifyPhoneNumber(number.c_str())) {
-    DEBUG_PRINTLN("SMS: " + number);
+  if (!systemManager.verifyPhoneNumber(number)) {
+    DEBUG_PRINT(F("SMS: "));
+    DEBUG_PRINTLN(number);
     return;
   }
 
-  // Process commands (case insensitive)
-  String command = text;
-  command.toUpperCase();
-  command.trim();
-
-  if (strcmp_P(command.c_str(), PSTR("STATUS")) == 0) {
+  // Process commands (case insensitive), trimmed in the modem's buffer
+  while (isspace(*text)) text++;
+  char* command = text;
+  uint8_t len = 0;
+  for (; command[len]; len++) command[len] = toupper(command[len]);
+  while (len && isspace(command[len - 1])) len--;
+  command[len] = '\0';
+  // Список ключей и их изменение - только с номеров администраторов
+  const bool admin = systemManager.isAdminNumber(number);
+
+  if (strcmp_P(command, PSTR("STATUS")) == 0) {
     char status[30];  // Adjust size as needed
-    snprintf_P(status, sizeof(status), PSTR("Sys st: %s"), systemManager.getStateString());
-    gsm.sendSMS(number.c_str(), status);
-  } else if (command == "ARM") {
+    strcpy_P(status, PSTR("Sys st: "));
+    strncat_P(status, systemManager.getStateString(), sizeof(status) - strlen(status) - 1);
+    replySms(number, status);
+  } else if (strcmp_P(command, PSTR("ARM")) == 0) {
     if (systemManager.armSystem()) {
-      gsm.sendSMS(number, "Sys arm init");
+      replySms_P(number, PSTR("Sys arm init"));
     } else {
-      gsm.sendSMS(number, "Cannot arm - inv state");
+      replySms_P(number, PSTR("Cannot arm - inv state"));
     }
-  } else if (command == "DISARM") {
+  } else if (strcmp_P(command, PSTR("DISARM")) == 0) {
     if (systemManager.disarmSystem()) {
-      gsm.sendSMS(number, "Sys disarm");
+      replySms_P(number, PSTR("Sys disarm"));
     } else {
-      gsm.sendSMS(number, "Disarm fail");
+      replySms_P(number, PSTR("Disarm fail"));
     }
-  } else if (strcmp_P(command.c_str(), PSTR("TEMP")) == 0) {
+  } else if (strcmp_P(command, PSTR("TEMP")) == 0) {
     char message[16];  // "TEMP:T:GG.OO" + null terminator = 12 bytes
     char tempCode[8];  // For optimized "T:GG.OO" format
 
@@ -265,35 +377,68 @@ void handleSms(const String& number, const String& text) {
     snprintf_P(message, sizeof(message), PSTR("TEMP:%s"), tempCode);
 
     // Send SMS
-    gsm.sendSMS(number.c_str(), message);
+    replySms(number, message);
+  } else if (strcmp_P(command, PSTR("LOG")) == 0) {
+    char report[SMS_BUFFER_SIZE];
+    logger.formatSummary(report, sizeof(report));
+    replySms(number, report);
+  } else if (strcmp_P(command, PSTR("HIST")) == 0) {
+    // Мин/средн/макс за текущие сутки по каждому датчику, целые градусы
+    char report[SMS_BUFFER_SIZE];
+    systemManager.getTemperatureHistory(report, sizeof(report));
+    replySms(number, report);
+  } else if (!admin && strncmp_P(command, PSTR("KEY"), 3) == 0) {
+    replySms_P(number, PSTR("Admin only"));
+  } else if (strcmp_P(command, PSTR("KEYS")) == 0) {
+    char report[SMS_BUFFER_SIZE];
+    systemManager.getKeyStore().formatKeys(report, sizeof(report));
+    replySms(number, report);
+  } else if (strncmp_P(command, PSTR("KEY "), 4) == 0) {
+    char reply[24];
+    handleKeyCommand(command, reply, sizeof(reply));
+    replySms(number, reply);
+  } else if (strcmp_P(command, PSTR("CAL")) == 0) {
+    // Только на чистом воздухе; результат в журнале (SMK_CAL)
+    replySms_P(number, systemManager.calibrateSmokeSensors() ? PSTR("Smk cal start") : PSTR("Smk cal busy"));
+#if PERF_MONITOR
+  } else if (strcmp_P(command, PSTR("PERF")) == 0) {
+    char report[SMS_BUFFER_SIZE];
+    perfMonitor.formatSummary(report, sizeof(report));
+    replySms(number, report);
+#endif
   } else {
-    gsm.sendSMS(number, "Unk com. Val: STATUS, ARM, DISARM, TEMP");
+    // Очередь обрезает текст до SMS_BUFFER_SIZE - 1 символов: список в двух SMS
+    static const char commands[] PROGMEM = "Unk com. Val: STATUS ARM DISARM TEMP HIST";
+    static const char moreCommands[] PROGMEM = "Val: LOG CAL KEYS KEY ADD|DEL <key>|LEARN";
+    static_assert(sizeof(commands) <= SMS_BUFFER_SIZE && sizeof(moreCommands) <= SMS_BUFFER_SIZE,
+                  "command list does not fit one SMS");
+    replySms_P(number, commands);
+    replySms_P(number, admin ? moreCommands : PSTR("Val: LOG CAL"));
   }
 }
 
-void handleStateChange(SystemManager::SystemState state, const String& message) {
-  DEBUG_PRINTLN("St change: " + message);
+void handleStateChange(SystemManager::SystemState state, const char* message) {
+  DEBUG_PRINT(F("St change: "));
+  DEBUG_PRINTLN(message);
 
   // Notify admin about important state changes
   if (state == SystemManager::SystemState::ARMED || state == SystemManager::SystemState::DISARMED || state == SystemManager::SystemState::MAINTENANCE) {
-    gsm.sendSMS(systemManager.getAdminPhone1(), message);
-    if (!systemManager.hasAdminPhone2()) {
-      gsm.sendSMS(systemManager.getAdminPhone2(), message);
-    }
+    systemManager.getSmsQueue().enqueue(SmsQueue::Priority::STATUS, SmsQueue::ADMINS,
+                                        message, SmsQueue::Topic::STATE);
   }
 }
 
-void handleAlert(SystemManager::SystemState state, const String& message) {
-  DEBUG_PRINTLN("ALERT: " + message);
+void handleAlert(SystemManager::SystemState state, const char* message) {
+  DEBUG_PRINT(F("ALERT: "));
+  DEBUG_PRINTLN(message);
 
   // Call admin phones for critical alerts
   if (state == SystemManager::SystemState::FIRE_ALERT) {
     gsm.makeCall(systemManager.getAdminPhone1());
   } else if (state == SystemManager::SystemState::INTRUSION_ALERT) {
     gsm.makeCall(systemManager.getAdminPhone1());
-    if (!systemManager.hasAdminPhone2()) {
-      delay(5000);  // Wait before second call
-      gsm.makeCall(systemManager.getAdminPhone2());
+    if (systemManager.hasAdminPhone2()) {
+      gsm.makeCall(systemManager.getAdminPhone2());  // Пауза между звонками - в очереди GSM
     }
   }
 }
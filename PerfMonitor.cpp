@@ -0,0 +1,111 @@
+#include "PerfMonitor.h"
+
+#if PERF_MONITOR
+
+#include <avr/pgmspace.h>
+
+PerfMonitor perfMonitor;
+
+uint8_t PerfMonitor::addSlot(const char* name) {
+    if(_count >= SLOTS) return INVALID_SLOT;
+    _slots[_count].name = name;
+    _clear(_slots[_count]);
+    return _count++;
+}
+
+void PerfMonitor::record(uint8_t slot, unsigned long us) {
+    if(slot >= _count) return;
+    Slot& s = _slots[slot];
+
+    uint16_t ticks = min(us >> 2, 0xFFFFUL);
+    if(ticks < s.minTicks) s.minTicks = ticks;
+    if(ticks > s.maxTicks) s.maxTicks = ticks;
+
+    if(s.count == 0xFFFF) {
+        // Keep the mean, drop weight of old samples
+        s.count >>= 1;
+        s.sumTicks >>= 1;
+    }
+    s.count++;
+    s.sumTicks += ticks;
+
+    // A full bucket sticks at 255; halving all of them would zero the rare
+    // slow buckets, which are the tail this histogram is for
+    uint8_t b = _bucket(ticks);
+    if(s.hist[b] != 0xFF) s.hist[b]++;
+}
+
+void PerfMonitor::reset() {
+    for(uint8_t i = 0; i < _count; i++) {
+        _clear(_slots[i]);
+    }
+}
+
+void PerfMonitor::reportHeader(Print& out) const {
+    // Times in us; a histogram count of 255 means 255 or more
+    out.println(F("PERF slot      n  min  mean    max |  <64u <256u   <1m   <4m  <16m  <64m <256m  more"));
+}
+
+void PerfMonitor::reportSlot(Print& out, uint8_t slot) const {
+    if(slot >= _count || !_slots[slot].count) return;
+    const Slot& s = _slots[slot];
+    char line[48];
+    char name[6];
+    strncpy_P(name, s.name, sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    snprintf_P(line, sizeof(line), PSTR("PERF %-5s %5u %4lu %5lu %6lu |"),
+               name, s.count, (unsigned long)s.minTicks * 4,
+               s.sumTicks / s.count * 4, (unsigned long)s.maxTicks * 4);
+    out.print(line);
+    for(uint8_t b = 0; b < BUCKETS; b++) {
+        snprintf_P(line, sizeof(line), PSTR(" %5u"), s.hist[b]);
+        out.print(line);
+    }
+    out.println();
+}
+
+void PerfMonitor::formatSummary(char* buffer, size_t size) const {
+    // "PERF LOOP 2/39 GSM 1/38 ..." as mean/max in ms, worst max first
+    strncpy_P(buffer, PSTR("PERF"), size);
+    uint32_t done = 0;
+
+    for(uint8_t n = 0; n < _count && n < 32; n++) {
+        uint8_t worst = INVALID_SLOT;
+        for(uint8_t i = 0; i < _count; i++) {
+            if((done & (1UL << i)) || !_slots[i].count) continue;
+            if(worst == INVALID_SLOT || _slots[i].maxTicks > _slots[worst].maxTicks) worst = i;
+        }
+        if(worst == INVALID_SLOT) break;
+        done |= 1UL << worst;
+
+        const Slot& s = _slots[worst];
+        char name[6];
+        char item[24];
+        strncpy_P(name, s.name, sizeof(name) - 1);
+        name[sizeof(name) - 1] = '\0';
+        snprintf_P(item, sizeof(item), PSTR(" %s %lu/%lu"), name,
+                   (s.sumTicks / s.count * 4 + 500) / 1000,
+                   ((unsigned long)s.maxTicks * 4 + 500) / 1000);
+
+        size_t len = strlen(buffer);
+        if(len + strlen(item) + 1 > size) break;
+        strcpy(buffer + len, item);
+    }
+}
+
+void PerfMonitor::_clear(Slot& s) {
+    s.minTicks = 0xFFFF;
+    s.maxTicks = 0;
+    s.sumTicks = 0;
+    s.count = 0;
+    memset(s.hist, 0, sizeof(s.hist));
+}
+
+uint8_t PerfMonitor::_bucket(uint16_t ticks) {
+    // Two octaves per bucket: 16 ticks (64 us), 64, 256, ...
+    uint8_t b = 0;
+    for(ticks >>= 4; ticks && b < BUCKETS - 1; ticks >>= 2) b++;
+    return b;
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef PERF_MONITOR_H
+#define PERF_MONITOR_H
+
+#include <Arduino.h>
+
+// Loop timing instrumentation. Off by default; build with PERF_MONITOR=1
+// (or change the default below) to get per-task timings. When off, the
+// PERF_* macros expand to nothing and no table is allocated.
+#ifndef PERF_MONITOR
+#define PERF_MONITOR 0
+#endif
+
+#if PERF_MONITOR
+
+class PerfMonitor {
+public:
+    static constexpr uint8_t SLOTS = 16;
+    static constexpr uint8_t BUCKETS = 8;     // <64us, <256us, <1ms, ... >=256ms
+    static constexpr uint8_t INVALID_SLOT = 0xFF;
+
+    uint8_t addSlot(const char* name);        // PROGMEM name
+    void record(uint8_t slot, unsigned long us);
+    void reset();
+
+    // Serial report, one slot per call so the TX buffer never stalls loop()
+    uint8_t getSlotCount() const { return _count; }
+    void reportHeader(Print& out) const;
+    void reportSlot(Print& out, uint8_t slot) const;
+    void formatSummary(char* buffer, size_t size) const; // worst slots first, for SMS
+
+private:
+    // Times are kept in 4 us ticks, the resolution of micros() at 16 MHz
+    struct Slot {
+        const char* name;
+        uint16_t minTicks;
+        uint16_t maxTicks;       // saturates at ~262 ms
+        uint32_t sumTicks;
+        uint16_t count;
+        uint8_t hist[BUCKETS];   // each saturates at 255
+    };
+
+    Slot _slots[SLOTS];
+    uint8_t _count = 0;
+
+    static void _clear(Slot& s);
+    static uint8_t _bucket(uint16_t ticks);
+};
+
+extern PerfMonitor perfMonitor;
+
+#define PERF_START(var) unsigned long var = micros()
+#define PERF_STOP(slot, var) perfMonitor.record((slot), micros() - (var))
+#define PERF_ADD_SLOT(name) perfMonitor.addSlot(name)
+
+#else
+
+#define PERF_START(var)
+#define PERF_STOP(slot, var)
+#define PERF_ADD_SLOT(name) PerfMonitorDisabledSlot
+
+static constexpr uint8_t PerfMonitorDisabledSlot = 0xFF;
+
+#endif
+
+#endif
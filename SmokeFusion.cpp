@@ -0,0 +1,145 @@
+#include "SmokeFusion.h"
+
+void SmokeFusion::setThresholds(uint16_t warning, uint16_t critical) {
+    _warning = warning;
+    _critical = critical;
+}
+
+void SmokeFusion::setDifferential(uint16_t differential) {
+    _differential = differential;
+}
+
+void SmokeFusion::setRiseRate(uint16_t perMinute) {
+    _riseRate = perMinute;
+}
+
+void SmokeFusion::reset() {
+    for(uint8_t i = 0; i < SENSORS; i++) {
+        _sensors[i].count = 0;
+        _sensors[i].slope = 0;
+        _sensors[i].rising = false;
+    }
+    _level = Level::CLEAR;
+    _reason = Reason::NONE;
+    _confidence = 0;
+}
+
+void SmokeFusion::addReading(uint8_t sensor, uint16_t ppm, unsigned long now) {
+    if(sensor >= SENSORS) return;
+    History& h = _sensors[sensor];
+    uint16_t time = now / 1000;
+
+    // A gap (sensor stopped, heater restarted) would make the slope meaningless
+    if(!_isFresh(h, time)) h.count = 0;
+
+    h.readings[h.head].ppm = ppm;
+    h.readings[h.head].time = time;
+    h.head = (h.head + 1) % HISTORY;
+    if(h.count < HISTORY) h.count++;
+    _fit(h);
+}
+
+SmokeFusion::Level SmokeFusion::evaluate(unsigned long now) {
+    uint16_t time = now / 1000;
+    uint8_t fresh = 0;
+    uint8_t rising = 0;
+    uint8_t score = 0;
+    bool warning = false;
+    bool critical = false;
+    _peak = 0;
+
+    for(uint8_t i = 0; i < SENSORS; i++) {
+        const History& h = _sensors[i];
+        if(!_isFresh(h, time)) continue;
+        uint16_t ppm = _latest(h).ppm;
+        fresh++;
+        if(ppm > _peak) _peak = ppm;
+        if(ppm >= _critical) {
+            critical = true;
+            score += 40;
+        } else if(ppm >= _warning) {
+            warning = true;
+            score += 15;
+        }
+        if(h.rising) {
+            rising++;
+            score += 30;
+        }
+    }
+    if(rising == SENSORS) score += 15;
+    if(_relay) score += 50;
+    _confidence = min(score, (uint8_t)100);
+
+    // The sensors disagree when both are live, far apart and not rising
+    // together; a lone live sensor is taken as it is
+    bool consistent = true;
+    _difference = 0;
+    if(fresh == SENSORS) {
+        _difference = (int16_t)_latest(_sensors[0]).ppm - (int16_t)_latest(_sensors[1]).ppm;
+        consistent = abs(_difference) <= _differential || rising == SENSORS;
+    }
+
+    if(_relay) {
+        _level = Level::FIRE;
+        _reason = Reason::RELAY;
+    } else if(critical) {
+        _level = consistent ? Level::FIRE : Level::MISMATCH;
+        _reason = Reason::LEVEL;
+    } else if(_confidence >= FIRE_CONFIDENCE && _peak >= _warning) {
+        _level = Level::FIRE;
+        _reason = Reason::RISE;
+    } else if(warning) {
+        _level = consistent ? Level::WARNING : Level::MISMATCH;
+        _reason = Reason::LEVEL;
+    } else if(_confidence >= WARNING_CONFIDENCE) {
+        _level = Level::WARNING;
+        _reason = Reason::RISE;
+    } else {
+        _level = Level::CLEAR;
+        _reason = Reason::NONE;
+    }
+    return _level;
+}
+
+int16_t SmokeFusion::getSlope(uint8_t sensor) const {
+    return sensor < SENSORS ? _sensors[sensor].slope : 0;
+}
+
+bool SmokeFusion::isRising(uint8_t sensor) const {
+    return sensor < SENSORS && _sensors[sensor].rising;
+}
+
+const SmokeFusion::Reading& SmokeFusion::_latest(const History& h) const {
+    return h.readings[(h.head + HISTORY - 1) % HISTORY];
+}
+
+bool SmokeFusion::_isFresh(const History& h, uint16_t now) const {
+    return h.count && (uint16_t)(now - _latest(h).time) <= STALE_SEC;
+}
+
+void SmokeFusion::_fit(History& h) {
+    // Least-squares slope over the kept readings, times relative to the
+    // oldest; once per heater cycle, so float is fine here. A rise needs a
+    // full history that only goes up, so a single spike does not count.
+    uint8_t first = (h.head + HISTORY - h.count) % HISTORY;
+    uint16_t t0 = h.readings[first].time;
+    float st = 0, sp = 0, stt = 0, stp = 0;
+    bool monotonic = true;
+    uint16_t previous = 0;
+
+    for(uint8_t n = 0; n < h.count; n++) {
+        const Reading& r = h.readings[(first + n) % HISTORY];
+        float t = (uint16_t)(r.time - t0);
+        st += t;
+        sp += r.ppm;
+        stt += t * t;
+        stp += t * r.ppm;
+        if(n > 0 && r.ppm < previous) monotonic = false;
+        previous = r.ppm;
+    }
+
+    float den = h.count * stt - st * st;
+    float slope = den > 0 ? (h.count * stp - st * sp) / den * 60 : 0;
+    h.slope = constrain(slope, -32767.0f, 32767.0f);
+    h.rising = h.count == HISTORY && monotonic && h.slope >= (int16_t)_riseRate;
+}
@@ -0,0 +1,89 @@
+#ifndef SMOKE_FUSION_H
+#define SMOKE_FUSION_H
+
+#include <Arduino.h>
+
+// Fire decision from the two MQ-7 sensors and the smoke relay. Besides the
+// absolute thresholds it keeps the last few readings of each sensor and
+// fits a slope, so a steady rise seen by both sensors is reported as a fire
+// before either reaches the critical level. A rise only counts as a fire
+// once a sensor is at the warning level; below it (a car idling in the
+// garage) it stays a warning. Readings arrive once per heater cycle; ppm
+// values are SmokeSensor::getPPMx10() units (ppm * 10).
+class SmokeFusion {
+public:
+    static constexpr uint8_t SENSORS = 2;
+    static constexpr uint8_t HISTORY = 3;           // readings per sensor, ~5 min
+    static constexpr uint16_t STALE_SEC = 400;      // ~2.5 heater cycles
+    static constexpr uint8_t FIRE_CONFIDENCE = 70;
+    static constexpr uint8_t WARNING_CONFIDENCE = 30;
+
+    enum class Level : uint8_t {
+        CLEAR,
+        MISMATCH,   // one sensor over a threshold, the other disagrees
+        WARNING,
+        FIRE
+    };
+
+    enum class Reason : uint8_t {
+        NONE,
+        LEVEL,      // absolute threshold
+        RISE,       // rate of rise
+        RELAY
+    };
+
+    // Configuration, ppm * 10
+    void setThresholds(uint16_t warning, uint16_t critical);
+    void setDifferential(uint16_t differential);
+    void setRiseRate(uint16_t perMinute);
+
+    void addReading(uint8_t sensor, uint16_t ppm, unsigned long now);
+    void setRelay(bool detected) { _relay = detected; }
+    Level evaluate(unsigned long now);
+    void reset();
+
+    // Results of the last evaluate()
+    Level getLevel() const { return _level; }
+    Reason getReason() const { return _reason; }
+    uint8_t getConfidence() const { return _confidence; }  // 0..100
+    uint16_t getPeak() const { return _peak; }             // highest fresh reading
+    int16_t getDifference() const { return _difference; } // sensor 1 - sensor 2
+
+    // Per sensor, from its last reading
+    int16_t getSlope(uint8_t sensor) const;                // ppm * 10 per minute
+    bool isRising(uint8_t sensor) const;
+
+private:
+    struct Reading {
+        uint16_t ppm;
+        uint16_t time;      // seconds, wraps after 18 h
+    };
+
+    struct History {
+        Reading readings[HISTORY];
+        uint8_t head = 0;   // next write position
+        uint8_t count = 0;
+        int16_t slope = 0;
+        bool rising = false;
+    };
+
+    History _sensors[SENSORS];
+    bool _relay = false;
+
+    uint16_t _warning = 300;
+    uint16_t _critical = 500;
+    uint16_t _differential = 150;
+    uint16_t _riseRate = 30;        // 3 ppm/min, ~7.5 ppm per heater cycle
+
+    Level _level = Level::CLEAR;
+    Reason _reason = Reason::NONE;
+    uint8_t _confidence = 0;
+    uint16_t _peak = 0;
+    int16_t _difference = 0;
+
+    const Reading& _latest(const History& h) const;
+    bool _isFresh(const History& h, uint16_t now) const;
+    void _fit(History& h);
+};
+
+#endif
@@ -44,22 +44,45 @@ void SmokeRelay::notifyCallbacks(SmokeStatus previousStatus, SmokeStatus newStat
 }
 
 bool SmokeRelay::update() {
-    SmokeStatus previousStatus = getStatus();
+    bool stateChanged = false;
+
+    if(_input) {
+        // Every debounced change since the last call, in order
+        bool level;
+        uint16_t time;
+        while(_input->fetch(_pin, level, time)) {
+            if(level == _state) continue;
+            setState(level);
+            stateChanged = true;
+        }
+        return stateChanged;
+    }
+
     bool rawState = readHardwareState();
     bool newState = applyDebounce(rawState);
-    bool stateChanged = false;
     
     if(newState != _state) {
-        _state = newState;
-        _lastStateChangeTime = millis();
-        _lastStableState = _state;
+        setState(newState);
         stateChanged = true;
-        notifyCallbacks(previousStatus, getStatus());
     }
     
     return stateChanged;
 }
 
+void SmokeRelay::setState(bool newState) {
+    SmokeStatus previousStatus = getStatus();
+    _state = newState;
+    _lastStateChangeTime = millis();
+    _lastStableState = _state;
+    notifyCallbacks(previousStatus, getStatus());
+}
+
+bool SmokeRelay::attachInput(InputSampler& input) {
+    if(!input.watch(_pin)) return false;
+    _input = &input;
+    return true;
+}
+
 SmokeRelay::SmokeStatus SmokeRelay::getStatus() const {
     if(millis() - _lastStateChangeTime > _errorThreshold) {
         return SmokeStatus::ERROR;
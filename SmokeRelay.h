@@ -2,17 +2,18 @@
 #define MY_SMOKE_RELAY_H
 
 #include <Arduino.h>
+#include <InputSampler.h>
 
 class SmokeRelay {
 public:
     // Relay electrical configuration types
-    enum class RelayType {
+    enum class RelayType : uint8_t {
         NORMALLY_OPEN,  // NO - Open circuit when inactive
         NORMALLY_CLOSED // NC - Closed circuit when inactive (default)
     };
 
     // Smoke detection states
-    enum class SmokeStatus {
+    enum class SmokeStatus : uint8_t {
         CLEAR,          // No smoke detected
         DETECTED,       // Smoke detected
         ERROR           // Sensor fault detected
@@ -35,11 +36,13 @@ private:
     SmokeCallback _detectionCallback = nullptr;  // Smoke detected callback
     SmokeCallback _clearCallback = nullptr;      // Clear air callback
     SmokeCallback _errorCallback = nullptr;      // Error callback
+    InputSampler* _input = nullptr;              // Shared debounced inputs, if attached
     
     void init();
     bool readHardwareState();
     bool applyDebounce(bool rawState);
     void notifyCallbacks(SmokeStatus previousStatus, SmokeStatus newStatus);
+    void setState(bool newState);
 
 public:
     explicit SmokeRelay(byte pin, RelayType type = RelayType::NORMALLY_CLOSED);
@@ -65,6 +68,9 @@ public:
     void onError(SmokeCallback callback);       // Error callback
     void onStatusChange(SmokeCallback callback); // Any state change callback
     
+    // Debounced by the InputSampler instead of polling, for pins A0..A5
+    bool attachInput(InputSampler& input);
+
     // State management
     bool update(); // Update state, returns true if changed
 };
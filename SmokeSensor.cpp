@@ -1,13 +1,86 @@
 #include "SmokeSensor.h"
+#include <EEPROM.h>
+#include <avr/pgmspace.h>
+#include <util/crc16.h>
 
 // Calibration constants
 #define RLOAD 10.0          // Load resistance (kΩ)
 #define PARA 116.6020682    // Parameter A for PPM conversion
 #define PARB 2.769034857    // Parameter B for PPM conversion
-float RZERO = 76.63;        // Calibration resistance (will be updated)
+#define CLEAN_AIR 9.8       // Rs/R0 in clean air
+#define CAL_VERSION 1       // first byte of the EEPROM slot
+
+// MQ-7 curve ppm = PARA * (Rs/R0)^-PARB with Rs = RLOAD * (1023 - raw) / raw.
+// In log2 it splits into a term of the ADC value and a term of R0:
+//   log2(ppm) = PARB * (log2(raw) - log2(1023 - raw))
+//             + log2(PARA) + PARB * (log2(R0) - log2(RLOAD))
+// The R0 term is recomputed only when R0 changes. Everything is Q10
+// log2 (1/1024 of an octave): log2 and 2^x are piecewise-linear over a
+// 33 point table of the mantissa, so a reading costs a few integer
+// operations instead of pow(). A curve sampled along the ADC range would
+// need a few hundred points to stay within 1% below ~60 counts, where the
+// clean air reading of a high-R0 sensor sits.
+// The builtins are folded by the compiler, nothing here runs on the board.
+static constexpr int32_t Q10 = 1024;
+
+static constexpr int16_t _roundQ(double x) {
+    return (int16_t)(x < 0 ? x - 0.5 : x + 0.5);
+}
+
+#define FRAC_33(f) f(0), f(1), f(2), f(3), f(4), f(5), f(6), f(7), f(8), f(9), \
+                   f(10), f(11), f(12), f(13), f(14), f(15), f(16), f(17), f(18), \
+                   f(19), f(20), f(21), f(22), f(23), f(24), f(25), f(26), f(27), \
+                   f(28), f(29), f(30), f(31), f(32)
+#define LOG2_POINT(i) _roundQ(Q10 * __builtin_log2(1.0 + (i) / 32.0))
+#define EXP2_POINT(i) (uint16_t)(16384 * __builtin_exp2((i) / 32.0) + 0.5)
+
+static const int16_t _log2Frac[33] PROGMEM = { FRAC_33(LOG2_POINT) };    // Q10
+static const uint16_t _exp2Frac[33] PROGMEM = { FRAC_33(EXP2_POINT) };   // Q14
+
+// R0-independent part of the offset; the x10 makes the result ppm * 10
+static constexpr int32_t CURVE_BASE =
+    _roundQ(Q10 * (__builtin_log2(PARA) + __builtin_log2(10.0) - PARB * __builtin_log2(RLOAD)));
+static constexpr int32_t CURVE_PARB = _roundQ(PARB * Q10);
+
+static int32_t _log2Q10(uint32_t v) {
+    // v > 0; integer part from the leading bit, fraction from the table
+    int32_t result = 31 * Q10;
+    if(!(v & 0xFFFF0000UL)) {
+        v <<= 16;
+        result -= 16 * Q10;
+    }
+    if(!(v & 0xFF000000UL)) {
+        v <<= 8;
+        result -= 8 * Q10;
+    }
+    while(!(v & 0x80000000UL)) {
+        v <<= 1;
+        result -= Q10;
+    }
+    uint16_t frac = (v >> 21) & 0x3FF;
+    uint8_t i = frac >> 5;
+    int16_t a = pgm_read_word(&_log2Frac[i]);
+    int16_t b = pgm_read_word(&_log2Frac[i + 1]);
+    return result + a + (((b - a) * (frac & 0x1F)) >> 5);
+}
+
+static uint16_t _exp2Q10(int32_t x) {
+    if(x < -Q10) return 0;
+    if(x < 0) return 1;                        // 0.5 .. 1, rounded up
+    if(x >= 16 * Q10) return 0xFFFF;
+    uint8_t n = x >> 10;
+    uint16_t frac = x & 0x3FF;
+    uint8_t i = frac >> 5;
+    uint16_t a = pgm_read_word(&_exp2Frac[i]);
+    uint16_t b = pgm_read_word(&_exp2Frac[i + 1]);
+    uint32_t m = a + (((uint32_t)(b - a) * (frac & 0x1F)) >> 5);
+    uint32_t result = ((m << n) + (1UL << 13)) >> 14;
+    return result > 0xFFFF ? 0xFFFF : result;
+}
 
 SmokeSensor::SmokeSensor(byte pinIn, byte pinHeat) 
     : _pinIn(pinIn), _pinHeat(pinHeat) {
+    _curveOffset = curveOffset(_r0);
     init();
 }
 
@@ -19,12 +92,17 @@ void SmokeSensor::init() {
 
 void SmokeSensor::beginMeasurement() {
     _isEnabled = true;
-    startHeating();
+    if(_externalHeater) {
+        // Joins the heater cycle at its next phase
+        _currentState = SensorState::IDLE;
+    } else {
+        startHeating();
+    }
 }
 
 void SmokeSensor::stopMeasurement() {
     _isEnabled = false;
-    digitalWrite(_pinHeat, LOW);
+    if(!_externalHeater) digitalWrite(_pinHeat, LOW);
     _currentState = SensorState::IDLE;
     if(_stateChangeCallback) {
         _stateChangeCallback(_currentState);
@@ -32,22 +110,39 @@ void SmokeSensor::stopMeasurement() {
 }
 
 void SmokeSensor::update() {
-    if(!_isEnabled) return;
+    if(!_isEnabled) {
+        // Not cycling: calibrate on the current reading, one per call
+        if(_calibrating) calibrationSample(analogRead(_pinIn));
+        return;
+    }
 
     unsigned long currentTime = millis();
     SensorState previousState = _currentState;
     
     switch(_currentState) {
+        // With an external heater the phases come from heaterPhase()
         case SensorState::HEATING:
-            if(currentTime - _phaseStartTime >= _heatingDuration) {
+            if(!_externalHeater && currentTime - _phaseStartTime >= _heatingSec * 1000UL) {
                 startCooling();
             }
             break;
             
         case SensorState::COOLING:
-            if(currentTime - _phaseStartTime >= _coolingDuration) {
+            if(!_externalHeater &&
+               currentTime - _phaseStartTime >= _coolingSec * 1000UL - _sampleWindow) {
+                startSampling();
+            }
+            break;
+
+        case SensorState::MEASURING:
+            // One reading per call at most, spread evenly over the window;
+            // readings missed by a slow loop are simply left out
+            if(!_externalHeater && currentTime - _phaseStartTime >= _coolingSec * 1000UL) {
                 takeMeasurement();
                 startHeating();
+            } else if(_sampleCount < SAMPLE_COUNT &&
+                      currentTime - _windowStart >= (unsigned long)_sampleWindow * _sampleCount / SAMPLE_COUNT) {
+                takeSample();
             }
             break;
             
@@ -59,40 +154,119 @@ void SmokeSensor::update() {
     }
 }
 
+void SmokeSensor::heaterPhase(SensorState state) {
+    if(!_isEnabled || state == _currentState) return;
+
+    // The window closes when the heater goes back to high
+    if(_currentState == SensorState::MEASURING) takeMeasurement();
+    switch(state) {
+        case SensorState::HEATING:   startHeating(); break;
+        case SensorState::COOLING:   startCooling(); break;
+        case SensorState::MEASURING: startSampling(); break;
+        default:                     _currentState = SensorState::IDLE; break;
+    }
+
+    if(_stateChangeCallback) {
+        _stateChangeCallback(_currentState);
+    }
+}
+
+void SmokeSensor::setExternalHeater(bool external) {
+    _externalHeater = external;
+}
+
+byte SmokeSensor::getHeaterPin() const {
+    return _pinHeat;
+}
+
 void SmokeSensor::startHeating() {
-    digitalWrite(_pinHeat, HIGH);
+    if(!_externalHeater) digitalWrite(_pinHeat, HIGH);
     _phaseStartTime = millis();
     _currentState = SensorState::HEATING;
 }
 
 void SmokeSensor::startCooling() {
-    digitalWrite(_pinHeat, LOW);
+    if(!_externalHeater) digitalWrite(_pinHeat, LOW);
     _phaseStartTime = millis();
     _currentState = SensorState::COOLING;
 }
 
-void SmokeSensor::takeMeasurement() {
-    int rawValue = analogRead(_pinIn);
-    _ppm = convertToPPM(rawValue);
+void SmokeSensor::startSampling() {
+    // Heater stays low, the phase timer keeps running from startCooling()
+    _windowStart = millis();
+    _sampleCount = 0;
+    _sampleSum = 0;
+    _sampleSumSq = 0;
     _currentState = SensorState::MEASURING;
+}
+
+void SmokeSensor::takeSample() {
+    uint16_t raw = analogRead(_pinIn);
+    if(_sampleCount == 0) {
+        _median[0] = _median[1] = raw;
+    }
+
+    // Median of this and the previous two readings drops single spikes
+    uint16_t a = _median[0], b = _median[1], m = raw;
+    if((a <= b && b <= raw) || (raw <= b && b <= a)) m = b;
+    else if((b <= a && a <= raw) || (raw <= a && a <= b)) m = a;
+    _median[0] = b;
+    _median[1] = raw;
+
+    if(_sampleCount == 0) {
+        _emaQ4 = m << 4;
+    } else {
+        _emaQ4 += ((int16_t)(m << 4) - (int16_t)_emaQ4) / 4;
+    }
+
+    _sampleSum += raw;
+    _sampleSumSq += (uint32_t)raw * raw;
+    _sampleCount++;
+
+    if(_calibrating) calibrationSample(raw);
+}
+
+void SmokeSensor::takeMeasurement() {
+    if(_sampleCount == 0) takeSample();
+
+    uint32_t n = _sampleCount;
+    uint32_t spread = n * _sampleSumSq - (uint32_t)_sampleSum * _sampleSum;
+    uint32_t variance = spread / (n * n);
+    _variance = variance > 0xFFFF ? 0xFFFF : variance;
+    _lastSampleCount = _sampleCount;
+    _filteredRaw = (_emaQ4 + 8) >> 4;
+    _ppmX10 = convertToPPM(_filteredRaw);
     
+    float ppm = getPPM();
     if(_measurementCallback) {
-        _measurementCallback(_ppm);
+        _measurementCallback(ppm);
     }
     
-    checkAlert(_ppm);
+    checkAlert(ppm);
+}
+
+uint16_t SmokeSensor::convertToPPM(int rawValue) {
+    return rawToPPMx10(rawValue, _curveOffset);
 }
 
-float SmokeSensor::convertToPPM(int rawValue) {
-    float voltage = rawValue * (5.0 / 1023.0);
-    float rs = ((5.0 * RLOAD) / voltage) - RLOAD;
-    float ratio = rs / RZERO;
-    return PARA * pow(ratio, -PARB);
+int16_t SmokeSensor::curveOffset(float r0) {
+    // R0 in kOhm, taken as Q10 for the integer log2
+    uint32_t r0Q10 = r0 > 0 ? r0 * Q10 : 0;
+    if(r0Q10 == 0) r0Q10 = 1;
+    int32_t r0Log = _log2Q10(r0Q10) - 10 * Q10;
+    return CURVE_BASE + ((r0Log * CURVE_PARB) >> 10);
+}
+
+uint16_t SmokeSensor::rawToPPMx10(int rawValue, int16_t offset) {
+    if(rawValue <= 0) return 0;
+    if(rawValue >= 1023) return 0xFFFF;
+    int32_t ratioLog = _log2Q10(rawValue) - _log2Q10(1023 - rawValue);
+    return _exp2Q10(((ratioLog * CURVE_PARB) >> 10) + offset);
 }
 
 void SmokeSensor::checkAlert(float ppm) {
     if(_alertCallback) {
-        bool isCritical = (ppm >= _criticalThreshold);
+        bool isCritical = (_ppmX10 >= _criticalX10);
         _alertCallback(ppm, isCritical);
     }
 }
@@ -109,14 +283,34 @@ void SmokeSensor::onAlert(AlertCallback callback) {
     _alertCallback = callback;
 }
 
+void SmokeSensor::onCalibrated(CalibrationCallback callback) {
+    _calibrationCallback = callback;
+}
+
 float SmokeSensor::getPPM() const {
-    return _ppm;
+    return _ppmX10 * 0.1f;
+}
+
+uint16_t SmokeSensor::getPPMx10() const {
+    return _ppmX10;
 }
 
 int SmokeSensor::getRawValue() const {
     return analogRead(_pinIn);
 }
 
+uint16_t SmokeSensor::getFilteredRaw() const {
+    return _filteredRaw;
+}
+
+uint16_t SmokeSensor::getVariance() const {
+    return _variance;
+}
+
+uint8_t SmokeSensor::getSampleCount() const {
+    return _lastSampleCount;
+}
+
 SmokeSensor::SensorState SmokeSensor::getState() const {
     return _currentState;
 }
@@ -126,37 +320,106 @@ bool SmokeSensor::isMeasuring() const {
 }
 
 void SmokeSensor::calibrateCleanAir() {
-    float rs = 0.0;
-    for(int i = 0; i < 100; i++) {
-        rs += ((5.0 * RLOAD) / (analogRead(_pinIn) * (5.0 / 1023.0))) - RLOAD;
-        delay(10);
+    // Readings are collected in update(): inside the sampling windows while
+    // the heater cycles, so R0 matches the measurement conditions
+    _calibrating = true;
+    _calCount = 0;
+    _calSum = 0;
+}
+
+bool SmokeSensor::isCalibrating() const {
+    return _calibrating;
+}
+
+void SmokeSensor::calibrationSample(uint16_t raw) {
+    if(raw == 0 || raw >= 1023) return;     // open or shorted, not a resistance
+    _calSum += RLOAD * (1023.0 / raw - 1);  // Rs (kΩ)
+    if(++_calCount < CAL_SAMPLES) return;
+
+    _calibrating = false;
+    setR0(_calSum / _calCount / CLEAN_AIR);
+    saveCalibration();
+    if(_calibrationCallback) {
+        _calibrationCallback(_r0);
+    }
+}
+
+void SmokeSensor::setR0(float r0) {
+    _r0 = r0;
+    _curveOffset = curveOffset(r0);
+}
+
+float SmokeSensor::getR0() const {
+    return _r0;
+}
+
+uint8_t SmokeSensor::slotCrc(const uint8_t* slot) {
+    uint8_t crc = 0;
+    for(uint8_t i = 0; i < CAL_SLOT_SIZE - 1; i++) {
+        crc = _crc8_ccitt_update(crc, slot[i]);
+    }
+    return crc;
+}
+
+bool SmokeSensor::loadCalibration(uint16_t address) {
+    // [version][R0 float][CRC-8]; an erased or torn slot keeps the default
+    _calAddress = address;
+    uint8_t slot[CAL_SLOT_SIZE];
+    for(uint8_t i = 0; i < CAL_SLOT_SIZE; i++) {
+        slot[i] = EEPROM.read(address + i);
+    }
+    if(slot[0] != CAL_VERSION || slotCrc(slot) != slot[CAL_SLOT_SIZE - 1]) return false;
+
+    float r0;
+    memcpy(&r0, slot + 1, sizeof(r0));
+    if(!(r0 > 0.1f && r0 < 10000.0f)) return false;
+    setR0(r0);
+    return true;
+}
+
+void SmokeSensor::saveCalibration() {
+    if(_calAddress == NO_CAL_SLOT) return;
+    uint8_t slot[CAL_SLOT_SIZE];
+    slot[0] = CAL_VERSION;
+    memcpy(slot + 1, &_r0, sizeof(_r0));
+    slot[CAL_SLOT_SIZE - 1] = slotCrc(slot);
+    for(uint8_t i = 0; i < CAL_SLOT_SIZE; i++) {
+        EEPROM.update(_calAddress + i, slot[i]);
     }
-    RZERO = rs / 9.8; // Clean air calibration factor
 }
 
 void SmokeSensor::setHeatingDuration(unsigned long duration) {
-    _heatingDuration = duration;
+    _heatingSec = duration / 1000;
 }
 
 void SmokeSensor::setCoolingDuration(unsigned long duration) {
-    _coolingDuration = duration;
+    _coolingSec = duration / 1000;
+    if(_sampleWindow > duration) _sampleWindow = duration;
+}
+
+void SmokeSensor::setSampleWindow(uint16_t window) {
+    _sampleWindow = min((unsigned long)window, _coolingSec * 1000UL);
 }
 
 void SmokeSensor::setAlertThreshold(float threshold) {
-    _alertThreshold = threshold;
+    _alertX10 = toX10(threshold);
 }
 
 void SmokeSensor::setThresholds(float warning, float critical) {
-    _warningThreshold = warning;
-    _criticalThreshold = critical;
-    _alertThreshold = warning; // Or use separate logic
+    _criticalX10 = toX10(critical);
+    _alertX10 = toX10(warning); // Or use separate logic
+}
+
+uint16_t SmokeSensor::toX10(float ppm) {
+    if(ppm <= 0) return 0;
+    return ppm >= 6553.5f ? 0xFFFF : (uint16_t)(ppm * 10 + 0.5f);
 }
 
 void SmokeSensor::checkLevels() {
     if (_alertCallback) {
         bool critical = isCriticalLevel();
         if (critical || isSmokeDetected()) {
-            _alertCallback(_ppm, critical);
+            _alertCallback(getPPM(), critical);
         }
     }
 }
@@ -166,7 +429,7 @@ bool SmokeSensor::isOperational() const {
     if(_pinIn == _pinHeat) return false;  // Invalid pin configuration
     
     // Check if sensor is stuck in one state
-    const unsigned long MAX_STATE_DURATION = _heatingDuration * 3;  // 3x heating cycle
+    const unsigned long MAX_STATE_DURATION = _heatingSec * 3000UL;  // 3x heating cycle
     if(_currentState != SensorState::IDLE && 
        millis() - _phaseStartTime > MAX_STATE_DURATION) {
         return false;
@@ -190,9 +453,9 @@ bool SmokeSensor::isOperational() const {
 }
 
 bool SmokeSensor::isSmokeDetected() const {
-    return _ppm >= _alertThreshold;
+    return _ppmX10 >= _alertX10;
 }
 
 bool SmokeSensor::isCriticalLevel() const {
-    return _ppm >= _criticalThreshold;
+    return _ppmX10 >= _criticalX10;
 }
\ No newline at end of file
@@ -9,7 +9,7 @@ public:
 	bool isOperational() const;
 	
     // Sensor operational states
-    enum class SensorState {
+    enum class SensorState : uint8_t {
         HEATING,    // Heating cycle active
         COOLING,    // Cooling period
         MEASURING,  // Taking measurement
@@ -20,34 +20,69 @@ public:
     typedef void (*MeasurementCallback)(float ppm);
     typedef void (*StateChangeCallback)(SensorState state);
 	typedef void (*AlertCallback)(float ppm, bool isCritical);
+    typedef void (*CalibrationCallback)(float r0);
 	void setAlertThreshold(float threshold);
 	void checkLevels();
 private:
     byte _pinIn;                    // Analog input pin
     byte _pinHeat;                  // Heater control pin
-    unsigned long _heatingDuration = 60000;  // Heating time (ms)
-    unsigned long _coolingDuration = 90000;  // Cooling time (ms)
+    uint16_t _heatingSec = 60;               // Heating time (s)
+    uint16_t _coolingSec = 90;               // Cooling time (s)
+    uint16_t _sampleWindow = 8000;           // Sampling at the end of cooling (ms)
     unsigned long _phaseStartTime = 0;       // Phase timer
+    unsigned long _windowStart = 0;          // Start of the sampling window
     SensorState _currentState = SensorState::IDLE;
-    float _ppm = 0.0;               // Current PPM reading
+    uint16_t _ppmX10 = 0;           // Current PPM reading * 10
+    float _r0 = DEFAULT_R0;         // Sensor resistance in clean air (kOhm)
+    int16_t _curveOffset = 0;       // R0 part of the ppm curve
+
+    // Clean air calibration, CAL_SAMPLES readings averaged
+    bool _calibrating = false;
+    uint8_t _calCount = 0;
+    float _calSum = 0.0;            // of Rs (kOhm)
+    uint16_t _calAddress = NO_CAL_SLOT;
+
+    // Measurement window: SAMPLE_COUNT readings spread over _sampleWindow,
+    // each through a median of three, then an EMA (alpha 1/4, raw * 16)
+    uint8_t _sampleCount = 0;
+    uint16_t _median[2] = {0, 0};   // previous two readings
+    uint16_t _emaQ4 = 0;
+    uint16_t _sampleSum = 0;        // of the unfiltered readings, for the variance
+    uint32_t _sampleSumSq = 0;
+    uint16_t _filteredRaw = 0;      // results of the last completed window
+    uint16_t _variance = 0;
+    uint8_t _lastSampleCount = 0;
     bool _isEnabled = false;        // Measurement active flag
-    float _alertThreshold = 50.0;   // Alert threshold (PPM)
-    float _criticalThreshold = 100.0; // Critical threshold (PPM)
-    float _warningThreshold = 30.0;  // Warning threshold (PPM)
+    bool _externalHeater = false;   // Phases driven by a HeaterCycle
+    uint16_t _alertX10 = 500;       // Alert threshold (PPM * 10)
+    uint16_t _criticalX10 = 1000;   // Critical threshold (PPM * 10)
     
     // Callbacks
     MeasurementCallback _measurementCallback = nullptr;
     StateChangeCallback _stateChangeCallback = nullptr;
     AlertCallback _alertCallback = nullptr;
+    CalibrationCallback _calibrationCallback = nullptr;
     
     void init();
     void startHeating();
     void startCooling();
+    void startSampling();
+    void takeSample();
     void takeMeasurement();
-    float convertToPPM(int rawValue);
+    uint16_t convertToPPM(int rawValue);
     void checkAlert(float ppm);
+    void calibrationSample(uint16_t raw);
+    void saveCalibration();
+    static uint8_t slotCrc(const uint8_t* slot);
+    static uint16_t toX10(float ppm);
 
 public:
+    static constexpr uint8_t SAMPLE_COUNT = 16;
+    static constexpr float DEFAULT_R0 = 76.63;     // kOhm, until calibrated
+    static constexpr uint8_t CAL_SAMPLES = 48;     // three sampling windows
+    static constexpr uint8_t CAL_SLOT_SIZE = 6;    // EEPROM bytes per sensor
+    static constexpr uint16_t NO_CAL_SLOT = 0xFFFF;
+
     // Constructor with I/O pins
     explicit SmokeSensor(byte pinIn, byte pinHeat);
     
@@ -56,14 +91,25 @@ public:
     void stopMeasurement();
     void update();
     
-    // Configuration
+    // Configuration (ms); heating and cooling are kept in whole seconds
     void setHeatingDuration(unsigned long duration);
     void setCoolingDuration(unsigned long duration);
+    void setSampleWindow(uint16_t window);         // clamped to the cooling time
+
+    // A HeaterCycle owns the heater pin and calls heaterPhase() instead of
+    // the sensor running its own timers; update() then only samples
+    void setExternalHeater(bool external);
+    void heaterPhase(SensorState state);
+    byte getHeaterPin() const;
 	void setThresholds(float warning, float critical);
     
     // Data access
     float getPPM() const;
+    uint16_t getPPMx10() const;     // fixed point, saturates at 6553.5 ppm
     int getRawValue() const;
+    uint16_t getFilteredRaw() const;   // ADC counts, last measurement window
+    uint16_t getVariance() const;      // of the window's readings, counts^2
+    uint8_t getSampleCount() const;    // readings that went into it
     SensorState getState() const;
     bool isMeasuring() const;
     bool isSmokeDetected() const;
@@ -72,9 +118,21 @@ public:
     void onMeasurement(MeasurementCallback callback);
     void onStateChange(StateChangeCallback callback);
 	void onAlert(AlertCallback callback);	
+    void onCalibrated(CalibrationCallback callback);
     
-    // Calibration
+    // Calibration. calibrateCleanAir() only starts it; update() collects
+    // the readings and the new R0 is saved to the slot given to
+    // loadCalibration(), which also restores it at startup.
     void calibrateCleanAir();
+    bool isCalibrating() const;
+    bool loadCalibration(uint16_t address);   // false: empty or corrupt slot
+    float getR0() const;
+    void setR0(float r0);
+
+    // Fixed-point MQ-7 curve: ppm * 10 for a 10-bit reading. The offset
+    // holds the R0 (kOhm) dependent part, see SmokeSensor.cpp.
+    static int16_t curveOffset(float r0);
+    static uint16_t rawToPPMx10(int rawValue, int16_t offset);
 };
 
 #endif
\ No newline at end of file
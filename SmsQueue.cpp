@@ -0,0 +1,179 @@
+#include "SmsQueue.h"
+
+SmsQueue::SmsQueue(GSMController& gsm) : _gsm(gsm) {
+    for(uint8_t i = 0; i < CAPACITY; i++) {
+        _entries[i].used = false;
+    }
+}
+
+void SmsQueue::setRecipient(uint8_t index, const char* number) {
+    if(index < MAX_RECIPIENTS) _numbers[index] = number;
+}
+
+const char* SmsQueue::getRecipient(uint8_t index) const {
+    return index < MAX_RECIPIENTS && _numbers[index] ? _numbers[index] : "";
+}
+
+uint8_t SmsQueue::findRecipient(const char* number) const {
+    if(!number || !number[0]) return 0;
+    for(uint8_t i = 0; i < MAX_RECIPIENTS; i++) {
+        if(_numbers[i] && strcmp(_numbers[i], number) == 0) return 1 << i;
+    }
+    return 0;
+}
+
+bool SmsQueue::enqueue(Priority priority, uint8_t recipients, const char* text, Topic topic) {
+    uint8_t mask = _usableMask(recipients);
+    if(!mask || !text) return false;
+
+    for(uint8_t i = 0; i < CAPACITY; i++) {
+        Entry& e = _entries[i];
+        if(!e.used) continue;
+
+        // Same text already queued: just widen its recipients
+        if(e.topic == topic && strncmp(e.text, text, SMS_BUFFER_SIZE - 1) == 0) {
+            e.pending |= mask & ~e.inFlight;
+            if(priority > e.priority) e.priority = priority;
+            _coalesced++;
+            return true;
+        }
+
+        // Older message on the same topic is superseded for these recipients
+        if(topic != Topic::NONE && e.topic == topic && (e.pending & mask)) {
+            e.pending &= ~mask;
+            _coalesced++;
+            if(!e.pending && !e.inFlight) _release(i);
+        }
+    }
+
+    uint8_t slot = _findFree(priority);
+    if(slot == NONE) {
+        _dropped++;
+        return false;
+    }
+
+    Entry& e = _entries[slot];
+    e.used = true;
+    e.priority = priority;
+    e.topic = topic;
+    e.seq = _nextSeq++;
+    e.pending = mask;
+    e.inFlight = 0;
+    e.attempts = 0;
+    strncpy(e.text, text, SMS_BUFFER_SIZE - 1);
+    e.text[SMS_BUFFER_SIZE - 1] = '\0';
+    return true;
+}
+
+void SmsQueue::update() {
+    if(_sending) return;
+    if(_gsm.getNetworkStatus() != GSMController::NetworkStatus::REGISTERED_HOME || _gsm.isBusy()) return;
+
+    uint8_t index = _selectNext();
+    if(index == NONE) return;
+
+    Entry& e = _entries[index];
+    uint8_t bit = e.pending & -e.pending;   // lowest pending recipient
+    uint8_t recipient = 0;
+    while(!(bit & (1 << recipient))) recipient++;
+
+    const char* number = _numbers[recipient];
+    if(!number || !number[0]) {
+        // Number was cleared after the message was queued
+        e.pending &= ~bit;
+        if(!e.pending && !e.inFlight) _release(index);
+        return;
+    }
+
+    if(_gsm.sendSMS(number, e.text, _onSent, this)) {
+        e.pending &= ~bit;
+        e.inFlight = bit;
+        _sending = true;
+        _sendingEntry = index;
+    }
+}
+
+uint8_t SmsQueue::getPendingCount() const {
+    uint8_t count = 0;
+    for(uint8_t i = 0; i < CAPACITY; i++) {
+        if(!_entries[i].used) continue;
+        for(uint8_t bits = _entries[i].pending | _entries[i].inFlight; bits; bits &= bits - 1) {
+            count++;
+        }
+    }
+    return count;
+}
+
+uint8_t SmsQueue::_usableMask(uint8_t recipients) const {
+    uint8_t mask = 0;
+    for(uint8_t i = 0; i < MAX_RECIPIENTS; i++) {
+        if((recipients & (1 << i)) && _numbers[i] && _numbers[i][0]) mask |= 1 << i;
+    }
+    return mask;
+}
+
+uint8_t SmsQueue::_findFree(Priority priority) {
+    for(uint8_t i = 0; i < CAPACITY; i++) {
+        if(!_entries[i].used) return i;
+    }
+
+    // Full: evict the oldest lower-priority message that is not being sent
+    uint8_t victim = NONE;
+    for(uint8_t i = 0; i < CAPACITY; i++) {
+        const Entry& e = _entries[i];
+        if(e.priority >= priority || e.inFlight) continue;
+        if(victim == NONE || e.priority < _entries[victim].priority ||
+           (e.priority == _entries[victim].priority &&
+            (uint8_t)(_nextSeq - e.seq) > (uint8_t)(_nextSeq - _entries[victim].seq))) {
+            victim = i;
+        }
+    }
+    if(victim != NONE) {
+        _dropped++;
+        _release(victim);
+    }
+    return victim;
+}
+
+uint8_t SmsQueue::_selectNext() const {
+    uint8_t best = NONE;
+    for(uint8_t i = 0; i < CAPACITY; i++) {
+        const Entry& e = _entries[i];
+        if(!e.used || !e.pending) continue;
+        if(best == NONE || e.priority > _entries[best].priority ||
+           (e.priority == _entries[best].priority &&
+            (uint8_t)(_nextSeq - e.seq) > (uint8_t)(_nextSeq - _entries[best].seq))) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+void SmsQueue::_release(uint8_t index) {
+    _entries[index].used = false;
+    _entries[index].pending = 0;
+    _entries[index].inFlight = 0;
+}
+
+void SmsQueue::_onSent(void* context, bool success, const char*) {
+    static_cast<SmsQueue*>(context)->_handleSent(success);
+}
+
+void SmsQueue::_handleSent(bool success) {
+    _sending = false;
+    if(_sendingEntry == NONE) return;
+
+    Entry& e = _entries[_sendingEntry];
+    _sendingEntry = NONE;
+
+    // Attempts are counted per message, not per recipient
+    if(!success) {
+        if(++e.attempts < MAX_ATTEMPTS) {
+            e.pending |= e.inFlight;
+        } else {
+            _dropped++;
+        }
+    }
+    e.inFlight = 0;
+    if(!e.pending) _release(&e - _entries);
+}
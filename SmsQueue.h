@@ -0,0 +1,87 @@
+#ifndef SMS_QUEUE_H
+#define SMS_QUEUE_H
+
+#include <Arduino.h>
+#include <GSMController.h>
+
+// Outbound SMS queue. A message is stored once with a recipient mask and
+// handed to the modem one recipient at a time, highest priority first.
+// Duplicates merge their recipients; a newer message on the same topic
+// replaces the older one for everyone it has not reached yet.
+class SmsQueue {
+public:
+    enum class Priority : uint8_t {
+        STATUS,
+        INTRUSION,
+        FIRE
+    };
+
+    enum class Topic : uint8_t {
+        NONE,          // never superseded
+        STATE,         // arm/disarm notifications: only the latest matters
+        ALERT_REPEAT,  // periodic "alarm still active" reminders
+        SMOKE_RISE     // CO rise below the warning level
+    };
+
+    // Recipient bits, indexes into the number table
+    enum Recipient : uint8_t {
+        ADMIN1 = 0x01,
+        ADMIN2 = 0x02,
+        USER1  = 0x04,
+        USER2  = 0x08,
+        ADMINS = ADMIN1 | ADMIN2,
+        ALL    = 0x0F
+    };
+
+    static constexpr uint8_t MAX_RECIPIENTS = 4;
+    static constexpr uint8_t CAPACITY = 2;      // an alert and one lower message
+    static constexpr uint8_t MAX_ATTEMPTS = 3;
+
+    SmsQueue(GSMController& gsm);
+
+    void setRecipient(uint8_t index, const char* number); // pointer is kept
+    const char* getRecipient(uint8_t index) const;        // "" if unset
+    uint8_t findRecipient(const char* number) const;      // recipient bit, 0 if unknown
+
+    // false if the queue is full of messages at the same or higher priority
+    bool enqueue(Priority priority, uint8_t recipients, const char* text,
+                 Topic topic = Topic::NONE);
+    void update(); // Hand the next SMS to the modem when it is free
+
+    uint8_t getPendingCount() const;
+    uint16_t getCoalescedCount() const { return _coalesced; }
+    uint16_t getDroppedCount() const { return _dropped; }
+
+private:
+    static constexpr uint8_t NONE = 0xFF;
+
+    struct Entry {
+        bool used;
+        Priority priority;
+        Topic topic;
+        uint8_t seq;        // arrival order within a priority
+        uint8_t pending;    // recipients not yet handed to the modem
+        uint8_t inFlight;   // recipient bit being sent, 0 if none
+        uint8_t attempts;
+        char text[SMS_BUFFER_SIZE];
+    };
+
+    GSMController& _gsm;
+    const char* _numbers[MAX_RECIPIENTS] = {nullptr};
+    Entry _entries[CAPACITY];
+    uint8_t _nextSeq = 0;
+    bool _sending = false;
+    uint8_t _sendingEntry = NONE;
+    uint16_t _coalesced = 0;
+    uint16_t _dropped = 0;
+
+    uint8_t _usableMask(uint8_t recipients) const;
+    uint8_t _findFree(Priority priority);
+    uint8_t _selectNext() const;
+    void _release(uint8_t index);
+
+    static void _onSent(void* context, bool success, const char* info);
+    void _handleSent(bool success);
+};
+
+#endif
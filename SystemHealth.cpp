@@ -0,0 +1,115 @@
+#include "SystemHealth.h"
+#include <avr/pgmspace.h>
+
+// Status codes, indexed by Component
+static const char _codeSmoke1[] PROGMEM = "S1";
+static const char _codeSmoke2[] PROGMEM = "S2";
+static const char _codeSmokeRelay[] PROGMEM = "SR";
+static const char _codeDoor[] PROGMEM = "D1";
+static const char _codeGate[] PROGMEM = "D2";
+static const char _codeGsm[] PROGMEM = "GSM";
+static const char _codeTemps[] PROGMEM = "TMP";
+
+static const char* const _codes[] PROGMEM = {
+    _codeSmoke1, _codeSmoke2, _codeSmokeRelay, _codeDoor, _codeGate, _codeGsm, _codeTemps
+};
+
+// Refresh periods (seconds), indexed by Component
+static const uint8_t _periods[] PROGMEM = {
+    10,  // SMOKE1: two ADC reads
+    10,  // SMOKE2
+    1,   // SMOKE_RELAY: RAM only
+    5,   // DOOR: one digitalRead
+    5,   // GATE
+    5,   // GSM: cached registration state
+    30   // TEMPS: cached device count and readings
+};
+
+static uint8_t _periodSec(uint8_t index) {
+    return pgm_read_byte(&_periods[index]);
+}
+
+SystemHealth::SystemHealth(SmokeSensor& smoke1, SmokeSensor& smoke2, SmokeRelay& smokeRelay,
+                           DoorSensor& door, DoorSensor& gate, GSMController& gsm, MultiDS18B20& temps)
+    : _smoke1(smoke1), _smoke2(smoke2), _smokeRelay(smokeRelay),
+      _door(door), _gate(gate), _gsm(gsm), _temps(temps) {}
+
+void SystemHealth::begin() {
+    for(uint8_t i = 0; i < COMPONENT_COUNT; i++) {
+        _refresh(i);
+    }
+}
+
+void SystemHealth::update() {
+    uint16_t now = _seconds();
+    uint8_t due = COMPONENT_COUNT;
+    uint16_t mostOverdue = 0;
+
+    for(uint8_t i = 0; i < COMPONENT_COUNT; i++) {
+        uint8_t period = _periodSec(i);
+        uint16_t age = now - _lastCheck[i];
+        if(age >= period && age - period >= mostOverdue) {
+            mostOverdue = age - period;
+            due = i;
+        }
+    }
+
+    if(due < COMPONENT_COUNT) {
+        _refresh(due);
+    }
+}
+
+bool SystemHealth::isOk(Component c) const {
+    return !(_failedMask & (1 << static_cast<uint8_t>(c)));
+}
+
+unsigned long SystemHealth::getAge(Component c) const {
+    return (uint16_t)(_seconds() - _lastCheck[static_cast<uint8_t>(c)]) * 1000UL;
+}
+
+bool SystemHealth::isStale(Component c) const {
+    return getAge(c) > _periodSec(static_cast<uint8_t>(c)) * 3000UL;
+}
+
+uint8_t SystemHealth::getStaleMask() const {
+    uint8_t mask = 0;
+    for(uint8_t i = 0; i < COMPONENT_COUNT; i++) {
+        if(isStale(static_cast<Component>(i))) mask |= 1 << i;
+    }
+    return mask;
+}
+
+void SystemHealth::formatStatus(char* buffer, size_t size) const {
+    strncpy_P(buffer, PSTR("H:"), size);
+    for(uint8_t i = 0; i < COMPONENT_COUNT; i++) {
+        if(!(_failedMask & (1 << i))) continue;
+        size_t len = strlen(buffer);
+        if(len > 2 && len + 1 < size) {
+            buffer[len++] = ',';
+            buffer[len] = '\0';
+        }
+        strncat_P(buffer, (const char*)pgm_read_ptr(&_codes[i]), size - len - 1);
+    }
+}
+
+bool SystemHealth::_check(Component c) {
+    switch(c) {
+        case Component::SMOKE1:      return _smoke1.isOperational();
+        case Component::SMOKE2:      return _smoke2.isOperational();
+        case Component::SMOKE_RELAY: return !_smokeRelay.isError();
+        case Component::DOOR:        return _door.isOperational();
+        case Component::GATE:        return _gate.isOperational();
+        case Component::GSM:         return _gsm.isOperational();
+        case Component::TEMPS:       return _temps.isOperational();
+        default:                     return true;
+    }
+}
+
+void SystemHealth::_refresh(uint8_t index) {
+    if(_check(static_cast<Component>(index))) {
+        _failedMask &= ~(1 << index);
+    } else {
+        _failedMask |= 1 << index;
+    }
+    _lastCheck[index] = _seconds();
+}
@@ -0,0 +1,62 @@
+#ifndef SYSTEM_HEALTH_H
+#define SYSTEM_HEALTH_H
+
+#include <Arduino.h>
+#include <DoorSensor.h>
+#include <GSMController.h>
+#include <MultiDS18B20.h>
+#include <SmokeRelay.h>
+#include <SmokeSensor.h>
+
+// Cached component health. Each component is re-checked on its own period
+// and update() runs at most one check per call, so the cost per loop pass
+// is bounded by the most expensive single check (two analogRead()s).
+// Check times are kept in whole seconds, 16 bits: ages are good to 18 h.
+class SystemHealth {
+public:
+    enum class Component : uint8_t {
+        SMOKE1,
+        SMOKE2,
+        SMOKE_RELAY,
+        DOOR,
+        GATE,
+        GSM,
+        TEMPS,
+        COUNT
+    };
+
+    SystemHealth(SmokeSensor& smoke1, SmokeSensor& smoke2, SmokeRelay& smokeRelay,
+                 DoorSensor& door, DoorSensor& gate, GSMController& gsm, MultiDS18B20& temps);
+
+    void begin();   // Check every component once
+    void update();  // Refresh the most overdue component, if any is due
+
+    // Snapshot
+    bool isHealthy() const { return _failedMask == 0; }
+    uint8_t getFailedMask() const { return _failedMask; }  // bit per Component
+    bool isOk(Component c) const;
+    unsigned long getAge(Component c) const;  // ms since last check
+    bool isStale(Component c) const;          // not checked for 3 periods
+    uint8_t getStaleMask() const;
+    void formatStatus(char* buffer, size_t size) const; // "H:S1,GSM"
+
+private:
+    static constexpr uint8_t COMPONENT_COUNT = static_cast<uint8_t>(Component::COUNT);
+
+    SmokeSensor& _smoke1;
+    SmokeSensor& _smoke2;
+    SmokeRelay& _smokeRelay;
+    DoorSensor& _door;
+    DoorSensor& _gate;
+    GSMController& _gsm;
+    MultiDS18B20& _temps;
+
+    uint16_t _lastCheck[COMPONENT_COUNT] = {0};     // seconds
+    uint8_t _failedMask = 0;
+
+    static uint16_t _seconds() { return millis() / 1000; }
+    bool _check(Component c);
+    void _refresh(uint8_t index);
+};
+
+#endif
@@ -1,30 +1,101 @@
 #include "SystemManager.h"
+#include <EepromLayout.h>
 #include <avr/pgmspace.h>
 
+static_assert(EEPROM_SMOKE_CAL_SLOT == SmokeSensor::CAL_SLOT_SIZE, "MQ-7 calibration slot size");
+static_assert(EEPROM_KEY_STORE_SIZE == KeyStore::STORE_SIZE, "key store size");
+static_assert(EEPROM_TEMP_HOURLY_SIZE == TempHistory::STORE_SIZE, "temperature history size");
+
 // Initialize static pointers
 SystemManager* SystemManager::_smoke1Instance = nullptr;
 SystemManager* SystemManager::_smoke2Instance = nullptr;
+SystemManager* SystemManager::_smokeRelayInstance = nullptr;
 SystemManager* SystemManager::_motionInstance = nullptr;
 SystemManager* SystemManager::_instanceForIButton = nullptr;
 SystemManager* SystemManager::_doorInstance = nullptr;
 SystemManager* SystemManager::_gateInstance = nullptr;
-
-// PROGMEM Messages (alphabetically ordered)
+SystemManager* SystemManager::_tempsInstance = nullptr;
+
+// PROGMEM Messages. A literal inside a PROGMEM pointer table would still
+// be copied to RAM, so each text is its own array.
+static const char _msgFire[] PROGMEM = "FIRE";
+static const char _msgIntrusion[] PROGMEM = "INTRUSION";
+static const char _msgBadIButton[] PROGMEM = "BAD_IBTN";
+static const char _msgHealthFail[] PROGMEM = "HEALTH_FAIL";
+static const char _msgKeyAdded[] PROGMEM = "KEY_ADD";
+static const char _msgKeyRemoved[] PROGMEM = "KEY_REM";
+static const char _msgSmokeMismatch[] PROGMEM = "SMK_MIS";
+static const char _msgArmed[] PROGMEM = "ARMED";
+static const char _msgArming[] PROGMEM = "ARMING";
+static const char _msgDisarmed[] PROGMEM = "DISARMED";
+static const char _msgReady[] PROGMEM = "READY";
+static const char _msgTemp[] PROGMEM = "TEMP";
+static const char _msgStatus[] PROGMEM = "STATUS";
+static const char _msgSmokeCal[] PROGMEM = "SMK_CAL";
+static const char _msgMotionDismissed[] PROGMEM = "PIR_1";
+static const char _msgEntry[] PROGMEM = "ENTRY";
+static const char _msgKeysRecovered[] PROGMEM = "KEY_REC";
+static const char _msgSmokeRise[] PROGMEM = "SMK_RISE";
+
+// In MsgID order
 static const char* const _messages[] PROGMEM = {
-    /* ALRM_FIRE */     "FIRE",          // 0
-    /* ALRM_INTRUSION */"INTRUSION",     // 1
-    /* BAD_IBUTTON */   "BAD_IBTN",      // 2
-    /* HEALTH_FAIL */   "HEALTH_FAIL",   // 3
-    /* KEY_ADDED */     "KEY_ADD",       // 4
-    /* KEY_REMOVED */   "KEY_REM",       // 5
-    /* SMOKE_MISMATCH */"SMK_MIS",       // 6
-    /* SYS_ARMED */     "ARMED",         // 7
-    /* SYS_ARMING */    "ARMING",        // 8
-    /* SYS_DISARMED */  "DISARMED",      // 9
-    /* SYS_READY */     "READY",         // 10
-    /* TEMP_READINGS */ "TEMP"           // 11
+    _msgFire,               // 0  ALRM_FIRE
+    _msgIntrusion,          // 1  ALRM_INTRUSION
+    _msgBadIButton,         // 2  BAD_IBUTTON
+    _msgHealthFail,         // 3  HEALTH_FAIL
+    _msgKeyAdded,           // 4  KEY_ADDED
+    _msgKeyRemoved,         // 5  KEY_REMOVED
+    _msgSmokeMismatch,      // 6  SMOKE_MISMATCH
+    _msgArmed,              // 7  SYS_ARMED
+    _msgArming,             // 8  SYS_ARMING
+    _msgDisarmed,           // 9  SYS_DISARMED
+    _msgReady,              // 10 SYS_READY
+    _msgTemp,               // 11 TEMP_READINGS
+    _msgStatus,             // 12 SENSOR_STATUS
+    _msgSmokeCal,           // 13 SMOKE_CALIBRATED
+    _msgMotionDismissed,    // 14 MOTION_DISMISSED
+    _msgEntry,              // 15 ENTRY_DELAY
+    _msgKeysRecovered,      // 16 KEYS_RECOVERED
+    _msgSmokeRise           // 17 SMOKE_RISE
 };
 
+// Written to a block that never held a key store; afterwards the EEPROM
+// copy is used, even when it is empty
+static const uint8_t _factoryKeys[][8] PROGMEM = {
+    {0x01, 0x66, 0x84, 0x27, 0x55, 0x00, 0x00, 0x20},
+    {0x01, 0x45, 0xE8, 0x13, 0x00, 0x00, 0x00, 0xF7}
+};
+
+// Alert text per Zone
+static const char _zoneDoor[] PROGMEM = "DOOR";
+static const char _zoneGate[] PROGMEM = "GATE";
+static const char _zoneMotion[] PROGMEM = "PIR";
+static const char _zoneSmoke[] PROGMEM = "SMKR";
+static const char* const _zoneNames[] PROGMEM = { _zoneDoor, _zoneGate, _zoneMotion, _zoneSmoke };
+
+// Why the system disarmed itself
+static const char _disarmAuto[] PROGMEM = "AUTO";
+static const char _disarmByCall[] PROGMEM = "BY_CALL";
+
+// Alert text per MotionAnalytics::Reason
+static const char _reasonNone[] PROGMEM = "";
+static const char _reasonSustained[] PROGMEM = "PIR_HOLD";
+static const char _reasonPerimeter[] PROGMEM = "PIR_DOOR";
+static const char* const _motionReasons[] PROGMEM = {
+    _reasonNone, _zoneMotion, _reasonSustained, _reasonPerimeter
+};
+
+// Scheduler task names
+static const char _taskGsm[] PROGMEM = "GSM";
+static const char _taskInputs[] PROGMEM = "INP";
+static const char _taskIButton[] PROGMEM = "IBTN";
+static const char _taskHeater[] PROGMEM = "MQ7";
+static const char _taskTemps[] PROGMEM = "TEMP";
+static const char _taskHealth[] PROGMEM = "HLTH";
+static const char _taskState[] PROGMEM = "STAT";
+static const char _taskSms[] PROGMEM = "SMSQ";
+static const char _taskLog[] PROGMEM = "LOG";
+
 SystemManager::SystemManager(GSMController& gsm, Alarm& alarm, SmokeSensor& smoke1, 
             SmokeSensor& smoke2, DoorSensor& door, DoorSensor& gate, iButtonAccess& ibutton, 
             EventLogger& logger, Buzzer& buzzer, MultiDS18B20& temps, SmokeRelay& smokeRelay, 
@@ -32,27 +103,63 @@ SystemManager::SystemManager(GSMController& gsm, Alarm& alarm, SmokeSensor& smok
     : _gsm(gsm), _alarm(alarm), _smoke1(smoke1), _smoke2(smoke2),
       _door(door), _gate(gate), _ibutton(ibutton), _logger(logger), 
       _buzzer(buzzer), _temps(temps), _smokeRelay(smokeRelay), 
-      _redLed(redLed), _yellowLed(yellowLed), _greenLed(greenLed), _motion(motion), _garageLight(garageLight) 
+      _redLed(redLed), _yellowLed(yellowLed), _greenLed(greenLed), _motion(motion), _garageLight(garageLight),
+      _health(smoke1, smoke2, smokeRelay, door, gate, gsm, temps),
+      _heater(smoke1.getHeaterPin()),
+      _inputs(_edgeCapture),
+      _smsQueue(gsm)
 {
-    // Initialize default keys
-	//01:66:84:27:55:00:00:20
-	//01:45:E8:13:00:00:00:F7
-    const uint8_t defaultKey1[8] = {0x01,0x66,0x84,0x27,0x55,0x00,0x00,0x20};
-    const uint8_t defaultKey2[8] = {0x01,0x45,0xE8,0x13,0x00,0x00,0x00,0xF7};
-    memcpy(_authorizedKeys[0], defaultKey1, 8);
-    memcpy(_authorizedKeys[1], defaultKey2, 8);
-    _numKeys = 2;
+    _smsQueue.setRecipient(0, "+79210308335");
 }
 
 const char* SystemManager::_getMessage(MsgID id) const {
     return (const char*)pgm_read_ptr(&_messages[static_cast<uint8_t>(id)]);
 }
 
+void SystemManager::_formatMessage(char* buffer, size_t size, MsgID id, const char* extra) const {
+    // "NAME" or "NAME:extra"; the name is in flash, extra in RAM
+    strncpy_P(buffer, _getMessage(id), size - 1);
+    buffer[size - 1] = '\0';
+    if(extra) {
+        size_t len = strlen(buffer);
+        snprintf_P(buffer + len, size - len, PSTR(":%s"), extra);
+    }
+}
+
 void SystemManager::begin() {
-    if(!_checkSystemHealth()) {
-        _logEvent(MsgID::HEALTH_FAIL);
-        return;
+    _logger.setCodeNames(_messages, sizeof(_messages) / sizeof(_messages[0]));
+    _logger.begin();
+    _smoke1.loadCalibration(EEPROM_SMOKE_CAL);
+    _smoke2.loadCalibration(EEPROM_SMOKE_CAL + EEPROM_SMOKE_CAL_SLOT);
+    _tempHistory.begin(EEPROM_TEMP_HOURLY);
+    if(!_keys.begin(EEPROM_KEY_STORE)) {
+        uint8_t key[8];
+        for(uint8_t i = 0; i < sizeof(_factoryKeys) / sizeof(_factoryKeys[0]); i++) {
+            memcpy_P(key, _factoryKeys[i], sizeof(key));
+            _keys.add(key);
+        }
+    } else if(_keys.wasRecovered()) {
+        _logEvent(MsgID::KEYS_RECOVERED, nullptr, _keys.getCount());
     }
+    _instanceForIButton = this;
+    _ibutton.setKeyStore(_keys);
+    _ibutton.setAccessGrantedCallback(_handleIButtonAccessStatic);
+    _ibutton.setAccessDeniedCallback(_handleIButtonAccessStatic);
+    _heater.attach(_smoke1);
+    _heater.attach(_smoke2);
+    // Inputs on A0..A5 switch from per-driver polling to one debounced
+    // port sample, backed by interrupt edges
+    _edgeCapture.begin();
+    _door.attachInput(_inputs);
+    _gate.attachInput(_inputs);
+    _motion.attachInput(_inputs);
+    _smokeRelay.attachInput(_inputs);
+    _inputs.begin();
+    // Temperature history is kept even if the system does not come up
+    _tempsInstance = this;
+    _temps.setTemperatureCallback(_handleTemperatureStatic);
+    _health.begin();
+    _registerTasks();
 
     _alarm.init();
     _ibutton.begin();
@@ -65,8 +172,14 @@ void SystemManager::begin() {
     // Setup callbacks
     _smoke1Instance = this;
     _smoke2Instance = this;
-    _smoke1.onAlert(_handleSmoke1AlertStatic);
-    _smoke2.onAlert(_handleSmoke2AlertStatic);
+    _smokeRelayInstance = this;
+    _smoke1.onMeasurement(_handleSmoke1MeasurementStatic);
+    _smoke2.onMeasurement(_handleSmoke2MeasurementStatic);
+    _smoke1.onCalibrated(_handleSmoke1CalibratedStatic);
+    _smoke2.onCalibrated(_handleSmoke2CalibratedStatic);
+    _smokeRelay.onStatusChange(_handleSmokeRelayStatic);
+    _heater.onWindowClosed(_handleSmokeWindowStatic, this);
+    _heater.begin();
     
     _doorInstance = this;
     _gateInstance = this;
@@ -75,48 +188,102 @@ void SystemManager::begin() {
 
     _motionInstance = this;
     _motion.setOnDetectCallback(_handleMotionStatic);
-    
-    _instanceForIButton = this;
-    _ibutton.setAccessGrantedCallback(_handleIButtonAccessStatic);
-    
+
+    // Detection runs whatever the health check says: a modem that is still
+    // registering or a missing sensor is a degraded start, logged with its
+    // failed mask, not a failed boot
+    _checkSystemHealth();
     _logEvent(MsgID::SYS_READY);
 }
 
 void SystemManager::update() {
-    if(!_checkSystemHealth()) {
-        _changeState(SystemState::FIRE_ALERT, MsgID::HEALTH_FAIL);
-        return;
-    }
+    _scheduler.runDue();
+}
 
-    _gsm.update();
-    _alarm.update();
-    _smoke1.update();
-    _smoke2.update();
+unsigned long SystemManager::getTimeToNextWakeup() const {
+    return _scheduler.getTimeToNextWakeup();
+}
+
+void SystemManager::_registerTasks() {
+    if(_scheduler.getTaskCount()) return;
+
+    // period, deadline (ms). GSM must drain the 64-byte UART buffer before
+    // it overflows (~67 ms at 9600 baud); the input sampler ticks every
+    // 13 ms (missed ticks are replayed from the edge ring) and the same task
+    // hands its results to door/gate/PIR/relay; MQ-7 heater phases and
+    // DS18B20 conversions are seconds long.
+    _scheduler.addTask(_taskGsm, TaskScheduler::updateTask<GSMController>, &_gsm, 20, 40);
+    _scheduler.addTask(_taskInputs, _updateInputsStatic, this, 13);
+    _scheduler.addTask(_taskIButton, TaskScheduler::updateTask<iButtonAccess>, &_ibutton, 100);
+    _scheduler.addTask(_taskHeater, TaskScheduler::updateTask<HeaterCycle>, &_heater, 250);
+    _scheduler.addTask(_taskTemps, TaskScheduler::updateTask<MultiDS18B20>, &_temps, 1000);
+    _scheduler.addTask(_taskHealth, _updateHealthStatic, this, 100);
+    _scheduler.addTask(_taskState, _updateStateStatic, this, 50);
+    _scheduler.addTask(_taskSms, TaskScheduler::updateTask<SmsQueue>, &_smsQueue, 100);
+    _scheduler.addTask(_taskLog, TaskScheduler::updateTask<EventLogger>, &_logger, 1000);
+}
+
+void SystemManager::_updateInputs() {
+    // Drivers only take what the sampler has debounced, so no task of
+    // their own: they run right after it in the same pass
+    _inputs.update();
     _smokeRelay.update();
     _door.update();
     _gate.update();
-    _ibutton.update();
     _motion.update();
-    _temps.update();
-    
-    // Handle ARMING state timeout
+}
+
+void SystemManager::_updateHealth() {
+    // Cached snapshot; drivers keep being sampled even when unhealthy. A
+    // fault (modem not registered, sensor missing) is logged with its mask
+    // and lit on the yellow LED, but never sounds the siren. Other states
+    // use the yellow LED themselves.
+    bool healthy = _checkSystemHealth();
+    if(_state == SystemState::DISARMED || _state == SystemState::ARMED) {
+        _yellowLed.set(!healthy);
+    }
+}
+
+void SystemManager::_updateState() {
+    _alarm.update();
+    _garageLight.update();
+
+    // Handle ARMING (exit delay) timeout
     if(_state == SystemState::ARMING) {
-        unsigned long remaining = (_armingDelay * 1000) - (millis() - _armingStartTime);
-        if(remaining <= 0) {
+        unsigned long remaining = getArmingRemaining();
+        if(remaining == 0) {
             _changeState(SystemState::ARMED, MsgID::SYS_ARMED);
         } else {
-            uint16_t blinkInterval = map(remaining, 0, _armingDelay * 1000, 200, 1000);
+            uint16_t blinkInterval = map(remaining, 0, _armingDelay * 1000UL, 200, 1000);
             _yellowLed.set(millis() % blinkInterval < blinkInterval / 2);
         }
     }
+
+    // Entry delay: no disarm in time is an intrusion through the entry zone
+    if(_state == SystemState::ENTRY_DELAY) {
+        unsigned long remaining = getEntryRemaining();
+        if(remaining == 0) {
+            char name[ZONE_NAME_SIZE];
+            _handleSecurityBreach(MsgID::ALRM_INTRUSION, _getZoneName(_entryZone, name));
+        } else {
+            uint16_t blinkInterval = map(remaining, 0, _entryDelay * 1000UL, 100, 500);
+            _redLed.set(millis() % blinkInterval < blinkInterval / 2);
+        }
+    }
     
     // Handle alert state timeouts
     if((_state == SystemState::FIRE_ALERT || _state == SystemState::INTRUSION_ALERT) &&
        (millis() - _stateChangeTime) >= ALARM_DURATION) {
-        _changeState(SystemState::DISARMED, MsgID::SYS_DISARMED, "AUTO");
+        char reason[sizeof(_disarmAuto)];
+        _changeState(SystemState::DISARMED, MsgID::SYS_DISARMED, strcpy_P(reason, _disarmAuto));
     }
     
     _handleSensorEvents();
+
+    // A lone PIR pulse is confirmed by the PIR staying active or dismissed
+    if(_isArmed()) {
+        _handleMotionVerdict(_motionAnalytics.evaluate(millis(), _motion.isActive()));
+    }
     
     // Pulsing effect for armed state
     if(_state == SystemState::ARMED) {
@@ -126,10 +293,10 @@ void SystemManager::update() {
 }
 
 const char* SystemManager::getStateString() const {
-    static const char* const states[] PROGMEM = {
-        "DISARMED", "ARMING", "ARMED", "FIRE", "INTRUSION", "MAINT"
+    static const char stateNames[][10] PROGMEM = {
+        "DISARMED", "ARMING", "ARMED", "FIRE", "INTRUSION", "MAINT", "ENTRY"
     };
-    return (const char*)pgm_read_ptr(&states[static_cast<int>(_state)]);
+    return stateNames[static_cast<int>(_state)];
 }
 
 void SystemManager::getTemperatureReadings(char* buffer) const {
@@ -139,6 +306,68 @@ void SystemManager::getTemperatureReadings(char* buffer) const {
     snprintf_P(buffer, 8, PSTR("T:%02d%02d"), gTemp, oTemp);
 }
 
+static int16_t _wholeDegrees(int16_t tenths) {
+    return (tenths + (tenths < 0 ? -5 : 5)) / 10;
+}
+
+static void _printTenths(Print& out, int16_t tenths) {
+    if(tenths == TempHistory::NO_DATA) {
+        out.print(F("--"));
+    } else {
+        out.print(tenths / 10.0f, 1);
+    }
+}
+
+static void _printRollup(Print& out, const TempHistory::Rollup& r) {
+    if(r.isEmpty()) {
+        out.print(F("--"));
+        return;
+    }
+    _printTenths(out, r.min);
+    out.print('/');
+    _printTenths(out, r.getAverage());
+    out.print('/');
+    _printTenths(out, r.max);
+}
+
+void SystemManager::getTemperatureHistory(char* buffer, size_t size) const {
+    // Running day per probe, as much as fits the SMS
+    snprintf_P(buffer, size, PSTR("HIST"));
+    for(uint8_t i = 0; i < TempHistory::PROBES; i++) {
+        const TempHistory::Rollup& day = _tempHistory.getRollup(i, TempHistory::Period::DAY);
+        if(!_temps.isAssigned(i) || day.isEmpty()) continue;
+        char name[4];
+        char item[24];
+        strcpy_P(name, MultiDS18B20::getLocationName(i));
+        snprintf_P(item, sizeof(item), PSTR(" %s%d/%d/%d"), name, _wholeDegrees(day.min),
+                   _wholeDegrees(day.getAverage()), _wholeDegrees(day.max));
+        size_t used = strlen(buffer);
+        if(used + strlen(item) + 1 > size) break;
+        strcpy(buffer + used, item);
+    }
+}
+
+void SystemManager::printTemperatureHistory(Print& out) const {
+    // "Gar h 14.2/14.3/14.6 d -2.1/8.3/15.0 y --" (min/avg/max), then the
+    // hourly averages, newest first
+    for(uint8_t i = 0; i < TempHistory::PROBES; i++) {
+        if(!_temps.isAssigned(i)) continue;
+        out.print((const __FlashStringHelper*)MultiDS18B20::getLocationName(i));
+        out.print(F(" h "));
+        _printRollup(out, _tempHistory.getRollup(i, TempHistory::Period::HOUR));
+        out.print(F(" d "));
+        _printRollup(out, _tempHistory.getRollup(i, TempHistory::Period::DAY));
+        out.print(F(" y "));
+        _printRollup(out, _tempHistory.getRollup(i, TempHistory::Period::LAST_DAY));
+        out.println();
+        for(uint8_t h = 1; h <= _tempHistory.getHourCount(); h++) {
+            out.print(' ');
+            _printTenths(out, _tempHistory.getHourly(i, h));
+        }
+        if(_tempHistory.getHourCount()) out.println();
+    }
+}
+
 bool SystemManager::armSystem(uint16_t delaySec) {
     if(_state == SystemState::ARMED || _state == SystemState::MAINTENANCE) {
         return false;
@@ -163,7 +392,7 @@ bool SystemManager::disarmSystem() {
     return true;
 }
 
-void SystemManager::_changeState(SystemState newState, MsgID msgId, const char* extra) {
+void SystemManager::_changeState(SystemState newState, MsgID msgId, const char* extra, int16_t data) {
     if(_state == newState) return;
     
     // Turn off previous state indicators
@@ -178,6 +407,12 @@ void SystemManager::_changeState(SystemState newState, MsgID msgId, const char*
     _previousState = _state;
     _state = newState;
     _stateChangeTime = millis();
+    // Pulses from before arming must not count towards an intrusion, and
+    // the owner walking in must not count once a follower PIR is ignored
+    if(newState == SystemState::ARMED ||
+       (newState == SystemState::ENTRY_DELAY && getZoneType(Zone::MOTION) == ZoneType::FOLLOWER)) {
+        _motionAnalytics.reset();
+    }
     
     // Handle new state indicators
     switch(_state) {
@@ -195,6 +430,12 @@ void SystemManager::_changeState(SystemState newState, MsgID msgId, const char*
             _greenLed.off();
             break;
             
+        case SystemState::ENTRY_DELAY:
+            _buzzer.shortBeep();
+            _yellowLed.off();
+            _greenLed.off();
+            break;
+
         case SystemState::ARMED:
             _buzzer.shortBeep(3);
             _redLed.off();
@@ -227,14 +468,10 @@ void SystemManager::_changeState(SystemState newState, MsgID msgId, const char*
     }
     
 	char logMsg[32];
-    if(extra) {
-        snprintf_P(logMsg, sizeof(logMsg), PSTR("%s:%s"), _getMessage(msgId), extra);
-    } else {
-        strncpy_P(logMsg, _getMessage(msgId), sizeof(logMsg));
-    }
+    _formatMessage(logMsg, sizeof(logMsg), msgId, extra);
 
-    EventLogger::EventType type = _determineEventType(msgId);
-    _logger.logEvent(type, logMsg); 
+    _record(msgId, data);
+    Serial.println(logMsg);
     
     if(_stateCallback) {
         _stateCallback(_state, logMsg);
@@ -245,14 +482,14 @@ void SystemManager::_changeState(SystemState newState, MsgID msgId, const char*
     }
 }
 
-void SystemManager::_handleSecurityBreach(MsgID msgId) {
-    if (_state != SystemState::ARMED) return;
-    _changeState(SystemState::INTRUSION_ALERT, msgId);
-    _sendAlertNotification(msgId);
+bool SystemManager::_isArmed() const {
+    return _state == SystemState::ARMED || _state == SystemState::ENTRY_DELAY;
 }
 
-bool SystemManager::_checkSmokeConsistency(float ppm1, float ppm2) const {
-    return fabs(ppm1 - ppm2) <= _smokeDifferential;
+void SystemManager::_handleSecurityBreach(MsgID msgId, const char* extra) {
+    if (!_isArmed()) return;
+    _changeState(SystemState::INTRUSION_ALERT, msgId, extra, _sensorMask());
+    _sendAlertNotification(msgId, extra);
 }
 
 SystemManager::SystemState SystemManager::getState() const {
@@ -266,11 +503,33 @@ unsigned long SystemManager::getStateDuration() const {
 unsigned long SystemManager::getArmingRemaining() const {
     if(_state != SystemState::ARMING) return 0;
     unsigned long elapsed = millis() - _armingStartTime;
-    return (_armingDelay * 1000) - min(elapsed, _armingDelay * 1000);
+    return (_armingDelay * 1000UL) - min(elapsed, _armingDelay * 1000UL);
+}
+
+unsigned long SystemManager::getEntryRemaining() const {
+    if(_state != SystemState::ENTRY_DELAY) return 0;
+    unsigned long elapsed = millis() - _entryStartTime;
+    return (_entryDelay * 1000UL) - min(elapsed, _entryDelay * 1000UL);
 }
 
 void SystemManager::setSmokeDifferential(float differential) {
-    _smokeDifferential = differential;
+    _fusion.setDifferential(differential * 10);
+}
+
+void SystemManager::setMotionRule(uint8_t pulses, uint16_t windowSec) {
+    _motionAnalytics.setRule(pulses, windowSec);
+}
+
+void SystemManager::setArmingDelay(uint16_t delay) {
+    _armingDelay = max(10, delay);
+}
+
+void SystemManager::setEntryDelay(uint16_t delay) {
+    _entryDelay = delay;
+}
+
+void SystemManager::setZoneType(Zone zone, ZoneType type) {
+    if(static_cast<uint8_t>(zone) < ZONES) _zoneTypes[static_cast<uint8_t>(zone)] = type;
 }
 
 void SystemManager::_handleSensorEvents() {
@@ -285,83 +544,70 @@ void SystemManager::_handleSensorEvents() {
             _gate.isOpen() ? 1 : 0,
             _motion.isActive() ? 1 : 0,
             tempBuf);
-        _logger.logEvent(status);
+        Serial.println(status);
+        _record(MsgID::SENSOR_STATUS, _sensorMask());
     }
 }
 
 void SystemManager::_sendAlertNotification(MsgID msgId, const char* extra) {
     char smsBuf[32];
-    if(extra) {
-        snprintf_P(smsBuf, sizeof(smsBuf), PSTR("%s:%s"), _getMessage(msgId), extra);
-    } else {
-        strncpy_P(smsBuf, _getMessage(msgId), sizeof(smsBuf));
-    }
+    _formatMessage(smsBuf, sizeof(smsBuf), msgId, extra);
     
-    if(_adminPhone1[0]) _gsm.sendSMS(_adminPhone1, smsBuf);
-    if(_adminPhone2[0]) _gsm.sendSMS(_adminPhone2, smsBuf);
-    
-    if(msgId == MsgID::ALRM_FIRE || msgId == MsgID::ALRM_INTRUSION) {
-        if(_userPhone1[0]) _gsm.sendSMS(_userPhone1, smsBuf);
-        if(_userPhone2[0]) _gsm.sendSMS(_userPhone2, smsBuf);
+    // Users only hear about alarms; state notifications supersede each other
+    switch(msgId) {
+        case MsgID::ALRM_FIRE:
+            _smsQueue.enqueue(SmsQueue::Priority::FIRE, SmsQueue::ALL, smsBuf);
+            break;
+        case MsgID::ALRM_INTRUSION:
+            _smsQueue.enqueue(SmsQueue::Priority::INTRUSION, SmsQueue::ALL, smsBuf);
+            break;
+        case MsgID::SMOKE_RISE:
+            _smsQueue.enqueue(SmsQueue::Priority::STATUS, SmsQueue::ADMINS, smsBuf,
+                              SmsQueue::Topic::SMOKE_RISE);
+            break;
+        default:
+            _smsQueue.enqueue(SmsQueue::Priority::STATUS, SmsQueue::ADMINS, smsBuf,
+                              SmsQueue::Topic::STATE);
     }
-    
-    _logger.logEvent(smsBuf);
 }
 
-void SystemManager::_logEvent(MsgID msgId, const char* extra) {
+void SystemManager::_logEvent(MsgID msgId, const char* extra, int16_t data) {
     char logBuf[32];
-    if(extra) {
-        snprintf_P(logBuf, sizeof(logBuf), PSTR("%s:%s"), _getMessage(msgId), extra);
-    } else {
-        strncpy_P(logBuf, _getMessage(msgId), sizeof(logBuf));
-    }
+    _formatMessage(logBuf, sizeof(logBuf), msgId, extra);
     
-    EventLogger::EventType type = _determineEventType(msgId);
-    _logger.logEvent(type, logBuf);
+    _record(msgId, data);
     Serial.println(logBuf);
 }
     
-EventLogger::EventType SystemManager::_determineEventType(MsgID msgId) const {
-    switch(msgId) {
-        case MsgID::ALRM_FIRE: return EventLogger::SMOKE_DETECTED;
-        case MsgID::ALRM_INTRUSION: return EventLogger::ALARM_TRIGGERED;
-        case MsgID::BAD_IBUTTON: return EventLogger::UNKNOWN_EVENT;
-        case MsgID::HEALTH_FAIL: return EventLogger::UNKNOWN_EVENT;
-        case MsgID::KEY_ADDED: return EventLogger::UNKNOWN_EVENT;
-        case MsgID::KEY_REMOVED: return EventLogger::UNKNOWN_EVENT;
-        case MsgID::SMOKE_MISMATCH: return EventLogger::SMOKE_DETECTED;
-        case MsgID::SYS_ARMED: return EventLogger::UNKNOWN_EVENT;
-        case MsgID::SYS_ARMING: return EventLogger::UNKNOWN_EVENT;
-        case MsgID::SYS_DISARMED: return EventLogger::UNKNOWN_EVENT;
-        case MsgID::SYS_READY: return EventLogger::UNKNOWN_EVENT;
-        case MsgID::TEMP_READINGS: return EventLogger::UNKNOWN_EVENT;
-        default: return EventLogger::UNKNOWN_EVENT;
-    }
+void SystemManager::_record(MsgID msgId, int16_t data) {
+    // Alarms go to EEPROM at once, everything else is batched
+    bool critical = msgId == MsgID::ALRM_FIRE || msgId == MsgID::ALRM_INTRUSION;
+    _logger.logEvent(static_cast<uint8_t>(msgId), data, critical);
+}
+
+uint8_t SystemManager::_sensorMask() const {
+    // Event log payload: bit 0 door, bit 1 gate, bit 2 motion
+    return (_door.isOpen() ? 1 : 0) | (_gate.isOpen() ? 2 : 0) | (_motion.isActive() ? 4 : 0);
+}
+
+int16_t SystemManager::_keyTag(const uint8_t* key) {
+    // Low serial bytes, enough to tell the keys apart in the log
+    return key[1] | (key[2] << 8);
 }
 
 bool SystemManager::_checkSystemHealth() {
-    static char lastHealthStatus[32] = "";
-    strcpy(_healthStatus, "H:");
-    bool healthy = true;
-    
-    if(!_smoke1.isOperational()) { strcat(_healthStatus, "S1,"); healthy = false; }
-    if(!_smoke2.isOperational()) { strcat(_healthStatus, "S2,"); healthy = false; }
-    if(_smokeRelay.isError())    { strcat(_healthStatus, "SR,"); healthy = false; }
-    if(!_door.isOperational())   { strcat(_healthStatus, "D1,"); healthy = false; }
-    if(!_gate.isOperational())   { strcat(_healthStatus, "D2,"); healthy = false; }
-    if(!_gsm.isOperational())    { strcat(_healthStatus, "GSM,"); healthy = false; }
-    if(!_temps.isOperational())  { strcat(_healthStatus, "TMP,"); healthy = false; }
-    
-    if(!healthy) {
-        _healthStatus[strlen(_healthStatus)-1] = '\0';
-        if(strcmp(lastHealthStatus, _healthStatus) != 0) {
-            _logEvent(MsgID::HEALTH_FAIL, _healthStatus);
-            strcpy(lastHealthStatus, _healthStatus);
+    _health.update();
+    uint8_t failed = _health.getFailedMask();
+
+    if(failed != _lastHealthMask) {
+        _lastHealthMask = failed;
+        if(failed) {
+            char status[32];
+            _health.formatStatus(status, sizeof(status));
+            _logEvent(MsgID::HEALTH_FAIL, status, failed);
         }
-    } else if(lastHealthStatus[0] != '\0') {
-        lastHealthStatus[0] = '\0';
     }
-    return healthy;
+    return failed == 0;
 }
 
 bool SystemManager::checkSystemHealth() {
@@ -370,12 +616,24 @@ bool SystemManager::checkSystemHealth() {
 
 
 // Static callback handlers
-void SystemManager::_handleSmoke1AlertStatic(float ppm, bool isCritical) {
-    if(_smoke1Instance) _smoke1Instance->_handleSmoke1Alert(ppm, isCritical);
+void SystemManager::_handleSmoke1MeasurementStatic(float) {
+    if(_smoke1Instance) _smoke1Instance->_handleSmokeMeasurement(0, _smoke1Instance->_smoke1);
+}
+
+void SystemManager::_handleSmoke2MeasurementStatic(float) {
+    if(_smoke2Instance) _smoke2Instance->_handleSmokeMeasurement(1, _smoke2Instance->_smoke2);
+}
+
+void SystemManager::_handleSmokeRelayStatic(SmokeRelay::SmokeStatus) {
+    if(_smokeRelayInstance) _smokeRelayInstance->_handleSmokeRelay();
+}
+
+void SystemManager::_handleSmoke1CalibratedStatic(float r0) {
+    if(_smoke1Instance) _smoke1Instance->_handleSmokeCalibrated(1, r0);
 }
 
-void SystemManager::_handleSmoke2AlertStatic(float ppm, bool isCritical) {
-    if(_smoke2Instance) _smoke2Instance->_handleSmoke2Alert(ppm, isCritical);
+void SystemManager::_handleSmoke2CalibratedStatic(float r0) {
+    if(_smoke2Instance) _smoke2Instance->_handleSmokeCalibrated(2, r0);
 }
 
 void SystemManager::_handleMotionStatic() {
@@ -394,119 +652,218 @@ void SystemManager::_handleGateEventStatic(DoorSensor::StateChange change) {
     if(_gateInstance) _gateInstance->_handleGateEvent(change);
 }
 
+void SystemManager::_updateInputsStatic(void* context) {
+    static_cast<SystemManager*>(context)->_updateInputs();
+}
+
+void SystemManager::_updateHealthStatic(void* context) {
+    static_cast<SystemManager*>(context)->_updateHealth();
+}
+
+void SystemManager::_updateStateStatic(void* context) {
+    static_cast<SystemManager*>(context)->_updateState();
+}
+
+void SystemManager::_handleTemperatureStatic(uint8_t location, float temp) {
+    if(!_tempsInstance || temp == DEVICE_DISCONNECTED_C) return;
+    int16_t tenths = temp * 10 + (temp < 0 ? -0.5f : 0.5f);
+    _tempsInstance->_tempHistory.addReading(location, tenths, millis());
+}
+
+void SystemManager::_handleSmokeWindowStatic(void* context) {
+    // Both sensors have read in the same heater phase, fuse them together
+    static_cast<SystemManager*>(context)->_handleFireAlert();
+}
+
 // Instance handlers
-void SystemManager::_handleSmoke1Alert(float ppm, bool isCritical) {
-    if(isCritical) _handleFireAlert(ppm, _smoke2.getPPM());
+void SystemManager::_handleSmokeMeasurement(uint8_t sensor, const SmokeSensor& smoke) {
+    _fusion.addReading(sensor, smoke.getPPMx10(), millis());
+}
+
+void SystemManager::_handleSmokeCalibrated(uint8_t sensor, float r0) {
+    // "SMK_CAL:1 24.4", R0 in kOhm; the log keeps R0 * 10
+    char r0Str[8];
+    char extra[12];
+    dtostrf(r0, 1, 1, r0Str);
+    snprintf_P(extra, sizeof(extra), PSTR("%u %s"), sensor, r0Str);
+    _logEvent(MsgID::SMOKE_CALIBRATED, extra, min(r0 * 10 + 0.5f, 32767.0f));
+}
+
+bool SystemManager::calibrateSmokeSensors() {
+    if(_smoke1.isCalibrating() || _smoke2.isCalibrating()) return false;
+    _smoke1.calibrateCleanAir();
+    _smoke2.calibrateCleanAir();
+    return true;
 }
 
-void SystemManager::_handleSmoke2Alert(float ppm, bool isCritical) {
-    if(isCritical) _handleFireAlert(_smoke1.getPPM(), ppm);
+void SystemManager::_handleSmokeRelay() {
+    // Detection raises the alarm at once, not at the next MQ-7 reading
+    _handleFireAlert();
+    if(_smokeRelay.isSmokeDetected() && getZoneType(Zone::SMOKE_RELAY) == ZoneType::FIRE_24H) {
+        _handleZone(Zone::SMOKE_RELAY);
+    }
 }
 
 void SystemManager::_handleMotion() {
-    if(_state == SystemState::ARMED) {
-        _handleSecurityBreach(MsgID::ALRM_INTRUSION);
+    if(!_isArmed()) return;
+    if(_state == SystemState::ENTRY_DELAY && getZoneType(Zone::MOTION) == ZoneType::FOLLOWER) return;
+    _handleMotionVerdict(_motionAnalytics.addPulse(_motion.getLastDetectionMillis()));
+}
+
+const char* SystemManager::_getZoneName(Zone zone, char* buffer) {
+    strcpy_P(buffer, (const char*)pgm_read_ptr(&_zoneNames[static_cast<uint8_t>(zone)]));
+    return buffer;
+}
+
+void SystemManager::_handleZone(Zone zone, const char* extra) {
+    char name[ZONE_NAME_SIZE];
+    if(!extra) extra = _getZoneName(zone, name);
+    switch(getZoneType(zone)) {
+        case ZoneType::FIRE_24H:
+            if(_state == SystemState::MAINTENANCE) return;
+            _changeState(SystemState::FIRE_ALERT, MsgID::ALRM_FIRE, extra, _sensorMask());
+            return;
+
+        case ZoneType::ENTRY:
+            // Only the first entry zone starts the timer; it is not restarted
+            if(_state != SystemState::ARMED) return;
+            _entryStartTime = millis();
+            _entryZone = zone;
+            _changeState(SystemState::ENTRY_DELAY, MsgID::ENTRY_DELAY, extra);
+            if(_entryDelay == 0) _handleSecurityBreach(MsgID::ALRM_INTRUSION, extra);
+            return;
+
+        case ZoneType::FOLLOWER:
+            if(_state == SystemState::ENTRY_DELAY) return;
+            _handleSecurityBreach(MsgID::ALRM_INTRUSION, extra);
+            return;
+
+        default:
+            _handleSecurityBreach(MsgID::ALRM_INTRUSION, extra);
+            return;
     }
 }
 
+void SystemManager::_handleMotionVerdict(MotionAnalytics::Verdict verdict) {
+    if(verdict == MotionAnalytics::Verdict::DISMISSED) {
+        _logEvent(MsgID::MOTION_DISMISSED);
+        return;
+    }
+    if(verdict != MotionAnalytics::Verdict::CONFIRMED) return;
+
+    char reason[9];
+    uint8_t index = static_cast<uint8_t>(_motionAnalytics.getReason());
+    strcpy_P(reason, (const char*)pgm_read_ptr(&_motionReasons[index]));
+    _handleZone(Zone::MOTION, reason);
+}
+
 void SystemManager::_handleIButtonAccess(const uint8_t* keyId) {
+    bool learning = _learnTimeout && millis() - _learnStartTime < _learnTimeout * 1000UL;
+    if(learning && !verifyIButtonKey(keyId)) {
+        _learnTimeout = 0;
+        if(addAuthorizedKey(keyId) == KeyStore::Result::OK) {
+            _buzzer.shortBeep(2);
+            return;
+        }
+    }
     if(verifyIButtonKey(keyId)) {
-        if(_state == SystemState::ARMED || _state == SystemState::FIRE_ALERT || 
+        if(_isArmed() || _state == SystemState::FIRE_ALERT || 
            _state == SystemState::INTRUSION_ALERT) {
             disarmSystem();
         } else {
             armSystem();
         }
     } else {
-        _logEvent(MsgID::BAD_IBUTTON);
+        _logEvent(MsgID::BAD_IBUTTON, nullptr, _keyTag(keyId));
     }
 }
 
 void SystemManager::_handleDoorEvent(DoorSensor::StateChange change) {
-    if(change == DoorSensor::StateChange::OPENED && _state == SystemState::ARMED) {
-        _handleSecurityBreach(MsgID::ALRM_INTRUSION);
-    }
+    if(change != DoorSensor::StateChange::OPENED) return;
+    // Motion just before the door opens is someone inside on the way out
+    MotionAnalytics::Verdict verdict = _motionAnalytics.addPerimeter(millis());
+    if(_state == SystemState::ARMED) _handleMotionVerdict(verdict);
+    _handleZone(Zone::DOOR);
 }
 
 void SystemManager::_handleGateEvent(DoorSensor::StateChange change) {
-    if(change == DoorSensor::StateChange::OPENED && _state == SystemState::ARMED) {
-        _handleSecurityBreach(MsgID::ALRM_INTRUSION);
-    }
+    if(change != DoorSensor::StateChange::OPENED) return;
+    MotionAnalytics::Verdict verdict = _motionAnalytics.addPerimeter(millis());
+    if(_state == SystemState::ARMED) _handleMotionVerdict(verdict);
+    _handleZone(Zone::GATE);
 }
 
-void SystemManager::_handleFireAlert(float ppm1, float ppm2) {
+void SystemManager::_handleFireAlert() {
+    // Evaluated on every reading so the history stays current while disarmed
+    _fusion.setRelay(_smokeRelay.isSmokeDetected());
+    SmokeFusion::Level level = _fusion.evaluate(millis());
     if(_state == SystemState::DISARMED || _state == SystemState::ARMING) return;
+    if(level == SmokeFusion::Level::CLEAR) return;
     
-    bool smokeDetected = _smoke1.isSmokeDetected() || _smoke2.isSmokeDetected() || 
-                        _smokeRelay.isSmokeDetected();
-    if(!smokeDetected) return;
-    
-    if(!_checkSmokeConsistency(ppm1, ppm2)) {
-        _logEvent(MsgID::SMOKE_MISMATCH);
+    if(level == SmokeFusion::Level::MISMATCH) {
+        _logEvent(MsgID::SMOKE_MISMATCH, nullptr, _fusion.getDifference() / 10);
         _buzzer.shortBeep(3);
         return;
     }
     
-    float maxPPM = max(ppm1, ppm2);
-    char ppmStr[8];
-    dtostrf(maxPPM, 4, 1, ppmStr);
+    // "45.2", "12.5 RISE" (fire on the rate of rise), "3.1 RELAY"
+    bool rise = _fusion.getReason() == SmokeFusion::Reason::RISE;
+    char ppmStr[16];
+    dtostrf(_fusion.getPeak() * 0.1f, 4, 1, ppmStr);
+    if(rise && level == SmokeFusion::Level::FIRE) strcat_P(ppmStr, PSTR(" RISE"));
+    if(_fusion.getReason() == SmokeFusion::Reason::RELAY) strcat_P(ppmStr, PSTR(" RELAY"));
+    int16_t ppm = (_fusion.getPeak() + 5) / 10;
     
-    if(_smokeRelay.isSmokeDetected() || maxPPM >= _smokeCriticalThreshold) {
-        _changeState(SystemState::FIRE_ALERT, MsgID::ALRM_FIRE, ppmStr);
-    } else if(maxPPM >= _smokeWarningThreshold) {
+    if(level == SmokeFusion::Level::FIRE) {
+        _changeState(SystemState::FIRE_ALERT, MsgID::ALRM_FIRE, ppmStr, ppm);
+    } else {
+        // A rise below the warning level is often a car idling: the admins
+        // get it as a status report that each heater window replaces
+        MsgID msgId = rise ? MsgID::SMOKE_RISE : MsgID::ALRM_FIRE;
         _buzzer.longBeep(2);
         _redLed.longBlink();
-        _sendAlertNotification(MsgID::ALRM_FIRE, ppmStr);
+        _logEvent(msgId, ppmStr, ppm);
+        _sendAlertNotification(msgId, ppmStr);
     }
 }
 
 bool SystemManager::verifyIButtonKey(const uint8_t* key) {
-    for(uint8_t i = 0; i < _numKeys; i++) {
-        if(memcmp(_authorizedKeys[i], key, 8) == 0) {
-            return true;
-        }
-    }
-    return false;
+    return _keys.contains(key);
 }
 
-bool SystemManager::addAuthorizedKey(const uint8_t* key) {
-    if(_numKeys >= 3 || verifyIButtonKey(key)) return false;
-    memcpy(_authorizedKeys[_numKeys++], key, 8);
-    _logEvent(MsgID::KEY_ADDED);
-    return true;
+KeyStore::Result SystemManager::addAuthorizedKey(const uint8_t* key) {
+    KeyStore::Result result = _keys.add(key);
+    if(result == KeyStore::Result::OK) _logEvent(MsgID::KEY_ADDED, nullptr, _keyTag(key));
+    return result;
 }
 
-bool SystemManager::removeAuthorizedKey(const uint8_t* key) {
-    for(uint8_t i = 0; i < _numKeys; i++) {
-        if(memcmp(_authorizedKeys[i], key, 8) == 0) {
-            for(uint8_t j = i; j < _numKeys - 1; j++) {
-                memcpy(_authorizedKeys[j], _authorizedKeys[j+1], 8);
-            }
-            _numKeys--;
-            _logEvent(MsgID::KEY_REMOVED);
-            return true;
-        }
-    }
-    return false;
+KeyStore::Result SystemManager::removeAuthorizedKey(const uint8_t* key) {
+    KeyStore::Result result = _keys.remove(key);
+    if(result == KeyStore::Result::OK) _logEvent(MsgID::KEY_REMOVED, nullptr, _keyTag(key));
+    return result;
+}
+
+void SystemManager::learnKey(uint16_t timeoutSec) {
+    _learnStartTime = millis();
+    _learnTimeout = timeoutSec;
+}
+
+bool SystemManager::isAdminNumber(const char* number) const {
+    return _smsQueue.findRecipient(number) & SmsQueue::ADMINS;
 }
 
 bool SystemManager::verifyPhoneNumber(const char* number) const {
-    return (number && strcmp(number, _adminPhone1) == 0) || 
-           (number && _adminPhone2[0] && strcmp(number, _adminPhone2) == 0) ||
-           (number && _userPhone1[0] && strcmp(number, _userPhone1) == 0) ||
-           (number && _userPhone2[0] && strcmp(number, _userPhone2) == 0);
+    return _smsQueue.findRecipient(number) != 0;
 }
 
-void SystemManager::handleIncomingCall(const String& number) {
-    char buffer[12];
-    number.toCharArray(buffer, sizeof(buffer));
-    
-    if (!verifyPhoneNumber(buffer)) return;
+void SystemManager::handleIncomingCall(const char* number) {
+    if (!verifyPhoneNumber(number)) return;
 
-    if (_state == SystemState::ARMED) {
+    if (_isArmed()) {
         disarmSystem();
         _garageLight.toggleLight();  // Используем GarageLight!
-        _logEvent(MsgID::SYS_DISARMED, "BY_CALL");
+        char reason[sizeof(_disarmByCall)];
+        _logEvent(MsgID::SYS_DISARMED, strcpy_P(reason, _disarmByCall));
     } 
     else {
         _garageLight.toggleLight();  // Используем GarageLight!
@@ -6,15 +6,25 @@
 #include <Arduino.h>
 #include <Buzzer.h>
 #include <DoorSensor.h>
+#include <EdgeCapture.h>
+#include <InputSampler.h>
+#include <KeyStore.h>
 #include <EventLogger.h>
 #include "GarageLight.h"
 #include <GSMController.h>
 #include <iButtonAccess.h>
 #include <Led.h>
+#include <MotionAnalytics.h>
 #include <MovingSensor.h>
 #include <MultiDS18B20.h>
 #include <SmokeRelay.h>
 #include <SmokeSensor.h>
+#include <SmokeFusion.h>
+#include <HeaterCycle.h>
+#include <TempHistory.h>
+#include <SmsQueue.h>
+#include <SystemHealth.h>
+#include <TaskScheduler.h>
 #include <avr/pgmspace.h>
 
 class SystemManager {
@@ -25,9 +35,27 @@ public:
         ARMED,          // 2
         FIRE_ALERT,     // 3
         INTRUSION_ALERT,// 4
-        MAINTENANCE     // 5
+        MAINTENANCE,    // 5
+        ENTRY_DELAY     // 6: entry zone opened, waiting for a disarm
+    };
+
+    // Inputs that can raise an alarm, each with its own ZoneType
+    enum class Zone : uint8_t {
+        DOOR,
+        GATE,
+        MOTION,
+        SMOKE_RELAY
+    };
+    static constexpr uint8_t ZONES = 4;
+
+    enum class ZoneType : uint8_t {
+        INSTANT,    // alarm at once while armed
+        ENTRY,      // starts the entry delay while armed
+        FOLLOWER,   // ignored during the entry delay, instant otherwise
+        FIRE_24H    // fire alarm in every state but maintenance
     };
     
+    // Also the event log codes: new IDs go at the end
     enum class MsgID : uint8_t {
 	ALRM_FIRE,
 	ALRM_INTRUSION,
@@ -40,7 +68,13 @@ public:
 	SYS_ARMING,
 	SYS_DISARMED,
 	SYS_READY,
-	TEMP_READINGS
+	TEMP_READINGS,
+	SENSOR_STATUS,
+	SMOKE_CALIBRATED,
+	MOTION_DISMISSED,
+	ENTRY_DELAY,
+	KEYS_RECOVERED,
+	SMOKE_RISE
 	};
     
     typedef void (*SystemCallback)(SystemState state, const char* message);
@@ -53,7 +87,8 @@ public:
                 Led& yellowLed, Led& greenLed, MovingSensor& motion, GarageLight& garageLight);
     
     void begin();
-    void update();
+    void update();  // Run the driver tasks that are due
+    unsigned long getTimeToNextWakeup() const; // ms until the next task is due
 	
     // System control
     bool armSystem(uint16_t delaySec = 30);
@@ -64,43 +99,64 @@ public:
     
     // System state
     SystemState getState() const;
-    const char* getStateString() const;
+    const char* getStateString() const;     // PROGMEM string
     unsigned long getStateDuration() const;
     unsigned long getArmingRemaining() const;
+    unsigned long getEntryRemaining() const;
     
     // Callbacks
     void onStateChange(SystemCallback callback);
     void onAlert(AlertCallback callback);
     
     // Configuration
-    void setArmingDelay(uint16_t delay);
+    void setArmingDelay(uint16_t delay);    // exit delay, seconds
+    void setEntryDelay(uint16_t delay);     // seconds
+    void setZoneType(Zone zone, ZoneType type);
+    ZoneType getZoneType(Zone zone) const { return _zoneTypes[static_cast<uint8_t>(zone)]; }
     void setAlertThresholds(float smokeWarning, float smokeCritical);
     void setSmokeDifferential(float differential);
+    void setMotionRule(uint8_t pulses, uint16_t windowSec);
+    // Numbers are kept by the SMS queue by pointer, not copied; "" leaves
+    // a slot unused
     void setAdminPhoneNumbers(const char* primary, const char* secondary = "");
     void setUserPhoneNumbers(const char* primary, const char* secondary = "");
 
     // Security
     bool verifyIButtonKey(const uint8_t* key);
-    bool addAuthorizedKey(const uint8_t* key);
-    bool removeAuthorizedKey(const uint8_t* key);
+    KeyStore::Result addAuthorizedKey(const uint8_t* key);
+    KeyStore::Result removeAuthorizedKey(const uint8_t* key);
+    void learnKey(uint16_t timeoutSec = 60);    // next unknown key touched is added
+    const KeyStore& getKeyStore() const { return _keys; }
+
+    // Clean air calibration of both MQ-7s; false if one is still running
+    bool calibrateSmokeSensors();
     
-    const char* getAdminPhone1() const { return _adminPhone1; }
-    const char* getAdminPhone2() const { return _adminPhone2; }
-    const char* getUserPhone1() const { return _userPhone1; }
-    const char* getUserPhone2() const { return _userPhone2; }
+    const char* getAdminPhone1() const { return _smsQueue.getRecipient(0); }
+    const char* getAdminPhone2() const { return _smsQueue.getRecipient(1); }
+    const char* getUserPhone1() const { return _smsQueue.getRecipient(2); }
+    const char* getUserPhone2() const { return _smsQueue.getRecipient(3); }
     
-    bool hasAdminPhone2() const { return _adminPhone2[0] != '\0'; }
-    bool hasUserPhone1() const { return _userPhone1[0] != '\0'; }
-    bool hasUserPhone2() const { return _userPhone2[0] != '\0'; }
+    bool hasAdminPhone2() const { return getAdminPhone2()[0] != '\0'; }
+    bool hasUserPhone1() const { return getUserPhone1()[0] != '\0'; }
+    bool hasUserPhone2() const { return getUserPhone2()[0] != '\0'; }
 
-    bool verifyPhoneNumber(const String& number) const; 
     bool verifyPhoneNumber(const char* number) const;
+    bool isAdminNumber(const char* number) const;     // key management is admin only
     void getTemperatureReadings(char* buffer) const;
-	void handleIncomingCall(const String& number);
+    // "HIST Gar-2/8/15 ..." today's min/avg/max per probe, whole degrees
+    void getTemperatureHistory(char* buffer, size_t size) const;
+    void printTemperatureHistory(Print& out) const;
+    const TempHistory& getTempHistory() const { return _tempHistory; }
+	void handleIncomingCall(const char* number);
 	bool checkSystemHealth();
+	const SystemHealth& getHealth() const { return _health; }
+	const TaskScheduler& getScheduler() const { return _scheduler; }
+	SmsQueue& getSmsQueue() { return _smsQueue; }
 	
 private:
-	EventLogger::EventType _determineEventType(MsgID msgId) const;
+	void _record(MsgID msgId, int16_t data);
+	uint8_t _sensorMask() const;
+	static int16_t _keyTag(const uint8_t* key);
     // External dependencies
     GSMController& _gsm;
     Alarm& _alarm;
@@ -118,67 +174,101 @@ private:
     Led& _greenLed;
     MovingSensor& _motion;
 	GarageLight& _garageLight;
+    SystemHealth _health;
+    SmokeFusion _fusion;
+    MotionAnalytics _motionAnalytics;
+    HeaterCycle _heater;            // shared MQ-7 heater pin
+    TempHistory _tempHistory;
+    EdgeCapture _edgeCapture;       // PCINT edges of door, gate, PIR, relay
+    InputSampler _inputs;           // their debounced levels, one port sample
+    TaskScheduler _scheduler;
+    SmsQueue _smsQueue;
     // System state
     SystemState _state = SystemState::DISARMED;
     SystemState _previousState = SystemState::DISARMED;
     unsigned long _stateChangeTime = 0;
     unsigned long _armingStartTime = 0;
-    char _healthStatus[32];
+    unsigned long _entryStartTime = 0;
+    Zone _entryZone = Zone::DOOR;
+    uint8_t _lastHealthMask = 0;
 	
     // Configuration
-    float _smokeWarningThreshold = 30.0;
-    float _smokeCriticalThreshold = 50.0;
-    float _smokeDifferential = 15.0;
     uint16_t _armingDelay = 30;
+    uint16_t _entryDelay = 30;
+    // The owner comes in through the door or the gate to reach the reader
+    ZoneType _zoneTypes[ZONES] = {
+        ZoneType::ENTRY,        // DOOR
+        ZoneType::ENTRY,        // GATE
+        ZoneType::FOLLOWER,     // MOTION
+        ZoneType::FIRE_24H      // SMOKE_RELAY
+    };
     
     // Security
-    char _adminPhone1[12] = "+79210308335"; // +1234567890\0
-    char _adminPhone2[12] = "";
-    char _userPhone1[12] = "";
-    char _userPhone2[12] = "";
-    uint8_t _authorizedKeys[3][8]; // Store keys directly
-    uint8_t _numKeys = 0;
+    KeyStore _keys;
+    unsigned long _learnStartTime = 0;
+    uint16_t _learnTimeout = 0;     // seconds, 0 when not learning
     
     // Callbacks
     SystemCallback _stateCallback = nullptr;
     AlertCallback _alertCallback = nullptr;
 
     // Constants
-    static constexpr uint16_t ALARM_DURATION = 300000;
+    static constexpr unsigned long ALARM_DURATION = 300000;
     static constexpr uint16_t ALARM_BLINK_INTERVAL = 500;
 
     // Static instances for callbacks
     static SystemManager* _smoke1Instance;
     static SystemManager* _smoke2Instance;
+    static SystemManager* _smokeRelayInstance;
     static SystemManager* _motionInstance;
     static SystemManager* _instanceForIButton;
     static SystemManager* _doorInstance;
     static SystemManager* _gateInstance;
+    static SystemManager* _tempsInstance;
 
     // Private methods
-    void _changeState(SystemState newState, MsgID msgId, const char* extra = nullptr);
+    void _changeState(SystemState newState, MsgID msgId, const char* extra = nullptr,
+                      int16_t data = 0);
     void _handleSensorEvents();
-    void _handleSecurityBreach(MsgID msgId);
-    void _handleFireAlert(float ppm1, float ppm2);
+    void _handleSecurityBreach(MsgID msgId, const char* extra = nullptr);
+    void _handleMotionVerdict(MotionAnalytics::Verdict verdict);
+    void _handleZone(Zone zone, const char* extra = nullptr);
+    bool _isArmed() const;
+    void _handleFireAlert();
     void _sendAlertNotification(MsgID msgId, const char* extra = nullptr);
-    void _logEvent(MsgID msgId, const char* extra = nullptr);
-    bool _checkSmokeConsistency(float ppm1, float ppm2) const;
+    void _logEvent(MsgID msgId, const char* extra = nullptr, int16_t data = 0);
     bool _checkSystemHealth();
+    void _registerTasks();
+    void _updateInputs();
+    void _updateHealth();
+    void _updateState();
 
     // Message handling
-    const char* _getMessage(MsgID id) const;
+    static constexpr uint8_t ZONE_NAME_SIZE = 5;
+    static const char* _getZoneName(Zone zone, char* buffer);  // copied out of flash
+    const char* _getMessage(MsgID id) const;    // PROGMEM
+    void _formatMessage(char* buffer, size_t size, MsgID id, const char* extra) const;
     
     // Static callback wrappers
-    static void _handleSmoke1AlertStatic(float ppm, bool isCritical);
-    static void _handleSmoke2AlertStatic(float ppm, bool isCritical);
+    static void _handleSmoke1MeasurementStatic(float ppm);
+    static void _handleSmoke2MeasurementStatic(float ppm);
+    static void _handleSmokeRelayStatic(SmokeRelay::SmokeStatus status);
+    static void _handleSmoke1CalibratedStatic(float r0);
+    static void _handleSmoke2CalibratedStatic(float r0);
     static void _handleMotionStatic();
     static void _handleIButtonAccessStatic(const uint8_t* keyId);
     static void _handleDoorEventStatic(DoorSensor::StateChange change);
     static void _handleGateEventStatic(DoorSensor::StateChange change);
+    static void _updateInputsStatic(void* context);
+    static void _updateHealthStatic(void* context);
+    static void _updateStateStatic(void* context);
+    static void _handleSmokeWindowStatic(void* context);
+    static void _handleTemperatureStatic(uint8_t location, float temp);
 
     // Instance handlers
-    void _handleSmoke1Alert(float ppm, bool isCritical);
-    void _handleSmoke2Alert(float ppm, bool isCritical);
+    void _handleSmokeMeasurement(uint8_t sensor, const SmokeSensor& smoke);
+    void _handleSmokeRelay();
+    void _handleSmokeCalibrated(uint8_t sensor, float r0);
     void _handleMotion();
     void _handleIButtonAccess(const uint8_t* keyId);
     void _handleDoorEvent(DoorSensor::StateChange change);
@@ -0,0 +1,111 @@
+#include "TaskScheduler.h"
+
+uint8_t TaskScheduler::addTask(const char* name, TaskFunc func, void* context,
+                               uint16_t periodMs, uint16_t deadlineMs) {
+    if(_count >= MAX_TASKS || !func) return INVALID_TASK;
+
+    Task& task = _tasks[_count];
+    task.func = func;
+    task.context = context;
+    task.periodMs = max(1, periodMs);
+    task.deadlineMs = deadlineMs ? deadlineMs : task.periodMs;
+    task.release = _now();  // first run on the next pass
+#if PERF_MONITOR
+    task.name = name;
+    memset(&task.stats, 0, sizeof(task.stats));
+    task.perfSlot = PERF_ADD_SLOT(name);
+#else
+    (void)name;
+#endif
+    return _count++;
+}
+
+void TaskScheduler::setPeriod(uint8_t id, uint16_t periodMs) {
+    if(id >= _count) return;
+    bool deadlineFollowsPeriod = _tasks[id].deadlineMs == _tasks[id].periodMs;
+    _tasks[id].periodMs = max(1, periodMs);
+    if(deadlineFollowsPeriod) _tasks[id].deadlineMs = _tasks[id].periodMs;
+}
+
+void TaskScheduler::runDue() {
+    // Each task runs at most once per pass, so a task that overruns its
+    // period cannot starve the others.
+    uint16_t ranMask = 0;
+    uint16_t now = _now();
+
+    for(uint8_t guard = 0; guard < _count; guard++) {
+        uint8_t id = INVALID_TASK;
+        int16_t earliest = 0;
+
+        for(uint8_t i = 0; i < _count; i++) {
+            if(ranMask & (1 << i)) continue;
+            const Task& task = _tasks[i];
+            if(!_isDue(task, now)) continue;
+            int16_t slack = (int16_t)(task.release + task.deadlineMs - now);
+            if(id == INVALID_TASK || slack < earliest) {
+                id = i;
+                earliest = slack;
+            }
+        }
+        if(id == INVALID_TASK) break;
+
+        ranMask |= 1 << id;
+        _run(_tasks[id], now);
+        now = _now();
+    }
+}
+
+unsigned long TaskScheduler::getTimeToNextWakeup() const {
+    uint16_t now = _now();
+    uint16_t wait = 0xFFFF;
+
+    for(uint8_t i = 0; i < _count; i++) {
+        if(_isDue(_tasks[i], now)) return 0;
+        uint16_t until = _tasks[i].release - now;
+        if(until < wait) wait = until;
+    }
+    return wait;
+}
+
+#if PERF_MONITOR
+const char* TaskScheduler::getTaskName(uint8_t id) const {
+    return id < _count ? _tasks[id].name : nullptr;
+}
+
+void TaskScheduler::resetStats() {
+    for(uint8_t i = 0; i < _count; i++) {
+        memset(&_tasks[i].stats, 0, sizeof(TaskStats));
+    }
+}
+#endif
+
+void TaskScheduler::_run(Task& task, uint16_t now) {
+#if PERF_MONITOR
+    uint16_t latency = now - task.release;
+    if(latency > task.stats.maxLatencyMs) {
+        task.stats.maxLatencyMs = latency;
+    }
+
+    unsigned long start = micros();
+    task.func(task.context);
+    unsigned long runUs = micros() - start;
+    perfMonitor.record(task.perfSlot, runUs);
+
+    if(runUs > task.stats.maxRunUs) {
+        task.stats.maxRunUs = min(runUs, 0xFFFFUL);
+    }
+    if(latency + runUs / 1000 > task.deadlineMs && task.stats.deadlineMisses < 0xFFFF) {
+        task.stats.deadlineMisses++;
+    }
+#else
+    (void)now;
+    task.func(task.context);
+#endif
+
+    // Next release keeps the period grid; after an overrun skip the missed
+    // releases instead of running the task back to back to catch up.
+    task.release += task.periodMs;
+    if(_isDue(task, _now())) {
+        task.release = _now() + task.periodMs;
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <Arduino.h>
+#include <PerfMonitor.h>
+
+// Cooperative tick scheduler. Each task has a period and a relative
+// deadline; runDue() runs every released task, earliest deadline first.
+// PERF_MONITOR builds also record per-task release latency, run time and
+// deadline misses; the plain build keeps 10 bytes per task. Release times
+// are the low 16 bits of millis(): a release is at most one period ahead,
+// so anything else is already due, however long loop() was blocked.
+class TaskScheduler {
+public:
+    typedef void (*TaskFunc)(void* context);
+
+    static constexpr uint8_t MAX_TASKS = 9;      // SystemManager registers 9
+    static constexpr uint8_t INVALID_TASK = 0xFF;
+
+    struct TaskStats {
+        uint16_t maxLatencyMs;  // release -> start
+        uint16_t maxRunUs;      // longest single run
+        uint16_t deadlineMisses;
+    };
+
+    // Adapter for drivers with a plain update() method
+    template <class T>
+    static void updateTask(void* context) { static_cast<T*>(context)->update(); }
+
+    // Returns the task id, or INVALID_TASK when the table is full.
+    // deadlineMs = 0 means the deadline equals the period.
+    uint8_t addTask(const char* name, TaskFunc func, void* context,
+                    uint16_t periodMs, uint16_t deadlineMs = 0);
+    void setPeriod(uint8_t id, uint16_t periodMs);
+    void runDue();
+    unsigned long getTimeToNextWakeup() const;  // ms until the next release
+
+    uint8_t getTaskCount() const { return _count; }
+#if PERF_MONITOR
+    const char* getTaskName(uint8_t id) const;  // PROGMEM string
+    const TaskStats& getStats(uint8_t id) const { return _tasks[id].stats; }
+    void resetStats();
+#endif
+
+private:
+    struct Task {
+        TaskFunc func;
+        void* context;
+        uint16_t periodMs;
+        uint16_t deadlineMs;
+        uint16_t release;       // ms, low 16 bits
+#if PERF_MONITOR
+        const char* name;
+        TaskStats stats;
+        uint8_t perfSlot;
+#endif
+    };
+
+    Task _tasks[MAX_TASKS];
+    uint8_t _count = 0;
+
+    void _run(Task& task, uint16_t now);
+    static uint16_t _now() { return (uint16_t)millis(); }
+    static bool _isDue(const Task& task, uint16_t now) {
+        uint16_t ahead = task.release - now;
+        return ahead == 0 || ahead > task.periodMs;
+    }
+};
+
+#endif
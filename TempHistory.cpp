@@ -0,0 +1,99 @@
+#include "TempHistory.h"
+#include <EEPROM.h>
+
+int16_t TempHistory::Rollup::getAverage() const {
+    if(!count) return NO_DATA;
+    // Rounded half away from zero
+    int32_t half = sum >= 0 ? count / 2 : -(int32_t)(count / 2);
+    return (sum + half) / count;
+}
+
+TempHistory::TempHistory() {
+    for(uint8_t p = 0; p < PROBES; p++) {
+        _clear(_probes[p].hour);
+        _clear(_probes[p].day);
+        _clear(_probes[p].lastDay);
+    }
+}
+
+void TempHistory::begin(uint16_t address) {
+    // Whatever the ring holds from before the boot is never read back,
+    // getHourly() stops at the hours closed since
+    _address = address;
+}
+
+void TempHistory::addReading(uint8_t probe, int16_t value, unsigned long now) {
+    _advance(now);
+    if(probe >= PROBES || value == NO_DATA) return;
+    _add(_probes[probe].hour, value);
+    _add(_probes[probe].day, value);
+}
+
+const TempHistory::Rollup& TempHistory::getRollup(uint8_t probe, Period period) const {
+    const Probe& p = _probes[probe < PROBES ? probe : 0];
+    switch(period) {
+        case Period::HOUR: return p.hour;
+        case Period::DAY: return p.day;
+        default: return p.lastDay;
+    }
+}
+
+int16_t TempHistory::getHourly(uint8_t probe, uint8_t hoursAgo) const {
+    if(probe >= PROBES || hoursAgo == 0 || hoursAgo > _hourCount) return NO_DATA;
+    int8_t value = (int8_t)EEPROM.read(_address + probe * HOURS + (_head + HOURS - hoursAgo) % HOURS);
+    return value == HOURLY_NO_DATA ? NO_DATA : value * 5;
+}
+
+void TempHistory::_advance(unsigned long now) {
+    // Hours without readings still close, as gaps in the ring. After a long
+    // gap only the last day of them matters.
+    unsigned long elapsed = (now - _hourStart) / HOUR_MS;
+    if(!elapsed) return;
+    if(elapsed > HOURS + 1) {
+        _hours += elapsed - (HOURS + 1);
+        elapsed = HOURS + 1;
+    }
+    while(elapsed--) {
+        _closeHour();
+    }
+    _hourStart += ((now - _hourStart) / HOUR_MS) * HOUR_MS;
+}
+
+void TempHistory::_closeHour() {
+    bool dayClosed = (_hours + 1) % HOURS == 0;
+    for(uint8_t p = 0; p < PROBES; p++) {
+        Probe& probe = _probes[p];
+        if(_address != NO_STORE) {
+            EEPROM.update(_address + p * HOURS + _head, _toHalfDegrees(probe.hour.getAverage()));
+        }
+        _clear(probe.hour);
+        if(dayClosed) {
+            probe.lastDay = probe.day;
+            _clear(probe.day);
+        }
+    }
+    _head = (_head + 1) % HOURS;
+    if(_hourCount < HOURS && _address != NO_STORE) _hourCount++;
+    _hours++;
+}
+
+int8_t TempHistory::_toHalfDegrees(int16_t tenths) {
+    if(tenths == NO_DATA) return HOURLY_NO_DATA;
+    // Rounded half away from zero, clamped short of the no-data marker
+    int16_t half = (tenths + (tenths < 0 ? -2 : 2)) / 5;
+    return constrain(half, -127, 127);
+}
+
+void TempHistory::_clear(Rollup& r) {
+    r.min = 32767;
+    r.max = -32767;
+    r.sum = 0;
+    r.count = 0;
+}
+
+void TempHistory::_add(Rollup& r, int16_t value) {
+    if(value < r.min) r.min = value;
+    if(value > r.max) r.max = value;
+    r.sum += value;
+    if(r.count < 0xFFFF) r.count++;
+}
@@ -0,0 +1,70 @@
+#ifndef TEMP_HISTORY_H
+#define TEMP_HISTORY_H
+
+#include <Arduino.h>
+
+// Temperature history of the first probe locations in fixed memory. Every
+// reading updates the running hour and day rollups (min/max/avg) in O(1);
+// when an hour closes its average goes into a ring of the last 24 hours,
+// one byte per hour in 0.5 C steps (-63.5..+63.5 C). The ring lives in
+// EEPROM, each byte is rewritten once a day. There is no clock: hours and
+// days are counted from boot, and the ring starts empty. Values are in 0.1 C.
+class TempHistory {
+public:
+    static constexpr uint8_t PROBES = 2;        // MultiDS18B20 GARAGE, OUTDOOR
+    static constexpr uint8_t HOURS = 24;        // ring of hourly averages
+    static constexpr int16_t NO_DATA = -32768;
+    static constexpr unsigned long HOUR_MS = 3600000UL;
+    static constexpr uint16_t STORE_SIZE = PROBES * HOURS;
+
+    enum class Period : uint8_t {
+        HOUR,       // running hour
+        DAY,        // running day
+        LAST_DAY    // previous complete day
+    };
+
+    struct Rollup {
+        int16_t min;
+        int16_t max;
+        int32_t sum;
+        uint16_t count;
+
+        bool isEmpty() const { return count == 0; }
+        int16_t getAverage() const;             // NO_DATA if empty
+    };
+
+    TempHistory();
+    void begin(uint16_t address);   // EEPROM ring of STORE_SIZE bytes
+
+    void addReading(uint8_t probe, int16_t value, unsigned long now);
+
+    const Rollup& getRollup(uint8_t probe, Period period) const;
+    int16_t getHourly(uint8_t probe, uint8_t hoursAgo) const;  // 1 = last complete hour
+    uint8_t getHourCount() const { return _hourCount; }        // complete hours in the ring
+    unsigned long getUptimeHours() const { return _hours; }
+
+private:
+    static constexpr int8_t HOURLY_NO_DATA = -128;
+    static constexpr uint16_t NO_STORE = 0xFFFF;
+
+    struct Probe {
+        Rollup hour;
+        Rollup day;
+        Rollup lastDay;
+    };
+
+    Probe _probes[PROBES];
+    uint16_t _address = NO_STORE;   // hourly ring, probe after probe
+    uint8_t _head = 0;              // next ring slot, shared by all probes
+    uint8_t _hourCount = 0;
+    unsigned long _hourStart = 0;
+    unsigned long _hours = 0;       // hours closed since boot
+
+    void _advance(unsigned long now);
+    void _closeHour();
+    static int8_t _toHalfDegrees(int16_t tenths);
+    static void _clear(Rollup& r);
+    static void _add(Rollup& r, int16_t value);
+};
+
+#endif
@@ -4,7 +4,6 @@ iButtonAccess::iButtonAccess(uint8_t pin) : _pin(pin), _oneWire(pin) {}
 
 void iButtonAccess::begin() {
     pinMode(_pin, INPUT_PULLUP);
-    _keyCount = 0;
     changeStatus(SystemStatus::DISARMED);
 }
 
@@ -15,6 +14,12 @@ void iButtonAccess::update() {
 
     uint8_t keyId[8];
     if (readKey(keyId)) {
+        // A key held against the reader is read on every call
+        bool repeat = compareKeys(keyId, _lastKey) && millis() - _lastKeyTime < KEY_HOLDOFF;
+        _lastKeyTime = millis();
+        if (repeat) return;
+        memcpy(_lastKey, keyId, 8);
+
         if (isKeyAuthorized(keyId)) {
             if (_accessGrantedCallback) _accessGrantedCallback(keyId);
             if (_status == SystemStatus::ARMED || _status == SystemStatus::ALARM) disarmSystem();
@@ -27,36 +32,24 @@ void iButtonAccess::update() {
 }
 
 bool iButtonAccess::readKey(uint8_t* keyId) {
-    if (!_oneWire.reset() || _oneWire.read() != 0x33) return false;
+    // READ ROM (0x33) is a command to the key, then its 8 ROM bytes follow
+    if (!_oneWire.reset()) return false;
+    _oneWire.write(0x33);
     for (uint8_t i = 0; i < 8; i++) keyId[i] = _oneWire.read();
-    return _oneWire.crc8(keyId, 7) == keyId[7];
+    // A shorted or floating line passes the CRC as all zeros
+    return keyId[0] != 0 && _oneWire.crc8(keyId, 7) == keyId[7];
 }
 
 bool iButtonAccess::addKey(const uint8_t* keyId) {
-    if (_keyCount >= 10) return false;
-    memcpy(_authorizedKeys[_keyCount], keyId, 8);
-    _keyCount++;
-    return true;
+    return _keys && _keys->add(keyId) == KeyStore::Result::OK;
 }
 
 bool iButtonAccess::removeKey(const uint8_t* keyId) {
-    for (uint8_t i = 0; i < _keyCount; i++) {
-        if (compareKeys(_authorizedKeys[i], keyId)) {
-            for (uint8_t j = i; j < _keyCount - 1; j++) {
-                memcpy(_authorizedKeys[j], _authorizedKeys[j + 1], 8);
-            }
-            _keyCount--;
-            return true;
-        }
-    }
-    return false;
+    return _keys && _keys->remove(keyId) == KeyStore::Result::OK;
 }
 
 bool iButtonAccess::isKeyAuthorized(const uint8_t* keyId) {
-    for (uint8_t i = 0; i < _keyCount; i++) {
-        if (compareKeys(_authorizedKeys[i], keyId)) return true;
-    }
-    return false;
+    return _keys && _keys->contains(keyId);
 }
 
 void iButtonAccess::armSystem(uint16_t delaySec) {
@@ -99,8 +92,8 @@ bool iButtonAccess::compareKeys(const uint8_t* key1, const uint8_t* key2) {
 
 void iButtonAccess::printKey(const uint8_t* keyId) {
     for (uint8_t i = 0; i < 8; i++) {
-        if (keyId[i] < 0x10) Serial.print("0");
+        if (keyId[i] < 0x10) Serial.print('0');
         Serial.print(keyId[i], HEX);
-        if (i < 7) Serial.print(":");
+        if (i < 7) Serial.print(':');
     }
 }
\ No newline at end of file
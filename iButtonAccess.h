@@ -3,10 +3,11 @@
 
 #include <Arduino.h>
 #include <OneWire.h>
+#include <KeyStore.h>
 
 class iButtonAccess {
 public:
-    enum class SystemStatus {
+    enum class SystemStatus : uint8_t {
         DISARMED,       // System off
         ARMING,         // Arming in progress
         ARMED,          // System armed
@@ -17,10 +18,13 @@ public:
     typedef void (*AccessCallback)(const uint8_t* keyId);
     typedef void (*StatusCallback)(SystemStatus status);
 
+    static constexpr uint16_t KEY_HOLDOFF = 2000;  // ms without the key before it counts again
+
     explicit iButtonAccess(uint8_t pin);
     
     void begin();
     void update();
+    void setKeyStore(KeyStore& keys) { _keys = &keys; }
     bool addKey(const uint8_t* keyId);
     bool removeKey(const uint8_t* keyId);
     void armSystem(uint16_t delaySec = 0);
@@ -43,8 +47,9 @@ private:
     unsigned long _armingStartTime = 0;
     uint16_t _armingDelay = 0;
     
-    uint8_t _authorizedKeys[2][8] = {0}; // Max 3 keys
-    uint8_t _keyCount = 0;
+    KeyStore* _keys = nullptr;
+    uint8_t _lastKey[8] = {0};          // held on the reader: reported once
+    unsigned long _lastKeyTime = 0;
     
     AccessCallback _accessGrantedCallback = nullptr;
     AccessCallback _accessDeniedCallback = nullptr;
@@ -0,0 +1,235 @@
+#include "OneWireBus.h"
+#include "SimBoard.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace sim {
+
+namespace {
+
+OneWireBus g_buses[NUM_PINS];
+
+} // namespace
+
+OneWireBus& OneWireBus::onPin(uint8_t pin) {
+    return g_buses[pin < NUM_PINS ? pin : 0];
+}
+
+bool OneWireBus::addThermometer(const uint8_t* rom7, float celsius) {
+    if (_count >= MAX_DEVICES) return false;
+    Device& d = _devices[_count++];
+    memset(&d, 0, sizeof(d));
+    d.kind = Kind::THERMOMETER;
+    d.present = true;
+    memcpy(d.rom, rom7, 7);
+    d.rom[7] = crc8(d.rom, 7);
+    d.celsius = celsius;
+    // Power-on scratchpad: 85 C, TH/TL defaults, 12-bit resolution
+    const uint8_t por[8] = {0x50, 0x05, 0x4B, 0x46, 0x7F, 0xFF, 0x0C, 0x10};
+    memcpy(d.scratch, por, 8);
+    d.scratch[8] = crc8(d.scratch, 8);
+    return true;
+}
+
+bool OneWireBus::setTemperature(uint8_t index, float celsius) {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_devices[i].kind != Kind::THERMOMETER) continue;
+        if (n++ == index) {
+            _devices[i].celsius = celsius;
+            return true;
+        }
+    }
+    return false;
+}
+
+void OneWireBus::setIButton(const uint8_t* rom8) {
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_devices[i].kind == Kind::IBUTTON) {
+            _devices[i].present = rom8 != nullptr;
+            if (rom8) memcpy(_devices[i].rom, rom8, 8);
+            return;
+        }
+    }
+    if (!rom8 || _count >= MAX_DEVICES + 1) return;
+    Device& d = _devices[_count++];
+    memset(&d, 0, sizeof(d));
+    d.kind = Kind::IBUTTON;
+    d.present = true;
+    memcpy(d.rom, rom8, 8);
+}
+
+const uint8_t* OneWireBus::romAt(uint8_t index) const {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < _count; i++) {
+        if (!_devices[i].present) continue;
+        if (n++ == index) return _devices[i].rom;
+    }
+    return nullptr;
+}
+
+bool OneWireBus::reset() {
+    bool presence = false;
+    for (uint8_t i = 0; i < _count; i++) {
+        _devices[i].selected = false;
+        if (_devices[i].present) presence = true;
+    }
+    _phase = presence ? Phase::ROM_COMMAND : Phase::IDLE;
+    return presence;
+}
+
+void OneWireBus::writeByte(uint8_t v) {
+    switch (_phase) {
+        case Phase::ROM_COMMAND:
+            if (v == 0x33) {            // READ ROM: open-drain AND of all ROMs
+                memset(_romOut, 0xFF, sizeof(_romOut));
+                for (uint8_t i = 0; i < _count; i++) {
+                    if (!_devices[i].present) continue;
+                    _devices[i].selected = true;
+                    for (uint8_t j = 0; j < 8; j++) _romOut[j] &= _devices[i].rom[j];
+                }
+                _phase = Phase::READ_ROM;
+                _index = 0;
+            } else if (v == 0x55) {     // MATCH ROM
+                _phase = Phase::MATCH_ROM;
+                _index = 0;
+            } else if (v == 0xCC) {     // SKIP ROM
+                for (uint8_t i = 0; i < _count; i++) {
+                    _devices[i].selected = _devices[i].present;
+                }
+                _phase = Phase::FUNCTION;
+            } else {
+                _phase = Phase::IDLE;
+            }
+            break;
+
+        case Phase::MATCH_ROM:
+            _matchRom[_index++] = v;
+            if (_index == 8) {
+                for (uint8_t i = 0; i < _count; i++) {
+                    _devices[i].selected = _devices[i].present &&
+                                           memcmp(_devices[i].rom, _matchRom, 8) == 0;
+                }
+                _phase = Phase::FUNCTION;
+            }
+            break;
+
+        case Phase::READ_ROM:           // DS1990A accepts nothing after READ ROM
+            _phase = Phase::IDLE;
+            break;
+
+        case Phase::FUNCTION:
+            if (v == 0x44) {            // CONVERT T
+                for (uint8_t i = 0; i < _count; i++) {
+                    Device& d = _devices[i];
+                    if (d.selected && d.kind == Kind::THERMOMETER) _startConversion(d);
+                }
+                _phase = Phase::CONVERTING;
+            } else if (v == 0xBE) {     // READ SCRATCHPAD
+                _phase = Phase::READ_SCRATCHPAD;
+                _index = 0;
+            } else if (v == 0x4E) {     // WRITE SCRATCHPAD: TH, TL, config
+                _phase = Phase::WRITE_SCRATCHPAD;
+                _index = 0;
+            } else if (v == 0xB4) {     // READ POWER SUPPLY
+                _phase = Phase::READ_POWER;
+            } else {                    // COPY/RECALL: accepted, no effect
+                _phase = Phase::IDLE;
+            }
+            break;
+
+        case Phase::WRITE_SCRATCHPAD:
+            for (uint8_t i = 0; i < _count; i++) {
+                Device& d = _devices[i];
+                if (!d.selected || d.kind != Kind::THERMOMETER) continue;
+                uint8_t value = v;
+                if (_index == 2) value = (v & 0x60) | 0x1F;   // config register
+                d.scratch[2 + _index] = value;
+                d.scratch[8] = crc8(d.scratch, 8);
+            }
+            if (++_index == 3) _phase = Phase::IDLE;
+            break;
+
+        default:
+            break;
+    }
+}
+
+uint8_t OneWireBus::readByte() {
+    if (_phase == Phase::READ_ROM) {
+        if (_index < 8) return _romOut[_index++];
+        return 0xFF;
+    }
+    if (_phase == Phase::READ_SCRATCHPAD) {
+        Device* d = _firstSelected();
+        if (!d || _index >= 9) return 0xFF;
+        _settle(*d);
+        return d->scratch[_index++];
+    }
+    uint8_t v = 0;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+        if (readBit()) v |= 1 << bit;
+    }
+    return v;
+}
+
+bool OneWireBus::readBit() {
+    if (_phase == Phase::CONVERTING) {
+        // Read slots return 0 while any addressed probe is still converting
+        for (uint8_t i = 0; i < _count; i++) {
+            Device& d = _devices[i];
+            if (!d.selected || d.kind != Kind::THERMOMETER) continue;
+            _settle(d);
+            if (d.convertDoneAt) return false;
+        }
+        return true;
+    }
+    if (_phase == Phase::READ_POWER) return true;   // externally powered
+    return true;                                     // idle bus floats high
+}
+
+uint8_t OneWireBus::crc8(const uint8_t* data, uint8_t len) {
+    uint8_t crc = 0;
+    while (len--) {
+        uint8_t inbyte = *data++;
+        for (uint8_t i = 8; i; i--) {
+            uint8_t mix = (crc ^ inbyte) & 0x01;
+            crc >>= 1;
+            if (mix) crc ^= 0x8C;
+            inbyte >>= 1;
+        }
+    }
+    return crc;
+}
+
+OneWireBus::Device* OneWireBus::_firstSelected() {
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_devices[i].selected && _devices[i].kind == Kind::THERMOMETER) {
+            return &_devices[i];
+        }
+    }
+    return nullptr;
+}
+
+void OneWireBus::_startConversion(Device& d) {
+    uint8_t bits = 9 + ((d.scratch[4] >> 5) & 0x03);
+    int16_t raw = (int16_t)lroundf(d.celsius * 16.0f);
+    raw &= (int16_t)~((1 << (12 - bits)) - 1);
+    d.pendingRaw = raw;
+    d.convertDoneAt = nowMicros() + _conversionMicros(d.scratch[4]);
+}
+
+void OneWireBus::_settle(Device& d) {
+    if (!d.convertDoneAt || nowMicros() < d.convertDoneAt) return;
+    d.scratch[0] = (uint8_t)(d.pendingRaw & 0xFF);
+    d.scratch[1] = (uint8_t)((uint16_t)d.pendingRaw >> 8);
+    d.scratch[8] = crc8(d.scratch, 8);
+    d.convertDoneAt = 0;
+}
+
+uint32_t OneWireBus::_conversionMicros(uint8_t config) {
+    return 93750UL << ((config >> 5) & 0x03);
+}
+
+} // namespace sim
@@ -0,0 +1,65 @@
+#ifndef SIM_ONE_WIRE_BUS_H
+#define SIM_ONE_WIRE_BUS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace sim {
+
+// Byte-level model of a 1-Wire bus with DS18B20 probes and a DS1990A
+// iButton. Implements the ROM commands (READ/MATCH/SKIP ROM) and the
+// DS18B20 function commands the OneWire/DallasTemperature stand-ins issue.
+class OneWireBus {
+public:
+    static constexpr uint8_t MAX_DEVICES = 8;
+
+    static OneWireBus& onPin(uint8_t pin);
+
+    // Devices
+    bool addThermometer(const uint8_t* rom7, float celsius); // CRC appended
+    bool setTemperature(uint8_t index, float celsius);
+    void setIButton(const uint8_t* rom8);    // nullptr removes the key
+    uint8_t deviceCount() const { return _count; }
+    const uint8_t* romAt(uint8_t index) const;
+
+    // Link layer
+    bool reset();
+    void writeByte(uint8_t v);
+    uint8_t readByte();
+    bool readBit();
+
+    static uint8_t crc8(const uint8_t* data, uint8_t len);
+
+private:
+    enum class Kind : uint8_t { THERMOMETER, IBUTTON };
+    enum class Phase : uint8_t { IDLE, ROM_COMMAND, MATCH_ROM, FUNCTION,
+                                 READ_ROM, READ_SCRATCHPAD, WRITE_SCRATCHPAD,
+                                 CONVERTING, READ_POWER };
+
+    struct Device {
+        Kind kind;
+        bool present;
+        uint8_t rom[8];
+        float celsius;          // environment temperature
+        uint8_t scratch[9];     // last conversion result + config
+        int16_t pendingRaw;     // result of the conversion in progress
+        uint64_t convertDoneAt; // 0 when no conversion is running
+        bool selected;
+    };
+
+    Device _devices[MAX_DEVICES + 1];
+    uint8_t _count = 0;         // thermometers + iButton slot if used
+    Phase _phase = Phase::IDLE;
+    uint8_t _index = 0;
+    uint8_t _matchRom[8];
+    uint8_t _romOut[8];
+
+    Device* _firstSelected();
+    void _startConversion(Device& d);
+    void _settle(Device& d);
+    static uint32_t _conversionMicros(uint8_t config);
+};
+
+} // namespace sim
+
+#endif
@@ -0,0 +1,158 @@
+#include "Peers.h"
+#include "SimBoard.h"
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+namespace sim {
+
+// FakeModem
+
+FakeModem::FakeModem(SerialLink& link) : _link(link) {
+    _line[0] = '\0';
+    _smsNumber[0] = '\0';
+}
+
+void FakeModem::onMcuByte(uint8_t b) {
+    if (_echo) _link.send(&b, 1);
+
+    if (_textMode) {
+        if (b == 0x1A) {            // Ctrl+Z: submit
+            _smsText[_smsLen] = '\0';
+            _textMode = false;
+            _smsSent++;
+            log("SMS #%u to %s: %s", _smsSent, _smsNumber, _smsText);
+            char buf[40];
+            snprintf(buf, sizeof(buf), "\r\n+CMGS: %u\r\n\r\nOK\r\n", _smsSent & 0xFF);
+            _reply(buf, _smsDelayMs);
+        } else if (b == 0x1B) {     // ESC: abort
+            _textMode = false;
+            _reply("\r\nOK\r\n", _responseDelayMs);
+        } else if (b == '\n' && _smsLen == 0) {
+            // LF of the CR LF that terminated AT+CMGS
+        } else if (_smsLen < sizeof(_smsText) - 1) {
+            _smsText[_smsLen++] = (char)b;
+        }
+        return;
+    }
+
+    if (b == '\r') {
+        _line[_lineLen] = '\0';
+        if (_lineLen > 0) _command(_line);
+        _lineLen = 0;
+    } else if (b != '\n' && _lineLen < sizeof(_line) - 1) {
+        _line[_lineLen++] = (char)b;
+    }
+}
+
+void FakeModem::injectLine(const char* text) {
+    _link.send("\r\n");
+    _link.send(text);
+    _link.send("\r\n");
+}
+
+void FakeModem::_command(const char* cmd) {
+    trace("modem <- %s", cmd);
+    if (strncasecmp(cmd, "AT", 2) != 0) {
+        _reply("\r\nERROR\r\n", _responseDelayMs);
+        return;
+    }
+    const char* arg = cmd + 2;
+
+    if (strcasecmp(arg, "E0") == 0 || strcasecmp(arg, "E1") == 0) {
+        _echo = arg[1] == '1';
+        _reply("\r\nOK\r\n", _responseDelayMs);
+    } else if (strcasecmp(arg, "+CREG?") == 0) {
+        _reply(_registered ? "\r\n+CREG: 0,1\r\n\r\nOK\r\n"
+                           : "\r\n+CREG: 0,0\r\n\r\nOK\r\n", _responseDelayMs);
+    } else if (strncasecmp(arg, "+CMGS=", 6) == 0) {
+        if (!_registered) {
+            _reply("\r\n+CMS ERROR: 331\r\n", _responseDelayMs);
+            return;
+        }
+        const char* num = arg + 6;
+        if (*num == '"') num++;
+        size_t len = strcspn(num, "\"");
+        if (len >= sizeof(_smsNumber)) len = sizeof(_smsNumber) - 1;
+        memcpy(_smsNumber, num, len);
+        _smsNumber[len] = '\0';
+        _smsLen = 0;
+        _textMode = true;
+        _reply("\r\n> ", _responseDelayMs);
+    } else if (toupper((unsigned char)arg[0]) == 'D') {
+        _callsMade++;
+        log("CALL #%u to %s", _callsMade, arg + 1);
+        _reply(_registered ? "\r\nOK\r\n" : "\r\nNO CARRIER\r\n", _responseDelayMs);
+    } else if (strcasecmp(arg, "+CSQ") == 0) {
+        _reply("\r\n+CSQ: 20,0\r\n\r\nOK\r\n", _responseDelayMs);
+    } else {
+        // ATH, AT+CMGF=1, AT+CNMI=..., AT+CLIP=1, AT+CMGR=n, AT+CFUN=n, ...
+        _reply("\r\nOK\r\n", _responseDelayMs);
+    }
+}
+
+void FakeModem::_reply(const char* text, uint32_t delayMs) {
+    _link.send(text, (uint64_t)delayMs * 1000ULL);
+}
+
+// PtyPeer
+
+PtyPeer::PtyPeer(SerialLink& link) : _link(link) {
+    _slaveName[0] = '\0';
+}
+
+PtyPeer::~PtyPeer() {
+    if (_fd >= 0) close(_fd);
+}
+
+bool PtyPeer::open() {
+    _fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (_fd < 0 || grantpt(_fd) != 0 || unlockpt(_fd) != 0) return false;
+    const char* name = ptsname(_fd);
+    if (!name) return false;
+    strncpy(_slaveName, name, sizeof(_slaveName) - 1);
+    _slaveName[sizeof(_slaveName) - 1] = '\0';
+    return true;
+}
+
+void PtyPeer::onMcuByte(uint8_t b) {
+    if (_fd >= 0) {
+        ssize_t n = write(_fd, &b, 1);
+        (void)n;
+    }
+}
+
+void PtyPeer::poll() {
+    if (_fd < 0) return;
+    uint8_t buf[64];
+    ssize_t n = read(_fd, buf, sizeof(buf));
+    if (n > 0) _link.send(buf, (size_t)n);
+}
+
+// ConsolePeer
+
+void ConsolePeer::onMcuByte(uint8_t b) {
+    fputc(b, stdout);
+    if (b == '\n') fflush(stdout);
+}
+
+void ConsolePeer::poll() {
+    if (_eof) return;
+    pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+    if (::poll(&pfd, 1, 0) <= 0) return;
+    uint8_t buf[64];
+    ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+    if (n <= 0) {
+        _eof = true;
+        return;
+    }
+    _link.send(buf, (size_t)n);
+}
+
+} // namespace sim
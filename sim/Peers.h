@@ -0,0 +1,76 @@
+#ifndef SIM_PEERS_H
+#define SIM_PEERS_H
+
+#include "SerialLink.h"
+
+namespace sim {
+
+// Scriptable stand-in for the SIM800 modem on the GSM soft serial port.
+// Understands the AT subset the sketch uses, with configurable latency.
+class FakeModem : public SerialPeer {
+public:
+    explicit FakeModem(SerialLink& link);
+
+    void onMcuByte(uint8_t b) override;
+
+    void setRegistered(bool registered) { _registered = registered; }
+    void setResponseDelay(uint32_t ms) { _responseDelayMs = ms; }
+    void setSmsDelay(uint32_t ms) { _smsDelayMs = ms; }
+    void injectLine(const char* text);   // unsolicited result code
+    uint16_t smsSent() const { return _smsSent; }
+    uint16_t callsMade() const { return _callsMade; }
+
+private:
+    SerialLink& _link;
+    char _line[96];
+    uint8_t _lineLen = 0;
+    bool _echo = true;
+    bool _registered = true;
+    bool _textMode = false;
+    char _smsNumber[24];
+    char _smsText[192];
+    uint8_t _smsLen = 0;
+    uint16_t _smsSent = 0;
+    uint16_t _callsMade = 0;
+    uint32_t _responseDelayMs = 20;
+    uint32_t _smsDelayMs = 3000;
+
+    void _command(const char* cmd);
+    void _reply(const char* text, uint32_t delayMs);
+};
+
+// Exposes a UART on a pseudo-terminal so a real modem bridge or a
+// terminal program can talk to the sketch. Use with realtime mode.
+class PtyPeer : public SerialPeer {
+public:
+    explicit PtyPeer(SerialLink& link);
+    ~PtyPeer();
+
+    bool open();
+    const char* slaveName() const { return _slaveName; }
+
+    void onMcuByte(uint8_t b) override;
+    void poll() override;
+
+private:
+    SerialLink& _link;
+    int _fd = -1;
+    char _slaveName[64];
+};
+
+// Hardware Serial console: TX goes to stdout, RX comes from stdin.
+class ConsolePeer : public SerialPeer {
+public:
+    explicit ConsolePeer(SerialLink& link) : _link(link) {}
+
+    void onMcuByte(uint8_t b) override;
+    void poll() override;
+
+private:
+    SerialLink& _link;
+    bool _eof = false;
+};
+
+} // namespace sim
+
+#endif
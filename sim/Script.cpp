@@ -0,0 +1,177 @@
+#include "SimBoard.h"
+#include "OneWireBus.h"
+#include "SerialLink.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Scenario script format, one event per line ('#' starts a comment):
+//
+//   <ms> pin <pin> <0|1|float>        drive an input (float = release)
+//   <ms> adc <pin> <0..1023>          set an analog input
+//   <ms> ds18b20 <pin> <rom7hex> <C>  attach a probe (CRC is appended)
+//   <ms> temp <pin> <index> <C>       change a probe's temperature
+//   <ms> ibutton <pin> <rom8hex|->    touch / release an iButton key
+//   <ms> gsm <text>                   unsolicited line from the modem
+//   <ms> console <text>               line typed on the Serial console
+//   <ms> mark <text>                  print a marker in the sim log
+//   <ms> stall <ms>                   hold the running loop() pass in delay()
+//
+// Pins are Arduino numbers or A0..A7.
+
+namespace sim {
+
+namespace {
+
+struct Event {
+    uint64_t atUs;
+    char line[120];
+};
+
+Event* g_events = nullptr;
+size_t g_eventCount = 0;
+size_t g_nextEvent = 0;
+bool g_running = false;
+uint32_t g_stallMs = 0;
+
+bool parseHex(const char* text, uint8_t* out, size_t len) {
+    if (strlen(text) != len * 2) return false;
+    for (size_t i = 0; i < len; i++) {
+        char byte[3] = {text[2 * i], text[2 * i + 1], 0};
+        if (!isxdigit((unsigned char)byte[0]) || !isxdigit((unsigned char)byte[1])) return false;
+        out[i] = (uint8_t)strtoul(byte, nullptr, 16);
+    }
+    return true;
+}
+
+const char* restOf(const char* line, int words) {
+    while (words-- > 0) {
+        while (*line && !isspace((unsigned char)*line)) line++;
+        while (*line && isspace((unsigned char)*line)) line++;
+    }
+    return line;
+}
+
+void apply(const char* line) {
+    char cmd[16], a[40], b[40], c[40];
+    int n = sscanf(line, "%15s %39s %39s %39s", cmd, a, b, c);
+    if (n < 1) return;
+    int pin = n >= 2 ? parsePin(a) : -1;
+
+    if (strcmp(cmd, "pin") == 0 && pin >= 0 && n >= 3) {
+        int8_t level = strcmp(b, "float") == 0 ? -1 : (int8_t)(atoi(b) ? 1 : 0);
+        trace("script: pin %d <- %s", pin, b);
+        driveExternal(pin, level);
+    } else if (strcmp(cmd, "adc") == 0 && pin >= 0 && n >= 3) {
+        trace("script: adc %d <- %s", pin, b);
+        setAnalog(pin, (uint16_t)atoi(b));
+    } else if (strcmp(cmd, "ds18b20") == 0 && pin >= 0 && n >= 4) {
+        uint8_t rom[7];
+        if (!parseHex(b, rom, 7) || !OneWireBus::onPin(pin).addThermometer(rom, atof(c))) {
+            log("script: bad ds18b20 line: %s", line);
+        }
+    } else if (strcmp(cmd, "temp") == 0 && pin >= 0 && n >= 4) {
+        trace("script: temp %d[%s] <- %s C", pin, b, c);
+        OneWireBus::onPin(pin).setTemperature((uint8_t)atoi(b), atof(c));
+    } else if (strcmp(cmd, "ibutton") == 0 && pin >= 0 && n >= 3) {
+        uint8_t rom[8];
+        if (strcmp(b, "-") == 0) {
+            trace("script: ibutton released");
+            OneWireBus::onPin(pin).setIButton(nullptr);
+        } else if (parseHex(b, rom, 8)) {
+            trace("script: ibutton %s", b);
+            OneWireBus::onPin(pin).setIButton(rom);
+        } else {
+            log("script: bad ibutton line: %s", line);
+        }
+    } else if (strcmp(cmd, "gsm") == 0) {
+        SerialLink* link = softSerialLink(0);
+        trace("script: gsm %s", restOf(line, 1));
+        if (link) {
+            link->send("\r\n");
+            link->send(restOf(line, 1));
+            link->send("\r\n");
+        }
+    } else if (strcmp(cmd, "console") == 0) {
+        consoleLink().send(restOf(line, 1));
+        consoleLink().send("\n");
+    } else if (strcmp(cmd, "mark") == 0) {
+        log("mark: %s", restOf(line, 1));
+    } else if (strcmp(cmd, "stall") == 0 && n >= 2) {
+        trace("script: stall %s ms", a);
+        g_stallMs = (uint32_t)atol(a);
+    } else {
+        log("script: unknown command: %s", line);
+    }
+}
+
+} // namespace
+
+bool loadScript(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    char line[160];
+    size_t cap = 0;
+    while (fgets(line, sizeof(line), f)) {
+        char* hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        line[strcspn(line, "\r\n")] = '\0';
+        char* p = line;
+        while (isspace((unsigned char)*p)) p++;
+        if (!*p) continue;
+
+        char* rest;
+        double ms = strtod(p, &rest);
+        if (rest == p) {
+            log("script: missing time: %s", p);
+            continue;
+        }
+        while (isspace((unsigned char)*rest)) rest++;
+
+        if (g_eventCount == cap) {
+            cap = cap ? cap * 2 : 32;
+            g_events = (Event*)realloc(g_events, cap * sizeof(Event));
+        }
+        Event& e = g_events[g_eventCount++];
+        e.atUs = (uint64_t)(ms * 1000.0);
+        strncpy(e.line, rest, sizeof(e.line) - 1);
+        e.line[sizeof(e.line) - 1] = '\0';
+    }
+    fclose(f);
+    // Stable sort: events at the same time keep their file order
+    for (size_t i = 1; i < g_eventCount; i++) {
+        Event tmp = g_events[i];
+        size_t j = i;
+        while (j > 0 && g_events[j - 1].atUs > tmp.atUs) {
+            g_events[j] = g_events[j - 1];
+            j--;
+        }
+        g_events[j] = tmp;
+    }
+    runDueEvents();
+    return true;
+}
+
+void runDueEvents() {
+    if (g_running) return;
+    g_running = true;
+    while (g_nextEvent < g_eventCount && g_events[g_nextEvent].atUs <= nowMicros()) {
+        apply(g_events[g_nextEvent++].line);
+    }
+    g_running = false;
+}
+
+uint64_t nextEventMicros() {
+    if (g_running || g_nextEvent >= g_eventCount) return UINT64_MAX;
+    return g_events[g_nextEvent].atUs;
+}
+
+uint32_t takeStall() {
+    uint32_t ms = g_stallMs;
+    g_stallMs = 0;
+    return ms;
+}
+
+} // namespace sim
@@ -0,0 +1,123 @@
+#include "SerialLink.h"
+#include "SimBoard.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace sim {
+
+namespace {
+
+constexpr uint8_t MAX_SOFT_SERIALS = 4;
+SerialLink* g_softSerials[MAX_SOFT_SERIALS];
+uint8_t g_softSerialCount = 0;
+
+} // namespace
+
+SerialLink& consoleLink() {
+    static SerialLink link(9600, false);
+    return link;
+}
+
+SerialLink* softSerialLink(uint8_t index) {
+    return index < g_softSerialCount ? g_softSerials[index] : nullptr;
+}
+
+uint8_t softSerialCount() {
+    return g_softSerialCount;
+}
+
+SerialLink* createSoftSerialLink() {
+    SerialLink* link = new SerialLink(9600, true);
+    if (g_softSerialCount < MAX_SOFT_SERIALS) g_softSerials[g_softSerialCount++] = link;
+    return link;
+}
+
+SerialLink::SerialLink(uint32_t baud, bool softwareUart)
+    : _softwareUart(softwareUart) {
+    setBaud(baud);
+}
+
+void SerialLink::setBaud(uint32_t baud) {
+    if (baud == 0) baud = 9600;
+    _frameUs = (uint32_t)(10000000UL / baud); // start + 8 data + stop bits
+}
+
+void SerialLink::mcuWrite(uint8_t b) {
+    if (_softwareUart) {
+        // Bit-banged TX runs with interrupts off for the whole frame
+        advanceMicros(_frameUs);
+    }
+    if (_peer) _peer->onMcuByte(b);
+}
+
+int SerialLink::available() {
+    advanceMicros(costs().serialPoll);
+    _pump();
+    return (uint8_t)(_rxTail - _rxHead + RX_BUFFER_SIZE) % RX_BUFFER_SIZE;
+}
+
+int SerialLink::read() {
+    advanceMicros(costs().serialPoll);
+    _pump();
+    if (_rxHead == _rxTail) return -1;
+    uint8_t b = _rx[_rxHead];
+    _rxHead = (_rxHead + 1) % RX_BUFFER_SIZE;
+    return b;
+}
+
+int SerialLink::peek() {
+    _pump();
+    if (_rxHead == _rxTail) return -1;
+    return _rx[_rxHead];
+}
+
+bool SerialLink::overflow() {
+    bool ret = _overflow;
+    _overflow = false;
+    return ret;
+}
+
+void SerialLink::send(const uint8_t* data, size_t len, uint64_t delayUs) {
+    if (_pendingLen + len > _pendingCap) {
+        size_t cap = _pendingCap ? _pendingCap * 2 : 256;
+        while (cap < _pendingLen + len) cap *= 2;
+        _pending = (Pending*)realloc(_pending, cap * sizeof(Pending));
+        _pendingCap = cap;
+    }
+    uint64_t t = nowMicros() + delayUs;
+    if (t < _lastArrival) t = _lastArrival;
+    for (size_t i = 0; i < len; i++) {
+        t += _frameUs;
+        _pending[_pendingLen].at = t;
+        _pending[_pendingLen].b = data[i];
+        _pendingLen++;
+    }
+    _lastArrival = t;
+}
+
+void SerialLink::send(const char* text, uint64_t delayUs) {
+    send((const uint8_t*)text, strlen(text), delayUs);
+}
+
+void SerialLink::_pump() {
+    if (_peer) _peer->poll();
+    size_t done = 0;
+    while (done < _pendingLen && _pending[done].at <= nowMicros()) {
+        uint8_t next = (_rxTail + 1) % RX_BUFFER_SIZE;
+        if (next == _rxHead) {
+            _overflow = true;
+        } else {
+            _rx[_rxTail] = _pending[done].b;
+            _rxTail = next;
+        }
+        done++;
+        if (_softwareUart) advanceMicros(_frameUs);
+    }
+    if (done) {
+        memmove(_pending, _pending + done, (_pendingLen - done) * sizeof(Pending));
+        _pendingLen -= done;
+    }
+}
+
+} // namespace sim
@@ -0,0 +1,73 @@
+#ifndef SIM_SERIAL_LINK_H
+#define SIM_SERIAL_LINK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace sim {
+
+// Something on the far end of a UART (modem emulator, pty, ...)
+class SerialPeer {
+public:
+    virtual ~SerialPeer() {}
+    virtual void onMcuByte(uint8_t b) = 0;  // byte transmitted by the sketch
+    virtual void poll() {}                  // chance to push pending input
+};
+
+// One UART wire pair between the sketch and a peer. Bytes from the peer
+// arrive at line speed and land in a 64-byte receive buffer, like the
+// SoftwareSerial/HardwareSerial ring buffers on the AVR; overflow drops.
+class SerialLink {
+public:
+    static constexpr uint8_t RX_BUFFER_SIZE = 64;
+
+    // A software UART receives in its pin-change ISR, which holds the CPU
+    // for a whole frame per byte; that time is charged to the sketch.
+    explicit SerialLink(uint32_t baud = 9600, bool softwareUart = false);
+
+    void setBaud(uint32_t baud);
+    uint32_t frameMicros() const { return _frameUs; }
+    void attach(SerialPeer* peer) { _peer = peer; }
+
+    // Sketch side
+    void mcuWrite(uint8_t b);
+    int available();
+    int read();
+    int peek();
+    bool overflow();
+
+    // Peer side: queue bytes to arrive no earlier than delayUs from now
+    void send(const uint8_t* data, size_t len, uint64_t delayUs = 0);
+    void send(const char* text, uint64_t delayUs = 0);
+
+private:
+    struct Pending {
+        uint64_t at;
+        uint8_t b;
+    };
+
+    uint32_t _frameUs;
+    bool _softwareUart;
+    SerialPeer* _peer = nullptr;
+    uint8_t _rx[RX_BUFFER_SIZE];
+    uint8_t _rxHead = 0;
+    uint8_t _rxTail = 0;
+    bool _overflow = false;
+    Pending* _pending = nullptr;
+    size_t _pendingLen = 0;
+    size_t _pendingCap = 0;
+    uint64_t _lastArrival = 0;
+
+    void _pump();
+};
+
+// Ports owned by the HAL: the USART console and the SoftwareSerial
+// instances in construction order (the sketch only has the GSM one).
+SerialLink& consoleLink();
+SerialLink* softSerialLink(uint8_t index);
+uint8_t softSerialCount();
+SerialLink* createSoftSerialLink();
+
+} // namespace sim
+
+#endif
@@ -0,0 +1,203 @@
+#include "SimBoard.h"
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+namespace sim {
+
+namespace {
+
+struct Pin {
+    uint8_t mode = 0;       // INPUT
+    uint8_t out = 0;        // output latch / pull-up enable
+    int8_t ext = -1;        // level driven from outside, -1 = floating
+    uint16_t adc = 0;
+    unsigned int tone = 0;
+};
+
+uint64_t g_virtualUs = 0;
+uint64_t g_wallStart = 0;
+bool g_realtime = false;
+bool g_trace = false;
+Costs g_costs;
+Pin g_pins[NUM_PINS];
+PinChangeHook g_pinChangeHook = nullptr;
+
+constexpr uint16_t EEPROM_CELLS = 1024;
+uint32_t g_eepromWrites[EEPROM_CELLS];
+uint32_t g_eepromTotal = 0;
+
+uint64_t wallMicros() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+void vprint(const char* tag, const char* fmt, va_list ap) {
+    uint64_t t = nowMicros();
+    fprintf(stderr, "[%s %llu.%03llu] ", tag,
+            (unsigned long long)(t / 1000000ULL),
+            (unsigned long long)((t / 1000ULL) % 1000ULL));
+    vfprintf(stderr, fmt, ap);
+    fputc('\n', stderr);
+}
+
+} // namespace
+
+uint64_t nowMicros() {
+    if (g_realtime) {
+        g_virtualUs = wallMicros() - g_wallStart;
+        runDueEvents();
+    }
+    return g_virtualUs;
+}
+
+void advanceMicros(uint64_t us) {
+    if (g_realtime) {
+        if (us >= 200) {
+            timespec ts = {(time_t)(us / 1000000ULL), (long)((us % 1000000ULL) * 1000)};
+            nanosleep(&ts, nullptr);
+        }
+        nowMicros();
+        return;
+    }
+    // Stop at every event on the way, so a pin change during a long delay()
+    // happens (and interrupts) at its own time
+    uint64_t target = g_virtualUs + us;
+    for (uint64_t next = nextEventMicros(); next <= target; next = nextEventMicros()) {
+        if (next > g_virtualUs) g_virtualUs = next;
+        runDueEvents();
+    }
+    g_virtualUs = target;
+    runDueEvents();
+}
+
+void setRealtime(bool enable) {
+    g_realtime = enable;
+    g_wallStart = wallMicros() - g_virtualUs;
+}
+
+bool isRealtime() { return g_realtime; }
+
+Costs& costs() { return g_costs; }
+
+namespace {
+
+void notifyChange(uint8_t pin, uint8_t before) {
+    if (g_pinChangeHook && readPin(pin) != before) g_pinChangeHook(pin);
+}
+
+} // namespace
+
+void setPinMode(uint8_t pin, uint8_t mode) {
+    if (pin >= NUM_PINS) return;
+    uint8_t before = readPin(pin);
+    g_pins[pin].mode = mode;
+    // INPUT_PULLUP is INPUT with the output latch set, as on the AVR
+    if (mode == 2) g_pins[pin].out = 1;
+    else if (mode == 0) g_pins[pin].out = 0;
+    notifyChange(pin, before);
+}
+
+void writePin(uint8_t pin, uint8_t level) {
+    if (pin >= NUM_PINS) return;
+    level = level ? 1 : 0;
+    uint8_t before = readPin(pin);
+    if (g_pins[pin].mode == 1 && g_pins[pin].out != level) {
+        trace("pin %u -> %u", pin, level);
+    }
+    g_pins[pin].out = level;
+    notifyChange(pin, before);
+}
+
+uint8_t readPin(uint8_t pin) {
+    if (pin >= NUM_PINS) return 0;
+    const Pin& p = g_pins[pin];
+    if (p.mode == 1) return p.out;          // PINx reflects the driven level
+    if (p.ext >= 0) return (uint8_t)p.ext;
+    return p.out;                            // pull-up high, otherwise floating low
+}
+
+void driveExternal(uint8_t pin, int8_t level) {
+    if (pin >= NUM_PINS) return;
+    uint8_t before = readPin(pin);
+    g_pins[pin].ext = level;
+    notifyChange(pin, before);
+}
+
+void onPinChange(PinChangeHook hook) {
+    g_pinChangeHook = hook;
+}
+
+void setAnalog(uint8_t pin, uint16_t value) {
+    if (pin >= NUM_PINS) return;
+    g_pins[pin].adc = value > 1023 ? 1023 : value;
+}
+
+uint16_t readAnalog(uint8_t pin) {
+    // analogRead() accepts both channel numbers and A0..A7
+    if (pin < 8) pin += PIN_A0;
+    if (pin >= NUM_PINS) return 0;
+    return g_pins[pin].adc;
+}
+
+void setTone(uint8_t pin, unsigned int frequency) {
+    if (pin >= NUM_PINS) return;
+    if (g_pins[pin].tone != frequency) {
+        trace("tone %u -> %u Hz", pin, frequency);
+    }
+    g_pins[pin].tone = frequency;
+}
+
+int parsePin(const char* name) {
+    if (!name || !*name) return -1;
+    if (toupper((unsigned char)name[0]) == 'A' && isdigit((unsigned char)name[1])) {
+        int n = atoi(name + 1);
+        return n < 8 ? PIN_A0 + n : -1;
+    }
+    if (!isdigit((unsigned char)name[0])) return -1;
+    int n = atoi(name);
+    return n < NUM_PINS ? n : -1;
+}
+
+void noteEepromWrite(uint16_t address) {
+    if (address >= EEPROM_CELLS) return;
+    g_eepromWrites[address]++;
+    g_eepromTotal++;
+}
+
+uint32_t eepromWriteCount() { return g_eepromTotal; }
+
+uint16_t eepromHottestCell(uint32_t* writes) {
+    uint16_t hottest = 0;
+    for (uint16_t i = 1; i < EEPROM_CELLS; i++) {
+        if (g_eepromWrites[i] > g_eepromWrites[hottest]) hottest = i;
+    }
+    if (writes) *writes = g_eepromWrites[hottest];
+    return hottest;
+}
+
+void setTrace(bool enable) { g_trace = enable; }
+
+bool traceEnabled() { return g_trace; }
+
+void log(const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vprint("sim", fmt, ap);
+    va_end(ap);
+}
+
+void trace(const char* fmt, ...) {
+    if (!g_trace) return;
+    va_list ap;
+    va_start(ap, fmt);
+    vprint("trc", fmt, ap);
+    va_end(ap);
+}
+
+} // namespace sim
@@ -0,0 +1,67 @@
+#ifndef SIM_BOARD_H
+#define SIM_BOARD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Host-side model of the ATmega328P board the sketch runs on.
+// All timing is driven by a virtual microsecond clock: every HAL call
+// charges its approximate AVR cost, delay() just moves the clock forward,
+// so a run is deterministic and loop latency can be measured exactly.
+namespace sim {
+
+constexpr uint8_t NUM_PINS = 22;   // D0..D13, A0..A7 (Nano layout)
+constexpr uint8_t PIN_A0 = 14;
+
+// Approximate cost of HAL operations on a 16 MHz AVR (microseconds)
+struct Costs {
+    uint32_t clockRead = 2;      // millis()/micros()
+    uint32_t digitalIo = 4;      // digitalRead()/digitalWrite()/pinMode()
+    uint32_t analogRead = 112;   // 13 ADC clocks at 125 kHz + overhead
+    uint32_t serialPoll = 2;     // available()/read() on a serial port
+    uint32_t eepromWrite = 3400; // one EEPROM cell erase+write
+    uint32_t eepromRead = 2;
+    uint32_t isr = 3;            // interrupt entry and exit
+};
+
+// Clock
+uint64_t nowMicros();
+void advanceMicros(uint64_t us);
+void setRealtime(bool enable);   // follow the wall clock (for pty sessions)
+bool isRealtime();
+Costs& costs();
+
+// Pins
+void setPinMode(uint8_t pin, uint8_t mode);
+void writePin(uint8_t pin, uint8_t level);
+uint8_t readPin(uint8_t pin);
+void driveExternal(uint8_t pin, int8_t level); // -1 releases the line
+void setAnalog(uint8_t pin, uint16_t value);
+uint16_t readAnalog(uint8_t pin);
+void setTone(uint8_t pin, unsigned int frequency);
+int parsePin(const char* name);                // "A1", "13" -> pin number
+
+// Called whenever the level read from a pin changes (pin change interrupts)
+typedef void (*PinChangeHook)(uint8_t pin);
+void onPinChange(PinChangeHook hook);
+
+// EEPROM wear statistics
+void noteEepromWrite(uint16_t address);
+uint32_t eepromWriteCount();
+uint16_t eepromHottestCell(uint32_t* writes);
+
+// Tracing (stderr, prefixed with virtual time)
+void setTrace(bool enable);
+bool traceEnabled();
+void log(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+void trace(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+
+// Scenario script: "<ms> <command> <args>" lines applied at virtual time
+bool loadScript(const char* path);
+void runDueEvents();
+uint64_t nextEventMicros();      // UINT64_MAX if none can run now
+uint32_t takeStall();            // ms of a scripted stall not yet run, or 0
+
+} // namespace sim
+
+#endif
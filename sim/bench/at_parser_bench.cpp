@@ -0,0 +1,177 @@
+// Host benchmark for AtParser.
+//
+// Replays modem transcripts (bench/transcripts/*.at) through the streaming
+// parser used by GSMController and through the String-based reader it
+// replaced, and reports host time per byte, heap traffic and the tokens
+// recognized. Transcript format: one modem output line per line, framed
+// as "\r\n<line>\r\n" on replay; "> " is the unframed AT+CMGS prompt;
+// '#' starts a comment.
+//
+//   make bench
+//   build/at_parser_bench [-n bytes] transcript.at...
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+
+// After the standard headers: Arduino.h defines min/max as macros
+#include <Arduino.h>
+#include <AtParser.h>
+
+// Heap calls made from the linked objects (the String stand-in), counted
+// through -Wl,--wrap
+static unsigned long g_heapCalls = 0;
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    g_heapCalls++;
+    return __real_malloc(size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    g_heapCalls++;
+    return __real_realloc(ptr, size);
+}
+}
+
+namespace {
+
+struct Result {
+    double nsPerByte;
+    unsigned long heapCalls;
+    unsigned long responses;    // final results seen
+    unsigned long tokens[11];   // AtParser only, indexed by Token
+};
+
+bool loadTranscript(const char* path, std::string& stream) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        size_t len = strcspn(line, "\r\n");
+        line[len] = '\0';
+        if (len == 0 || line[0] == '#') continue;
+        if (strcmp(line, "> ") == 0 || strcmp(line, ">") == 0) {
+            stream += "\r\n> ";
+        } else {
+            stream += "\r\n";
+            stream += line;
+            stream += "\r\n";
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+Result runParser(const std::string& stream, size_t totalBytes) {
+    Result r = {};
+    AtParser parser;
+    parser.expectPrompt(true);
+    char line[AtParser::LINE_SIZE];
+    unsigned long heapBefore = g_heapCalls;
+
+    auto start = std::chrono::steady_clock::now();
+    size_t done = 0;
+    while (done < totalBytes) {
+        for (char c : stream) {
+            AtParser::Token t = parser.feed(c);
+            if (t == AtParser::Token::NONE) continue;
+            r.tokens[static_cast<uint8_t>(t)]++;
+            if (t == AtParser::Token::OK || t == AtParser::Token::ERROR) r.responses++;
+            // GSMController copies the line out for these
+            if (t == AtParser::Token::CMT || t == AtParser::Token::CLIP ||
+                t == AtParser::Token::CREG || t == AtParser::Token::LINE) {
+                parser.getLine(line, sizeof(line));
+            }
+        }
+        done += stream.size();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    r.nsPerByte = std::chrono::duration<double, std::nano>(elapsed).count() / done;
+    r.heapCalls = g_heapCalls - heapBefore;
+    return r;
+}
+
+// The receive path of GSMController before the streaming parser:
+// _readSerial() appends each byte to a String and tests endsWith() for the
+// final result codes, _waitForResponse() scans with indexOf().
+Result runLegacy(const std::string& stream, size_t totalBytes) {
+    Result r = {};
+    unsigned long heapBefore = g_heapCalls;
+
+    auto start = std::chrono::steady_clock::now();
+    size_t done = 0;
+    while (done < totalBytes) {
+        String data;
+        for (char c : stream) {
+            data += c;
+            if (data.indexOf("+CMGS:") != -1 || data.indexOf(">") != -1) {
+                // _waitForResponse() would return here; keep scanning
+            }
+            if (data.endsWith("\r\nOK\r\n") || data.endsWith("\r\nERROR\r\n")) {
+                r.responses++;
+                data = "";
+            }
+        }
+        done += stream.size();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    r.nsPerByte = std::chrono::duration<double, std::nano>(elapsed).count() / done;
+    r.heapCalls = g_heapCalls - heapBefore;
+    return r;
+}
+
+const char* const kTokenNames[] = {
+    "NONE", "OK", "ERROR", "PROMPT", "CMGS", "CLIP", "CMT", "CREG", "RING", "CALL_END", "LINE"
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t totalBytes = 4u << 20;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:h")) != -1) {
+        switch (opt) {
+            case 'n': totalBytes = strtoul(optarg, nullptr, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-n bytes] transcript.at...\n", argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "usage: %s [-n bytes] transcript.at...\n", argv[0]);
+        return 2;
+    }
+
+    for (int i = optind; i < argc; i++) {
+        std::string stream;
+        if (!loadTranscript(argv[i], stream) || stream.empty()) {
+            fprintf(stderr, "%s: cannot read transcript\n", argv[i]);
+            return 1;
+        }
+
+        Result p = runParser(stream, totalBytes);
+        Result l = runLegacy(stream, totalBytes);
+        size_t passes = (totalBytes + stream.size() - 1) / stream.size();
+
+        printf("%s: %zu bytes x %zu passes\n", argv[i], stream.size(), passes);
+        printf("  AtParser     %7.2f ns/byte  %8.2f heap calls/KB  %lu final results\n",
+               p.nsPerByte, p.heapCalls * 1024.0 / (passes * stream.size()), p.responses / passes);
+        printf("  String+find  %7.2f ns/byte  %8.2f heap calls/KB  %lu final results\n",
+               l.nsPerByte, l.heapCalls * 1024.0 / (passes * stream.size()), l.responses / passes);
+        printf("  tokens/pass:");
+        for (uint8_t t = 1; t < sizeof(kTokenNames) / sizeof(kTokenNames[0]); t++) {
+            if (p.tokens[t]) printf(" %s=%lu", kTokenNames[t], p.tokens[t] / passes);
+        }
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+// Host accuracy check for the fixed-point MQ-7 curve in SmokeSensor.
+//
+// Runs every 10-bit reading through SmokeSensor::rawToPPMx10() and through
+// the float formula it replaced (pow() with a negative exponent), for a
+// few values of R0, and reports the relative error. Readings are split in
+// the alarm band (10..1000 ppm) and the rest of the range from 1 ppm, below
+// which the 0.1 ppm step dominates; readings above 6553.5 ppm saturate and
+// are only counted.
+//
+//   make bench
+//   build/ppm_curve_bench [-v] [r0_kohm...]    -v prints every 64th reading
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// After the standard headers: Arduino.h defines min/max as macros
+#include <Arduino.h>
+#include <SmokeSensor.h>
+
+namespace {
+
+// SmokeSensor.cpp before the lookup table, in double
+const double kRLoad = 10.0;
+const double kParA = 116.6020682;
+const double kParB = 2.769034857;
+
+double referencePPM(int raw, double r0) {
+    double voltage = raw * (5.0 / 1023.0);
+    double rs = ((5.0 * kRLoad) / voltage) - kRLoad;
+    return kParA * pow(rs / r0, -kParB);
+}
+
+struct Band {
+    const char* name;
+    double lo, hi;
+    unsigned n;
+    double sumErr, maxErr;
+    int worstRaw;
+};
+
+void addSample(Band& b, int raw, double ref, double got) {
+    if (ref < b.lo || ref >= b.hi) return;
+    double err = fabs(got - ref) / ref;
+    b.n++;
+    b.sumErr += err;
+    if (err > b.maxErr) {
+        b.maxErr = err;
+        b.worstRaw = raw;
+    }
+}
+
+void printBand(const Band& b) {
+    if (!b.n) {
+        printf("  %-12s no readings\n", b.name);
+        return;
+    }
+    printf("  %-12s %4u readings  mean %.3f%%  max %.3f%% at raw %d\n", b.name, b.n,
+           100.0 * b.sumErr / b.n, 100.0 * b.maxErr, b.worstRaw);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bool verbose = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "vh")) != -1) {
+        switch (opt) {
+            case 'v': verbose = true; break;
+            default:
+                fprintf(stderr, "usage: %s [-v] [r0_kohm...]\n", argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+
+    static const double kDefaultR0[] = { 10.0, 76.63, 250.0 };
+    int count = argc - optind;
+    for (int k = 0; k < (count ? count : 3); k++) {
+        double r0 = count ? atof(argv[optind + k]) : kDefaultR0[k];
+        if (r0 <= 0) {
+            fprintf(stderr, "%s: R0 must be positive\n", argv[optind + k]);
+            return 2;
+        }
+        int16_t offset = SmokeSensor::curveOffset(r0);
+
+        Band alarm = { "10-1000 ppm", 10.0, 1000.0, 0, 0, 0, 0 };
+        Band rest = { "1-6553 ppm", 1.0, 6553.5, 0, 0, 0, 0 };
+        unsigned saturated = 0;
+        printf("R0 %.2f kOhm (offset %d)\n", r0, offset);
+        for (int raw = 1; raw < 1023; raw++) {
+            double ref = referencePPM(raw, r0);
+            double got = SmokeSensor::rawToPPMx10(raw, offset) / 10.0;
+            if (ref >= 6553.5) saturated++;
+            if (ref >= 10.0 && ref < 1000.0) {
+                addSample(alarm, raw, ref, got);
+            } else {
+                addSample(rest, raw, ref, got);
+            }
+            if (verbose && raw % 64 == 0) {
+                printf("    raw %4d  float %10.2f  table %8.1f\n", raw, ref, got);
+            }
+        }
+        printBand(alarm);
+        printBand(rest);
+        printf("  saturated    %4u readings\n", saturated);
+    }
+    return 0;
+}
@@ -0,0 +1,35 @@
+# Turns the .ino into a C++ translation unit the way the Arduino builder
+# does: prepend <Arduino.h> and insert prototypes for every top-level
+# function ahead of the first function definition.
+#
+# usage: awk -f gen_prototypes.awk sketch.ino sketch.ino > sketch.ino.cpp
+
+function is_definition(line) {
+    if (line !~ /^[A-Za-z_][A-Za-z0-9_:<>,&* ]*[ *&]+[A-Za-z_][A-Za-z0-9_]*[ \t]*\(.*\)[ \t]*\{[ \t\r]*$/)
+        return 0
+    return line !~ /^(if|else|for|while|switch|do|return)[ \t(]/
+}
+
+FNR == 1 { pass++ }
+
+pass == 1 {
+    if (is_definition($0)) {
+        proto = $0
+        sub(/[ \t]*\{[ \t\r]*$/, ";", proto)
+        protos[++nprotos] = proto
+        if (!first) first = FNR
+    }
+    next
+}
+
+pass == 2 {
+    if (FNR == 1) {
+        print "#include <Arduino.h>"
+        printf "#line 1 \"%s\"\n", FILENAME
+    }
+    if (FNR == first) {
+        for (i = 1; i <= nprotos; i++) print protos[i]
+        printf "#line %d \"%s\"\n", FNR, FILENAME
+    }
+    print
+}
@@ -0,0 +1,122 @@
+#include <Arduino.h>
+
+#include "../SimBoard.h"
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    sim::advanceMicros(sim::costs().digitalIo);
+    sim::setPinMode(pin, mode);
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    sim::advanceMicros(sim::costs().digitalIo);
+    sim::writePin(pin, val);
+}
+
+int digitalRead(uint8_t pin) {
+    sim::advanceMicros(sim::costs().digitalIo);
+    return sim::readPin(pin);
+}
+
+int analogRead(uint8_t pin) {
+    sim::advanceMicros(sim::costs().analogRead);
+    return sim::readAnalog(pin);
+}
+
+void analogWrite(uint8_t pin, int val) {
+    sim::advanceMicros(sim::costs().digitalIo);
+    sim::setPinMode(pin, OUTPUT);
+    sim::writePin(pin, val >= 128 ? HIGH : LOW);
+}
+
+unsigned long millis(void) {
+    sim::advanceMicros(sim::costs().clockRead);
+    return (uint32_t)(sim::nowMicros() / 1000ULL);
+}
+
+unsigned long micros(void) {
+    sim::advanceMicros(sim::costs().clockRead);
+    return (uint32_t)sim::nowMicros();
+}
+
+void delay(unsigned long ms) {
+    sim::advanceMicros((uint64_t)ms * 1000ULL);
+}
+
+void delayMicroseconds(unsigned int us) {
+    sim::advanceMicros(us);
+}
+
+void yield(void) {}
+
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration) {
+    // Only the tone state is recorded; timed tones are not stopped
+    (void)duration;
+    sim::advanceMicros(sim::costs().digitalIo);
+    sim::setPinMode(pin, OUTPUT);
+    sim::setTone(pin, frequency);
+}
+
+void noTone(uint8_t pin) {
+    sim::advanceMicros(sim::costs().digitalIo);
+    sim::setTone(pin, 0);
+    sim::writePin(pin, LOW);
+}
+
+static uint32_t g_randomState = 1;
+
+void randomSeed(unsigned long seed) {
+    if (seed != 0) g_randomState = (uint32_t)seed;
+}
+
+long random(long howbig) {
+    if (howbig == 0) return 0;
+    // Park-Miller, like avr-libc random()
+    g_randomState = (uint32_t)(((uint64_t)g_randomState * 16807ULL) % 2147483647ULL);
+    return g_randomState % howbig;
+}
+
+long random(long howsmall, long howbig) {
+    if (howsmall >= howbig) return howsmall;
+    return random(howbig - howsmall) + howsmall;
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+char* dtostrf(double val, signed char width, unsigned char prec, char* sout) {
+    sprintf(sout, "%*.*f", width, prec, val);
+    return sout;
+}
+
+static char* toBase(unsigned long value, char* str, int base, bool negative) {
+    char buf[8 * sizeof(unsigned long) + 2];
+    char* p = buf + sizeof(buf) - 1;
+    *p = '\0';
+    if (base < 2 || base > 36) base = 10;
+    do {
+        int digit = value % base;
+        *--p = digit < 10 ? '0' + digit : 'a' + digit - 10;
+        value /= base;
+    } while (value);
+    if (negative) *--p = '-';
+    strcpy(str, p);
+    return str;
+}
+
+char* itoa(int value, char* str, int base) {
+    return ltoa(value, str, base);
+}
+
+char* ltoa(long value, char* str, int base) {
+    if (base == 10 && value < 0) return toBase(-(unsigned long)value, str, base, true);
+    return toBase((unsigned long)value, str, base, false);
+}
+
+char* utoa(unsigned value, char* str, int base) {
+    return toBase(value, str, base, false);
+}
+
+char* ultoa(unsigned long value, char* str, int base) {
+    return toBase(value, str, base, false);
+}
@@ -0,0 +1,242 @@
+#include <DallasTemperature.h>
+
+#include <Arduino.h>
+
+namespace {
+
+constexpr uint8_t STARTCONVO = 0x44;
+constexpr uint8_t READSCRATCH = 0xBE;
+constexpr uint8_t WRITESCRATCH = 0x4E;
+constexpr uint8_t READPOWERSUPPLY = 0xB4;
+
+constexpr uint8_t TEMP_LSB = 0;
+constexpr uint8_t TEMP_MSB = 1;
+constexpr uint8_t HIGH_ALARM_TEMP = 2;
+constexpr uint8_t LOW_ALARM_TEMP = 3;
+constexpr uint8_t CONFIGURATION = 4;
+constexpr uint8_t SCRATCHPAD_CRC = 8;
+
+constexpr uint8_t TEMP_9_BIT = 0x1F;
+constexpr uint8_t TEMP_10_BIT = 0x3F;
+constexpr uint8_t TEMP_11_BIT = 0x5F;
+constexpr uint8_t TEMP_12_BIT = 0x7F;
+
+} // namespace
+
+void DallasTemperature::begin(void) {
+    DeviceAddress deviceAddress;
+
+    _wire->reset_search();
+    _devices = 0;
+    _ds18Count = 0;
+    _parasite = false;
+
+    while (_wire->search(deviceAddress)) {
+        if (validAddress(deviceAddress)) {
+            if (!_parasite && readPowerSupply(deviceAddress)) _parasite = true;
+            _devices++;
+            if (validFamily(deviceAddress)) {
+                _ds18Count++;
+                uint8_t b = getResolution(deviceAddress);
+                if (b > _bitResolution) _bitResolution = b;
+            }
+        }
+    }
+}
+
+bool DallasTemperature::validAddress(const uint8_t* deviceAddress) {
+    return OneWire::crc8(deviceAddress, 7) == deviceAddress[7];
+}
+
+bool DallasTemperature::validFamily(const uint8_t* deviceAddress) {
+    switch (deviceAddress[0]) {
+        case DS18S20MODEL:
+        case DS18B20MODEL:
+        case DS1822MODEL:
+        case DS1825MODEL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool DallasTemperature::getAddress(uint8_t* deviceAddress, uint8_t index) {
+    uint8_t depth = 0;
+    _wire->reset_search();
+    while (depth <= index && _wire->search(deviceAddress)) {
+        if (depth == index && validAddress(deviceAddress)) return true;
+        depth++;
+    }
+    return false;
+}
+
+bool DallasTemperature::isConnected(const uint8_t* deviceAddress) {
+    ScratchPad scratchPad;
+    return isConnected(deviceAddress, scratchPad);
+}
+
+bool DallasTemperature::isConnected(const uint8_t* deviceAddress, uint8_t* scratchPad) {
+    bool b = readScratchPad(deviceAddress, scratchPad);
+    return b && OneWire::crc8(scratchPad, 8) == scratchPad[SCRATCHPAD_CRC];
+}
+
+bool DallasTemperature::readScratchPad(const uint8_t* deviceAddress, uint8_t* scratchPad) {
+    if (_wire->reset() == 0) return false;
+    _wire->select(deviceAddress);
+    _wire->write(READSCRATCH);
+    for (uint8_t i = 0; i < 9; i++) scratchPad[i] = _wire->read();
+    return _wire->reset() == 1;
+}
+
+void DallasTemperature::writeScratchPad(const uint8_t* deviceAddress, const uint8_t* scratchPad) {
+    _wire->reset();
+    _wire->select(deviceAddress);
+    _wire->write(WRITESCRATCH);
+    _wire->write(scratchPad[HIGH_ALARM_TEMP]);
+    _wire->write(scratchPad[LOW_ALARM_TEMP]);
+    _wire->write(scratchPad[CONFIGURATION]);
+    _wire->reset();
+}
+
+bool DallasTemperature::readPowerSupply(const uint8_t* deviceAddress) {
+    bool parasiteMode = false;
+    _wire->reset();
+    if (deviceAddress == nullptr) _wire->skip();
+    else _wire->select(deviceAddress);
+    _wire->write(READPOWERSUPPLY);
+    if (_wire->read_bit() == 0) parasiteMode = true;
+    _wire->reset();
+    return parasiteMode;
+}
+
+void DallasTemperature::setResolution(uint8_t newResolution) {
+    _bitResolution = constrain(newResolution, 9, 12);
+    DeviceAddress deviceAddress;
+    _wire->reset_search();
+    for (uint8_t i = 0; i < _devices; i++) {
+        if (_wire->search(deviceAddress) && validAddress(deviceAddress)) {
+            setResolution(deviceAddress, _bitResolution, true);
+        }
+    }
+}
+
+uint8_t DallasTemperature::getResolution(const uint8_t* deviceAddress) {
+    if (deviceAddress[0] == DS18S20MODEL) return 12;
+    ScratchPad scratchPad;
+    if (isConnected(deviceAddress, scratchPad)) {
+        switch (scratchPad[CONFIGURATION]) {
+            case TEMP_12_BIT: return 12;
+            case TEMP_11_BIT: return 11;
+            case TEMP_10_BIT: return 10;
+            case TEMP_9_BIT: return 9;
+        }
+    }
+    return 0;
+}
+
+bool DallasTemperature::setResolution(const uint8_t* deviceAddress, uint8_t newResolution,
+                                      bool skipGlobalBitResolutionCalculation) {
+    newResolution = constrain(newResolution, 9, 12);
+    ScratchPad scratchPad;
+    if (!isConnected(deviceAddress, scratchPad)) return false;
+    if (deviceAddress[0] == DS18S20MODEL) return true;
+
+    uint8_t config;
+    switch (newResolution) {
+        case 12: config = TEMP_12_BIT; break;
+        case 11: config = TEMP_11_BIT; break;
+        case 10: config = TEMP_10_BIT; break;
+        default: config = TEMP_9_BIT; break;
+    }
+    if (scratchPad[CONFIGURATION] != config) {
+        scratchPad[CONFIGURATION] = config;
+        writeScratchPad(deviceAddress, scratchPad);
+    }
+    if (!skipGlobalBitResolutionCalculation && newResolution > _bitResolution) {
+        _bitResolution = newResolution;
+    }
+    return true;
+}
+
+DallasTemperature::request_t DallasTemperature::requestTemperatures(void) {
+    request_t req = {true, millis()};
+    _wire->reset();
+    _wire->skip();
+    _wire->write(STARTCONVO, _parasite);
+    if (!_waitForConversion) return req;
+    _blockTillConversionComplete(_bitResolution);
+    return req;
+}
+
+DallasTemperature::request_t DallasTemperature::requestTemperaturesByAddress(const uint8_t* deviceAddress) {
+    request_t req = {true, millis()};
+    uint8_t bitResolution = getResolution(deviceAddress);
+    if (bitResolution == 0) {
+        req.result = false;
+        return req;
+    }
+    _wire->reset();
+    _wire->select(deviceAddress);
+    _wire->write(STARTCONVO, _parasite);
+    if (!_waitForConversion) return req;
+    _blockTillConversionComplete(bitResolution);
+    return req;
+}
+
+DallasTemperature::request_t DallasTemperature::requestTemperaturesByIndex(uint8_t index) {
+    DeviceAddress deviceAddress;
+    getAddress(deviceAddress, index);
+    return requestTemperaturesByAddress(deviceAddress);
+}
+
+void DallasTemperature::_blockTillConversionComplete(uint8_t bitResolution) {
+    if (_checkForConversion && !_parasite) {
+        unsigned long start = millis();
+        while (!isConversionComplete() && (millis() - start < millisToWaitForConversion(bitResolution))) {
+            yield();
+        }
+    } else {
+        delay(millisToWaitForConversion(bitResolution));
+    }
+}
+
+bool DallasTemperature::isConversionComplete(void) {
+    return _wire->read_bit() == 1;
+}
+
+uint16_t DallasTemperature::millisToWaitForConversion(uint8_t bitResolution) {
+    switch (bitResolution) {
+        case 9: return 94;
+        case 10: return 188;
+        case 11: return 375;
+        default: return 750;
+    }
+}
+
+int32_t DallasTemperature::_calculateTemperature(const uint8_t* deviceAddress, const uint8_t* scratchPad) {
+    (void)deviceAddress;
+    int16_t raw = (int16_t)(((uint16_t)scratchPad[TEMP_MSB] << 8) | scratchPad[TEMP_LSB]);
+    return (int32_t)raw << 3;   // 1/128 degree units, as the library returns
+}
+
+int32_t DallasTemperature::getTemp(const uint8_t* deviceAddress) {
+    ScratchPad scratchPad;
+    if (isConnected(deviceAddress, scratchPad)) return _calculateTemperature(deviceAddress, scratchPad);
+    return DEVICE_DISCONNECTED_RAW;
+}
+
+float DallasTemperature::getTempC(const uint8_t* deviceAddress) {
+    return rawToCelsius(getTemp(deviceAddress));
+}
+
+float DallasTemperature::getTempF(const uint8_t* deviceAddress) {
+    int32_t raw = getTemp(deviceAddress);
+    if (raw <= DEVICE_DISCONNECTED_RAW) return DEVICE_DISCONNECTED_F;
+    return (float)raw * 0.0140625f + 32.0f;
+}
+
+float DallasTemperature::getTempCByIndex(uint8_t index) {
+    DeviceAddress deviceAddress;
+    if (!getAddress(deviceAddress, index)) return DEVICE_DISCONNECTED_C;
+    return getTempC(deviceAddress);
+}
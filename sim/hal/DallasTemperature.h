@@ -0,0 +1,87 @@
+#ifndef DallasTemperature_h
+#define DallasTemperature_h
+
+#include <stdint.h>
+
+#include <OneWire.h>
+
+// Subset of the Miles Burton DallasTemperature library, implemented on top
+// of the OneWire stand-in so every call costs the real bus time.
+
+#define DEVICE_DISCONNECTED_C -127
+#define DEVICE_DISCONNECTED_F -196.6
+#define DEVICE_DISCONNECTED_RAW -7040
+
+#define DS18S20MODEL 0x10
+#define DS18B20MODEL 0x28
+#define DS1822MODEL  0x22
+#define DS1825MODEL  0x3B
+
+typedef uint8_t DeviceAddress[8];
+typedef uint8_t ScratchPad[9];
+
+class DallasTemperature {
+public:
+    struct request_t {
+        bool result;
+        unsigned long timestamp;
+        operator bool() { return result; }
+    };
+
+    DallasTemperature() {}
+    explicit DallasTemperature(OneWire* oneWire) : _wire(oneWire) {}
+    void setOneWire(OneWire* oneWire) { _wire = oneWire; }
+
+    void begin(void);
+    uint8_t getDeviceCount(void) { return _devices; }
+    uint8_t getDS18Count(void) { return _ds18Count; }
+    bool validAddress(const uint8_t* deviceAddress);
+    bool validFamily(const uint8_t* deviceAddress);
+    bool getAddress(uint8_t* deviceAddress, uint8_t index);
+    bool isConnected(const uint8_t* deviceAddress);
+    bool isConnected(const uint8_t* deviceAddress, uint8_t* scratchPad);
+    bool readScratchPad(const uint8_t* deviceAddress, uint8_t* scratchPad);
+    void writeScratchPad(const uint8_t* deviceAddress, const uint8_t* scratchPad);
+    bool readPowerSupply(const uint8_t* deviceAddress = nullptr);
+
+    uint8_t getResolution() { return _bitResolution; }
+    void setResolution(uint8_t newResolution);
+    uint8_t getResolution(const uint8_t* deviceAddress);
+    bool setResolution(const uint8_t* deviceAddress, uint8_t newResolution,
+                       bool skipGlobalBitResolutionCalculation = false);
+
+    void setWaitForConversion(bool flag) { _waitForConversion = flag; }
+    bool getWaitForConversion(void) { return _waitForConversion; }
+    void setCheckForConversion(bool flag) { _checkForConversion = flag; }
+    bool getCheckForConversion(void) { return _checkForConversion; }
+
+    request_t requestTemperatures(void);
+    request_t requestTemperaturesByAddress(const uint8_t* deviceAddress);
+    request_t requestTemperaturesByIndex(uint8_t index);
+
+    int32_t getTemp(const uint8_t* deviceAddress);
+    float getTempC(const uint8_t* deviceAddress);
+    float getTempF(const uint8_t* deviceAddress);
+    float getTempCByIndex(uint8_t index);
+
+    bool isParasitePowerMode(void) { return _parasite; }
+    bool isConversionComplete(void);
+    static uint16_t millisToWaitForConversion(uint8_t bitResolution);
+    uint16_t millisToWaitForConversion() { return millisToWaitForConversion(_bitResolution); }
+
+    static float rawToCelsius(int32_t raw) { return raw <= DEVICE_DISCONNECTED_RAW ? DEVICE_DISCONNECTED_C : (float)raw * 0.0078125f; }
+
+private:
+    OneWire* _wire = nullptr;
+    uint8_t _devices = 0;
+    uint8_t _ds18Count = 0;
+    uint8_t _bitResolution = 9;
+    bool _parasite = false;
+    bool _waitForConversion = true;
+    bool _checkForConversion = true;
+
+    void _blockTillConversionComplete(uint8_t bitResolution);
+    int32_t _calculateTemperature(const uint8_t* deviceAddress, const uint8_t* scratchPad);
+};
+
+#endif
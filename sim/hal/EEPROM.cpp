@@ -0,0 +1,70 @@
+#include <EEPROM.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../SimBoard.h"
+
+EEPROMClass EEPROM;
+
+namespace {
+
+constexpr uint16_t EEPROM_SIZE = 1024;
+uint8_t g_cells[EEPROM_SIZE];
+uint64_t g_busyUntil = 0;
+bool g_initialized = false;
+
+uint8_t* cells() {
+    if (!g_initialized) {
+        memset(g_cells, 0xFF, sizeof(g_cells));   // erased state
+        g_initialized = true;
+    }
+    return g_cells;
+}
+
+// eeprom_*_byte() spin on EEPE until the previous write has finished
+void waitReady() {
+    uint64_t now = sim::nowMicros();
+    if (g_busyUntil > now) sim::advanceMicros(g_busyUntil - now);
+}
+
+} // namespace
+
+uint8_t EERef::operator*() const {
+    waitReady();
+    sim::advanceMicros(sim::costs().eepromRead);
+    return cells()[index & (EEPROM_SIZE - 1)];
+}
+
+EERef& EERef::operator=(uint8_t in) {
+    waitReady();
+    uint16_t address = index & (EEPROM_SIZE - 1);
+    cells()[address] = in;
+    sim::noteEepromWrite(address);
+    g_busyUntil = sim::nowMicros() + sim::costs().eepromWrite;
+    return *this;
+}
+
+namespace sim {
+
+uint8_t* eepromData() {
+    return cells();
+}
+
+bool loadEeprom(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    size_t n = fread(cells(), 1, EEPROM_SIZE, f);
+    fclose(f);
+    return n == EEPROM_SIZE;
+}
+
+bool saveEeprom(const char* path) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    size_t n = fwrite(cells(), 1, EEPROM_SIZE, f);
+    fclose(f);
+    return n == EEPROM_SIZE;
+}
+
+} // namespace sim
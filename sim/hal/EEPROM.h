@@ -0,0 +1,55 @@
+#ifndef EEPROM_h
+#define EEPROM_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 1 KB ATmega328P EEPROM held in RAM (optionally loaded from / saved to a
+// file by the sim). Writes cost the real 3.4 ms and are counted per cell.
+struct EERef {
+    explicit EERef(int index) : index(index) {}
+
+    uint8_t operator*() const;
+    operator uint8_t() const { return **this; }
+    EERef& operator=(const EERef& ref) { return *this = *ref; }
+    EERef& operator=(uint8_t in);
+    EERef& update(uint8_t in) { return in != *this ? *this = in : *this; }
+
+    int index;
+};
+
+class EEPROMClass {
+public:
+    uint8_t read(int idx) { return *EERef(idx); }
+    void write(int idx, uint8_t val) { EERef ref(idx); ref = val; }
+    void update(int idx, uint8_t val) { EERef ref(idx); ref.update(val); }
+    EERef operator[](int idx) { return EERef(idx); }
+    uint16_t length() { return 1024; }
+
+    template <typename T>
+    T& get(int idx, T& t) {
+        uint8_t* ptr = (uint8_t*)&t;
+        for (size_t count = sizeof(T); count; --count, ++idx) *ptr++ = *EERef(idx);
+        return t;
+    }
+
+    template <typename T>
+    const T& put(int idx, const T& t) {
+        const uint8_t* ptr = (const uint8_t*)&t;
+        for (size_t count = sizeof(T); count; --count, ++idx) {
+            EERef ref(idx);
+            ref.update(*ptr++);
+        }
+        return t;
+    }
+};
+
+extern EEPROMClass EEPROM;
+
+namespace sim {
+uint8_t* eepromData();
+bool loadEeprom(const char* path);
+bool saveEeprom(const char* path);
+}
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef GsmSerial_h
+#define GsmSerial_h
+
+#include <SoftwareSerial.h>
+
+// The sketch's bit-banged GSM port. Its source (../GsmSerial.cpp) drives
+// AVR registers and cycle-counted delays, so the build leaves it out and
+// the port runs on the simulated SoftwareSerial link instead.
+class GsmSerial : public SoftwareSerial {
+public:
+    GsmSerial(uint8_t rxPin, uint8_t txPin) : SoftwareSerial(rxPin, txPin) {}
+};
+
+#endif
@@ -0,0 +1,50 @@
+#include <Arduino.h>
+
+#include "../SerialLink.h"
+#include "../SimBoard.h"
+
+HardwareSerial Serial;
+
+static constexpr uint8_t TX_BUFFER_SIZE = 64;
+
+void HardwareSerial::begin(unsigned long baud) {
+    sim::consoleLink().setBaud(baud);
+}
+
+int HardwareSerial::available() {
+    return sim::consoleLink().available();
+}
+
+int HardwareSerial::read() {
+    return sim::consoleLink().read();
+}
+
+int HardwareSerial::peek() {
+    return sim::consoleLink().peek();
+}
+
+int HardwareSerial::availableForWrite() {
+    uint64_t now = sim::nowMicros();
+    if (_txBusyUntil <= now) return TX_BUFFER_SIZE - 1;
+    uint32_t queued = (uint32_t)((_txBusyUntil - now) / sim::consoleLink().frameMicros());
+    return queued >= TX_BUFFER_SIZE - 1 ? 0 : TX_BUFFER_SIZE - 1 - queued;
+}
+
+void HardwareSerial::flush() {
+    uint64_t now = sim::nowMicros();
+    if (_txBusyUntil > now) sim::advanceMicros(_txBusyUntil - now);
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    sim::SerialLink& link = sim::consoleLink();
+    uint32_t frame = link.frameMicros();
+    uint64_t now = sim::nowMicros();
+    // Block while the ring buffer is full, i.e. until one frame has drained
+    if (_txBusyUntil > now + (uint64_t)frame * (TX_BUFFER_SIZE - 1)) {
+        sim::advanceMicros(_txBusyUntil - now - (uint64_t)frame * (TX_BUFFER_SIZE - 1));
+        now = sim::nowMicros();
+    }
+    _txBusyUntil = (_txBusyUntil > now ? _txBusyUntil : now) + frame;
+    link.mcuWrite(c);
+    return 1;
+}
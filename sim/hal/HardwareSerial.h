@@ -0,0 +1,27 @@
+#ifndef HardwareSerial_h
+#define HardwareSerial_h
+
+#include "Print.h"
+
+// USART0 console. TX models the 64-byte ring buffer draining at the
+// configured baud rate: print() only blocks once the buffer is full.
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long baud);
+    void end() {}
+    int available() override;
+    int read() override;
+    int peek() override;
+    int availableForWrite();
+    void flush() override;
+    size_t write(uint8_t) override;
+    using Print::write;
+    operator bool() { return true; }
+
+private:
+    uint64_t _txBusyUntil = 0;
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,89 @@
+#include <Arduino.h>
+#include <avr/interrupt.h>
+
+#include "../SimBoard.h"
+
+// Pin change interrupts of the ATmega328P. A change on a pin enabled in
+// PCMSKx sets its PCIFx flag; the vector runs when PCICR enables it and
+// interrupts are on, one at a time, as on the AVR. Vectors are weak so the
+// benches link without the sketch.
+
+volatile uint8_t PCICR = 0;
+volatile uint8_t PCIFR = 0;
+volatile uint8_t PCMSK0 = 0;
+volatile uint8_t PCMSK1 = 0;
+volatile uint8_t PCMSK2 = 0;
+
+extern "C" void PCINT0_vect(void) __attribute__((weak));
+extern "C" void PCINT1_vect(void) __attribute__((weak));
+extern "C" void PCINT2_vect(void) __attribute__((weak));
+
+namespace {
+
+bool g_enabled = true;     // the core enables interrupts before setup()
+bool g_inIsr = false;
+
+// Port and bit of a pin, false for A6/A7 (analog only)
+bool portBit(uint8_t pin, uint8_t& port, uint8_t& bit) {
+    if (pin < 8) {
+        port = 2;
+        bit = pin;
+    } else if (pin < 14) {
+        port = 0;
+        bit = pin - 8;
+    } else if (pin < 20) {
+        port = 1;
+        bit = pin - 14;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void dispatch() {
+    if (!g_enabled || g_inIsr) return;
+    g_inIsr = true;
+    while (PCIFR & PCICR & 0x07) {
+        uint8_t pending = PCIFR & PCICR;
+        uint8_t vector = pending & 0x01 ? 0 : pending & 0x02 ? 1 : 2;
+        PCIFR &= ~(1 << vector);
+        void (*isr)(void) = vector == 0 ? PCINT0_vect : vector == 1 ? PCINT1_vect : PCINT2_vect;
+        sim::advanceMicros(sim::costs().isr);
+        if (isr) isr();
+    }
+    g_inIsr = false;
+}
+
+void onPinChange(uint8_t pin) {
+    uint8_t port, bit;
+    if (!portBit(pin, port, bit)) return;
+    uint8_t mask = port == 0 ? PCMSK0 : port == 1 ? PCMSK1 : PCMSK2;
+    if (!(mask & (1 << bit))) return;
+    PCIFR |= 1 << port;
+    dispatch();
+}
+
+struct Install {
+    Install() { sim::onPinChange(onPinChange); }
+} g_install;
+
+} // namespace
+
+uint8_t simReadPort(uint8_t port) {
+    uint8_t first = port == 0 ? 8 : port == 1 ? 14 : 0;
+    uint8_t count = port == 2 ? 8 : 6;
+    uint8_t value = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        if (sim::readPin(first + i)) value |= 1 << i;
+    }
+    return value;
+}
+
+void interrupts(void) {
+    g_enabled = true;
+    dispatch();
+}
+
+void noInterrupts(void) {
+    g_enabled = false;
+}
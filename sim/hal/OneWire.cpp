@@ -0,0 +1,112 @@
+#include <OneWire.h>
+
+#include <string.h>
+
+#include "../OneWireBus.h"
+#include "../SimBoard.h"
+
+namespace {
+
+constexpr uint32_t RESET_US = 960;   // 480 us pulse + 480 us presence window
+constexpr uint32_t SLOT_US = 65;     // one read or write time slot
+
+} // namespace
+
+void OneWire::begin(uint8_t pin) {
+    _bus = &sim::OneWireBus::onPin(pin);
+    reset_search();
+}
+
+uint8_t OneWire::reset(void) {
+    sim::advanceMicros(RESET_US);
+    return _bus->reset() ? 1 : 0;
+}
+
+void OneWire::select(const uint8_t rom[8]) {
+    write(0x55);
+    for (uint8_t i = 0; i < 8; i++) write(rom[i]);
+}
+
+void OneWire::skip(void) {
+    write(0xCC);
+}
+
+void OneWire::write(uint8_t v, uint8_t power) {
+    (void)power;
+    sim::advanceMicros(8 * SLOT_US);
+    _bus->writeByte(v);
+}
+
+void OneWire::write_bytes(const uint8_t* buf, uint16_t count, bool power) {
+    for (uint16_t i = 0; i < count; i++) write(buf[i], power);
+}
+
+uint8_t OneWire::read(void) {
+    sim::advanceMicros(8 * SLOT_US);
+    return _bus->readByte();
+}
+
+void OneWire::read_bytes(uint8_t* buf, uint16_t count) {
+    for (uint16_t i = 0; i < count; i++) buf[i] = read();
+}
+
+void OneWire::write_bit(uint8_t v) {
+    (void)v;
+    sim::advanceMicros(SLOT_US);
+}
+
+uint8_t OneWire::read_bit(void) {
+    sim::advanceMicros(SLOT_US);
+    return _bus->readBit() ? 1 : 0;
+}
+
+void OneWire::reset_search() {
+    _searchIndex = 0;
+    _searchFamily = 0;
+}
+
+void OneWire::target_search(uint8_t family_code) {
+    _searchIndex = 0;
+    _searchFamily = family_code;
+}
+
+bool OneWire::search(uint8_t* newAddr, bool search_mode) {
+    (void)search_mode;
+    // The bit-level SEARCH ROM walk is not modelled; devices come back in
+    // attach order, with the bus time a real search pass takes.
+    while (true) {
+        if (!reset()) return false;
+        write(0xF0);
+        const uint8_t* rom = _bus->romAt(_searchIndex);
+        if (!rom) return false;
+        sim::advanceMicros(64 * 3 * SLOT_US);
+        _searchIndex++;
+        if (_searchFamily && rom[0] != _searchFamily) continue;
+        memcpy(newAddr, rom, 8);
+        return true;
+    }
+}
+
+uint8_t OneWire::crc8(const uint8_t* addr, uint8_t len) {
+    return sim::OneWireBus::crc8(addr, len);
+}
+
+uint16_t OneWire::crc16(const uint8_t* input, uint16_t len, uint16_t crc) {
+    static const uint8_t oddparity[16] = {0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0};
+    for (uint16_t i = 0; i < len; i++) {
+        uint16_t cdata = input[i];
+        cdata = (cdata ^ crc) & 0xff;
+        crc >>= 8;
+        if (oddparity[cdata & 0x0F] ^ oddparity[cdata >> 4]) crc ^= 0xC001;
+        cdata <<= 6;
+        crc ^= cdata;
+        cdata <<= 1;
+        crc ^= cdata;
+    }
+    return crc;
+}
+
+bool OneWire::check_crc16(const uint8_t* input, uint16_t len, const uint8_t* inverted_crc, uint16_t crc) {
+    crc = ~crc16(input, len, crc);
+    return (crc & 0xFF) == inverted_crc[0] && (crc >> 8) == inverted_crc[1];
+}
@@ -0,0 +1,37 @@
+#include <SoftwareSerial.h>
+
+#include "../SerialLink.h"
+
+SoftwareSerial::SoftwareSerial(uint8_t receivePin, uint8_t transmitPin, bool inverse_logic)
+    : _link(sim::createSoftSerialLink()) {
+    (void)receivePin;
+    (void)transmitPin;
+    (void)inverse_logic;
+}
+
+SoftwareSerial::~SoftwareSerial() {}
+
+void SoftwareSerial::begin(long speed) {
+    _link->setBaud((uint32_t)speed);
+}
+
+bool SoftwareSerial::overflow() {
+    return _link->overflow();
+}
+
+int SoftwareSerial::available() {
+    return _link->available();
+}
+
+int SoftwareSerial::read() {
+    return _link->read();
+}
+
+int SoftwareSerial::peek() {
+    return _link->peek();
+}
+
+size_t SoftwareSerial::write(uint8_t byte) {
+    _link->mcuWrite(byte);
+    return 1;
+}
@@ -0,0 +1,35 @@
+#ifndef SoftwareSerial_h
+#define SoftwareSerial_h
+
+#include <Arduino.h>
+
+namespace sim {
+class SerialLink;
+}
+
+// Bit-banged UART. Each transmitted byte blocks for one frame time and each
+// received byte costs one frame of ISR time, as on the AVR implementation.
+class SoftwareSerial : public Stream {
+public:
+    SoftwareSerial(uint8_t receivePin, uint8_t transmitPin, bool inverse_logic = false);
+    ~SoftwareSerial();
+
+    void begin(long speed);
+    bool listen() { return true; }
+    void end() {}
+    bool isListening() { return true; }
+    bool overflow();
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t byte) override;
+    using Print::write;
+    void flush() override {}
+    operator bool() { return true; }
+
+private:
+    sim::SerialLink* _link;
+};
+
+#endif
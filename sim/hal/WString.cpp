@@ -0,0 +1,386 @@
+#include <Arduino.h>
+
+String::String(const char* cstr) {
+    if (cstr) copy(cstr, strlen(cstr));
+}
+
+String::String(const String& value) {
+    *this = value;
+}
+
+String::String(const __FlashStringHelper* pstr) {
+    *this = pstr;
+}
+
+String::String(String&& rval) {
+    move(rval);
+}
+
+String::String(char c) {
+    char buf[2] = {c, 0};
+    *this = buf;
+}
+
+String::String(unsigned char value, unsigned char base) {
+    char buf[1 + 8 * sizeof(unsigned char)];
+    utoa(value, buf, base);
+    *this = buf;
+}
+
+String::String(int value, unsigned char base) {
+    char buf[2 + 8 * sizeof(int)];
+    itoa(value, buf, base);
+    *this = buf;
+}
+
+String::String(unsigned int value, unsigned char base) {
+    char buf[1 + 8 * sizeof(unsigned int)];
+    utoa(value, buf, base);
+    *this = buf;
+}
+
+String::String(long value, unsigned char base) {
+    char buf[2 + 8 * sizeof(long)];
+    ltoa(value, buf, base);
+    *this = buf;
+}
+
+String::String(unsigned long value, unsigned char base) {
+    char buf[1 + 8 * sizeof(unsigned long)];
+    ultoa(value, buf, base);
+    *this = buf;
+}
+
+String::String(float value, unsigned char decimalPlaces) {
+    char buf[33];
+    *this = dtostrf(value, (decimalPlaces + 2), decimalPlaces, buf);
+}
+
+String::String(double value, unsigned char decimalPlaces) {
+    char buf[33];
+    *this = dtostrf(value, (decimalPlaces + 2), decimalPlaces, buf);
+}
+
+String::~String() {
+    free(_buffer);
+}
+
+void String::invalidate() {
+    free(_buffer);
+    _buffer = nullptr;
+    _capacity = _len = 0;
+}
+
+unsigned char String::reserve(unsigned int size) {
+    if (_buffer && _capacity >= size) return 1;
+    if (changeBuffer(size)) {
+        if (_len == 0) _buffer[0] = 0;
+        return 1;
+    }
+    return 0;
+}
+
+unsigned char String::changeBuffer(unsigned int maxStrLen) {
+    char* newbuffer = (char*)realloc(_buffer, maxStrLen + 1);
+    if (newbuffer) {
+        _buffer = newbuffer;
+        _capacity = maxStrLen;
+        return 1;
+    }
+    return 0;
+}
+
+String& String::copy(const char* cstr, unsigned int length) {
+    if (!reserve(length)) {
+        invalidate();
+        return *this;
+    }
+    _len = length;
+    memmove(_buffer, cstr, length);
+    _buffer[length] = 0;
+    return *this;
+}
+
+void String::move(String& rhs) {
+    if (this == &rhs) return;
+    free(_buffer);
+    _buffer = rhs._buffer;
+    _capacity = rhs._capacity;
+    _len = rhs._len;
+    rhs._buffer = nullptr;
+    rhs._capacity = rhs._len = 0;
+}
+
+String& String::operator=(const String& rhs) {
+    if (this == &rhs) return *this;
+    if (rhs._buffer) copy(rhs._buffer, rhs._len);
+    else invalidate();
+    return *this;
+}
+
+String& String::operator=(String&& rval) {
+    move(rval);
+    return *this;
+}
+
+String& String::operator=(const char* cstr) {
+    if (cstr) copy(cstr, strlen(cstr));
+    else invalidate();
+    return *this;
+}
+
+String& String::operator=(const __FlashStringHelper* pstr) {
+    return *this = reinterpret_cast<const char*>(pstr);
+}
+
+unsigned char String::concat(const String& s) {
+    return concat(s._buffer, s._len);
+}
+
+unsigned char String::concat(const char* cstr, unsigned int length) {
+    unsigned int newlen = _len + length;
+    if (!cstr) return 0;
+    if (length == 0) return 1;
+    if (!reserve(newlen)) return 0;
+    memmove(_buffer + _len, cstr, length);
+    _len = newlen;
+    _buffer[_len] = 0;
+    return 1;
+}
+
+unsigned char String::concat(const char* cstr) {
+    if (!cstr) return 0;
+    return concat(cstr, strlen(cstr));
+}
+
+unsigned char String::concat(char c) {
+    return concat(&c, 1);
+}
+
+unsigned char String::concat(unsigned char num) { return concat(String(num)); }
+unsigned char String::concat(int num) { return concat(String(num)); }
+unsigned char String::concat(unsigned int num) { return concat(String(num)); }
+unsigned char String::concat(long num) { return concat(String(num)); }
+unsigned char String::concat(unsigned long num) { return concat(String(num)); }
+unsigned char String::concat(float num) { return concat(String(num)); }
+unsigned char String::concat(double num) { return concat(String(num)); }
+
+unsigned char String::concat(const __FlashStringHelper* str) {
+    return concat(reinterpret_cast<const char*>(str));
+}
+
+String operator+(const String& lhs, const String& rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, const char* rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const char* lhs, const String& rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, char rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, int rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, unsigned int rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, long rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, unsigned long rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, float rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, double rhs) { String s(lhs); s.concat(rhs); return s; }
+
+int String::compareTo(const String& s) const {
+    if (!_buffer || !s._buffer) {
+        if (s._buffer && s._len > 0) return 0 - *(unsigned char*)s._buffer;
+        if (_buffer && _len > 0) return *(unsigned char*)_buffer;
+        return 0;
+    }
+    return strcmp(_buffer, s._buffer);
+}
+
+unsigned char String::equals(const String& s2) const {
+    return (_len == s2._len && compareTo(s2) == 0);
+}
+
+unsigned char String::equals(const char* cstr) const {
+    if (_len == 0) return (cstr == nullptr || *cstr == 0);
+    if (cstr == nullptr) return _buffer[0] == 0;
+    return strcmp(_buffer, cstr) == 0;
+}
+
+unsigned char String::equalsIgnoreCase(const String& s2) const {
+    if (this == &s2) return 1;
+    if (_len != s2._len) return 0;
+    if (_len == 0) return 1;
+    return strcasecmp(_buffer, s2._buffer) == 0;
+}
+
+unsigned char String::startsWith(const String& s2) const {
+    if (_len < s2._len) return 0;
+    return startsWith(s2, 0);
+}
+
+unsigned char String::startsWith(const String& s2, unsigned int offset) const {
+    if (offset > _len - s2._len || !_buffer || !s2._buffer) return 0;
+    return strncmp(&_buffer[offset], s2._buffer, s2._len) == 0;
+}
+
+unsigned char String::endsWith(const String& s2) const {
+    if (_len < s2._len || !_buffer || !s2._buffer) return 0;
+    return strcmp(&_buffer[_len - s2._len], s2._buffer) == 0;
+}
+
+char String::charAt(unsigned int loc) const {
+    return operator[](loc);
+}
+
+void String::setCharAt(unsigned int loc, char c) {
+    if (loc < _len) _buffer[loc] = c;
+}
+
+char& String::operator[](unsigned int index) {
+    static char dummy_writable_char;
+    if (index >= _len || !_buffer) {
+        dummy_writable_char = 0;
+        return dummy_writable_char;
+    }
+    return _buffer[index];
+}
+
+char String::operator[](unsigned int index) const {
+    if (index >= _len || !_buffer) return 0;
+    return _buffer[index];
+}
+
+void String::getBytes(unsigned char* buf, unsigned int bufsize, unsigned int index) const {
+    if (!bufsize || !buf) return;
+    if (index >= _len) {
+        buf[0] = 0;
+        return;
+    }
+    unsigned int n = bufsize - 1;
+    if (n > _len - index) n = _len - index;
+    strncpy((char*)buf, _buffer + index, n);
+    buf[n] = 0;
+}
+
+int String::indexOf(char c) const {
+    return indexOf(c, 0);
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+    if (fromIndex >= _len) return -1;
+    const char* temp = strchr(_buffer + fromIndex, ch);
+    if (temp == nullptr) return -1;
+    return temp - _buffer;
+}
+
+int String::indexOf(const String& s2) const {
+    return indexOf(s2, 0);
+}
+
+int String::indexOf(const String& s2, unsigned int fromIndex) const {
+    if (fromIndex >= _len) return -1;
+    const char* found = strstr(_buffer + fromIndex, s2._buffer);
+    if (found == nullptr) return -1;
+    return found - _buffer;
+}
+
+int String::lastIndexOf(char theChar) const {
+    return lastIndexOf(theChar, _len - 1);
+}
+
+int String::lastIndexOf(char ch, unsigned int fromIndex) const {
+    if (fromIndex >= _len) return -1;
+    for (int i = (int)fromIndex; i >= 0; i--) {
+        if (_buffer[i] == ch) return i;
+    }
+    return -1;
+}
+
+int String::lastIndexOf(const String& s2) const {
+    return lastIndexOf(s2, _len - s2._len);
+}
+
+int String::lastIndexOf(const String& s2, unsigned int fromIndex) const {
+    if (s2._len == 0 || _len == 0 || s2._len > _len) return -1;
+    if (fromIndex >= _len) fromIndex = _len - 1;
+    int found = -1;
+    for (char* p = _buffer; p <= _buffer + fromIndex; p++) {
+        p = strstr(p, s2._buffer);
+        if (!p) break;
+        if ((unsigned int)(p - _buffer) <= fromIndex) found = p - _buffer;
+    }
+    return found;
+}
+
+String String::substring(unsigned int left, unsigned int right) const {
+    if (left > right) {
+        unsigned int temp = right;
+        right = left;
+        left = temp;
+    }
+    String out;
+    if (left >= _len) return out;
+    if (right > _len) right = _len;
+    out.copy(_buffer + left, right - left);
+    return out;
+}
+
+void String::replace(char find, char replace) {
+    if (!_buffer) return;
+    for (char* p = _buffer; *p; p++) {
+        if (*p == find) *p = replace;
+    }
+}
+
+void String::replace(const String& find, const String& replace) {
+    if (_len == 0 || find._len == 0) return;
+    String out;
+    int from = 0;
+    int idx;
+    while ((idx = indexOf(find, from)) >= 0) {
+        out.concat(_buffer + from, idx - from);
+        out.concat(replace);
+        from = idx + find._len;
+    }
+    out.concat(_buffer + from, _len - from);
+    *this = out;
+}
+
+void String::remove(unsigned int index) {
+    remove(index, (unsigned int)-1);
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+    if (index >= _len) return;
+    if (count > _len - index) count = _len - index;
+    char* writeTo = _buffer + index;
+    _len = _len - count;
+    memmove(writeTo, _buffer + index + count, _len - index);
+    _buffer[_len] = 0;
+}
+
+void String::toLowerCase() {
+    if (!_buffer) return;
+    for (char* p = _buffer; *p; p++) *p = tolower((unsigned char)*p);
+}
+
+void String::toUpperCase() {
+    if (!_buffer) return;
+    for (char* p = _buffer; *p; p++) *p = toupper((unsigned char)*p);
+}
+
+void String::trim() {
+    if (!_buffer || _len == 0) return;
+    char* begin = _buffer;
+    while (isspace((unsigned char)*begin)) begin++;
+    char* end = _buffer + _len - 1;
+    while (isspace((unsigned char)*end) && end >= begin) end--;
+    _len = end + 1 - begin;
+    if (begin > _buffer) memmove(_buffer, begin, _len);
+    _buffer[_len] = 0;
+}
+
+long String::toInt() const {
+    return _buffer ? atol(_buffer) : 0;
+}
+
+float String::toFloat() const {
+    return (float)toDouble();
+}
+
+double String::toDouble() const {
+    return _buffer ? atof(_buffer) : 0;
+}
@@ -0,0 +1,130 @@
+#ifndef String_class_h
+#define String_class_h
+
+// Heap-backed String with the Arduino semantics (malloc/realloc growth,
+// implicit conversions, invalid-on-OOM), so allocation patterns match.
+
+#include <stdint.h>
+#include <stddef.h>
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper*>(PSTR(string_literal)))
+
+class String {
+    typedef void (String::*StringIfHelperType)() const;
+    void StringIfHelper() const {}
+
+public:
+    String(const char* cstr = "");
+    String(const String& str);
+    String(const __FlashStringHelper* str);
+    String(String&& rval);
+    explicit String(char c);
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(float value, unsigned char decimalPlaces = 2);
+    explicit String(double value, unsigned char decimalPlaces = 2);
+    ~String();
+
+    unsigned char reserve(unsigned int size);
+    unsigned int length() const { return _len; }
+
+    String& operator=(const String& rhs);
+    String& operator=(const char* cstr);
+    String& operator=(const __FlashStringHelper* str);
+    String& operator=(String&& rval);
+
+    unsigned char concat(const String& str);
+    unsigned char concat(const char* cstr);
+    unsigned char concat(const char* cstr, unsigned int length);
+    unsigned char concat(char c);
+    unsigned char concat(unsigned char num);
+    unsigned char concat(int num);
+    unsigned char concat(unsigned int num);
+    unsigned char concat(long num);
+    unsigned char concat(unsigned long num);
+    unsigned char concat(float num);
+    unsigned char concat(double num);
+    unsigned char concat(const __FlashStringHelper* str);
+
+    template <typename T>
+    String& operator+=(const T& rhs) { concat(rhs); return *this; }
+    String& operator+=(const char* rhs) { concat(rhs); return *this; }
+
+    operator StringIfHelperType() const { return _buffer ? &String::StringIfHelper : 0; }
+
+    int compareTo(const String& s) const;
+    unsigned char equals(const String& s) const;
+    unsigned char equals(const char* cstr) const;
+    unsigned char operator==(const String& rhs) const { return equals(rhs); }
+    unsigned char operator==(const char* cstr) const { return equals(cstr); }
+    unsigned char operator!=(const String& rhs) const { return !equals(rhs); }
+    unsigned char operator!=(const char* cstr) const { return !equals(cstr); }
+    unsigned char operator<(const String& rhs) const { return compareTo(rhs) < 0; }
+    unsigned char operator>(const String& rhs) const { return compareTo(rhs) > 0; }
+    unsigned char equalsIgnoreCase(const String& s) const;
+    unsigned char startsWith(const String& prefix) const;
+    unsigned char startsWith(const String& prefix, unsigned int offset) const;
+    unsigned char endsWith(const String& suffix) const;
+
+    char charAt(unsigned int index) const;
+    void setCharAt(unsigned int index, char c);
+    char operator[](unsigned int index) const;
+    char& operator[](unsigned int index);
+    void getBytes(unsigned char* buf, unsigned int bufsize, unsigned int index = 0) const;
+    void toCharArray(char* buf, unsigned int bufsize, unsigned int index = 0) const {
+        getBytes((unsigned char*)buf, bufsize, index);
+    }
+    const char* c_str() const { return _buffer; }
+    char* begin() { return _buffer; }
+    char* end() { return _buffer + _len; }
+
+    int indexOf(char ch) const;
+    int indexOf(char ch, unsigned int fromIndex) const;
+    int indexOf(const String& str) const;
+    int indexOf(const String& str, unsigned int fromIndex) const;
+    int lastIndexOf(char ch) const;
+    int lastIndexOf(char ch, unsigned int fromIndex) const;
+    int lastIndexOf(const String& str) const;
+    int lastIndexOf(const String& str, unsigned int fromIndex) const;
+    String substring(unsigned int beginIndex) const { return substring(beginIndex, _len); }
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+    void replace(char find, char replace);
+    void replace(const String& find, const String& replace);
+    void remove(unsigned int index);
+    void remove(unsigned int index, unsigned int count);
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    long toInt() const;
+    float toFloat() const;
+    double toDouble() const;
+
+    friend String operator+(const String& lhs, const String& rhs);
+    friend String operator+(const String& lhs, const char* rhs);
+    friend String operator+(const char* lhs, const String& rhs);
+    friend String operator+(const String& lhs, char rhs);
+    friend String operator+(const String& lhs, int rhs);
+    friend String operator+(const String& lhs, unsigned int rhs);
+    friend String operator+(const String& lhs, long rhs);
+    friend String operator+(const String& lhs, unsigned long rhs);
+    friend String operator+(const String& lhs, float rhs);
+    friend String operator+(const String& lhs, double rhs);
+
+protected:
+    char* _buffer = nullptr;
+    unsigned int _capacity = 0;
+    unsigned int _len = 0;
+
+    void invalidate();
+    unsigned char changeBuffer(unsigned int maxStrLen);
+    String& copy(const char* cstr, unsigned int length);
+    void move(String& rhs);
+};
+
+#endif
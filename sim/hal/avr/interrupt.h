@@ -0,0 +1,16 @@
+#ifndef _AVR_INTERRUPT_H_
+#define _AVR_INTERRUPT_H_
+
+// Interrupt vectors are plain functions that hal/Interrupts.cpp calls when
+// an enabled pin changes; sei()/cli() are the Arduino interrupts() calls.
+
+#include <avr/io.h>
+
+void interrupts(void);
+void noInterrupts(void);
+
+#define ISR(vector, ...) extern "C" void vector(void)
+#define sei() interrupts()
+#define cli() noInterrupts()
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef _AVR_IO_H_
+#define _AVR_IO_H_
+
+// The ATmega328P registers the sketch touches. Port input registers read
+// the simulated pins; the pin change registers are plain bytes consulted by
+// hal/Interrupts.cpp whenever a pin changes.
+
+#include <stdint.h>
+
+uint8_t simReadPort(uint8_t port);  // 0 = B (D8..D13), 1 = C (A0..A5), 2 = D (D0..D7)
+
+#define PINB simReadPort(0)
+#define PINC simReadPort(1)
+#define PIND simReadPort(2)
+
+extern volatile uint8_t PCICR;
+extern volatile uint8_t PCIFR;
+extern volatile uint8_t PCMSK0;
+extern volatile uint8_t PCMSK1;
+extern volatile uint8_t PCMSK2;
+
+#define PCIE0 0
+#define PCIE1 1
+#define PCIE2 2
+#define PCIF0 0
+#define PCIF1 1
+#define PCIF2 2
+
+#define PCINT8 0
+#define PCINT9 1
+#define PCINT10 2
+#define PCINT11 3
+#define PCINT12 4
+#define PCINT13 5
+
+#endif
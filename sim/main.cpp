@@ -0,0 +1,155 @@
+// Host entry point: plays the role of the Arduino core's main(), running
+// the sketch's setup() once and loop() until the virtual run time is up,
+// and reports how long each loop() pass took.
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+#include "Peers.h"
+#include "SerialLink.h"
+#include "SimBoard.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace {
+
+volatile sig_atomic_t g_stop = 0;
+
+void onSignal(int) {
+    g_stop = 1;
+}
+
+void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [-t seconds] [-s script] [-e eeprom.bin] [-p] [-r] [-v]\n"
+            "  -t  virtual run time in seconds (default 60)\n"
+            "  -s  scenario script applied on the virtual clock\n"
+            "  -e  EEPROM image loaded at start and saved at exit\n"
+            "  -p  expose the GSM port on a pty instead of the built-in modem\n"
+            "  -r  run in real time (implied by -p)\n"
+            "  -v  trace pin, tone, modem and script activity\n",
+            argv0);
+}
+
+struct LoopStats {
+    uint64_t count = 0;
+    uint64_t total = 0;
+    uint64_t min = UINT64_MAX;
+    uint64_t max = 0;
+    uint64_t maxAt = 0;
+    uint32_t histogram[24] = {0};   // log2 buckets of microseconds
+
+    void add(uint64_t us, uint64_t at) {
+        count++;
+        total += us;
+        if (us < min) min = us;
+        if (us > max) {
+            max = us;
+            maxAt = at;
+        }
+        uint8_t bucket = 0;
+        while ((us >> bucket) > 1 && bucket < 23) bucket++;
+        histogram[bucket]++;
+    }
+
+    void report() const {
+        if (!count) return;
+        sim::log("loop(): %llu passes, min %.3f ms, mean %.3f ms, max %.3f ms (at %.3f s)",
+                 (unsigned long long)count, min / 1000.0, total / 1000.0 / count,
+                 max / 1000.0, maxAt / 1e6);
+        for (uint8_t i = 0; i < 24; i++) {
+            if (!histogram[i]) continue;
+            sim::log("  < %8lu us: %u", 2UL << i, histogram[i]);
+        }
+    }
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    double runSeconds = 60.0;
+    const char* script = nullptr;
+    const char* eepromPath = nullptr;
+    bool usePty = false;
+    bool realtime = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:s:e:prvh")) != -1) {
+        switch (opt) {
+            case 't': runSeconds = atof(optarg); break;
+            case 's': script = optarg; break;
+            case 'e': eepromPath = optarg; break;
+            case 'p': usePty = true; realtime = true; break;
+            case 'r': realtime = true; break;
+            case 'v': sim::setTrace(true); break;
+            default: usage(argv[0]); return opt == 'h' ? 0 : 2;
+        }
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    sim::ConsolePeer console(sim::consoleLink());
+    sim::consoleLink().attach(&console);
+
+    sim::SerialLink* gsmLink = sim::softSerialLink(0);
+    sim::FakeModem* modem = nullptr;
+    sim::PtyPeer* pty = nullptr;
+    if (gsmLink) {
+        if (usePty) {
+            pty = new sim::PtyPeer(*gsmLink);
+            if (!pty->open()) {
+                fprintf(stderr, "cannot open pty\n");
+                return 1;
+            }
+            gsmLink->attach(pty);
+            sim::log("GSM port on %s", pty->slaveName());
+        } else {
+            modem = new sim::FakeModem(*gsmLink);
+            gsmLink->attach(modem);
+        }
+    }
+
+    if (eepromPath && !sim::loadEeprom(eepromPath)) {
+        sim::log("no EEPROM image at %s, starting erased", eepromPath);
+    }
+    if (script && !sim::loadScript(script)) {
+        fprintf(stderr, "cannot read script %s\n", script);
+        return 1;
+    }
+    sim::setRealtime(realtime);
+
+    const uint64_t endUs = (uint64_t)(runSeconds * 1e6);
+    uint64_t start = sim::nowMicros();
+    setup();
+    sim::log("setup() took %.3f ms", (sim::nowMicros() - start) / 1000.0);
+
+    LoopStats stats;
+    while (!g_stop && sim::nowMicros() < endUs) {
+        start = sim::nowMicros();
+        loop();
+        // A scripted stall stands in for a blocking call inside loop()
+        if (uint32_t ms = sim::takeStall()) delay(ms);
+        stats.add(sim::nowMicros() - start, start);
+    }
+    fflush(stdout);
+
+    stats.report();
+    uint32_t hotWrites;
+    uint16_t hotCell = sim::eepromHottestCell(&hotWrites);
+    sim::log("EEPROM: %u byte writes, hottest cell 0x%03X written %u times",
+             sim::eepromWriteCount(), hotCell, hotWrites);
+    if (modem) {
+        sim::log("modem: %u SMS sent, %u calls made", modem->smsSent(), modem->callsMade());
+    }
+    if (eepromPath && !sim::saveEeprom(eepromPath)) {
+        sim::log("cannot save EEPROM image to %s", eepromPath);
+    }
+    delete modem;
+    delete pty;
+    return 0;
+}
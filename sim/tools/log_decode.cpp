@@ -0,0 +1,136 @@
+// Decoder for the binary event log dump (EventLogger::exportLog, "DUMP"
+// on the serial console).
+//
+// Scans a capture of the console output for "GLOG" frames, checks the
+// CRC and prints the records as CSV, oldest first. Text printed around
+// the frame is skipped, so a plain terminal log works as input.
+//
+//   build/log_decode [capture]        (stdin when no file is given)
+//
+// CSV columns: frame, seq, time_s, boot, code, event, count, data.
+// time_s counts from the reset the record was logged after; boot marks
+// the first record after a reset.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+
+// SystemManager::MsgID, in enum order
+const char* const kCodeNames[] = {
+    "FIRE", "INTRUSION", "BAD_IBTN", "HEALTH_FAIL", "KEY_ADD", "KEY_REM",
+    "SMK_MIS", "ARMED", "ARMING", "DISARMED", "READY", "TEMP", "STATUS", "SMK_CAL",
+    "PIR_1", "ENTRY", "KEY_REC", "SMK_RISE"
+};
+const unsigned kCodeCount = sizeof(kCodeNames) / sizeof(kCodeNames[0]);
+
+const size_t kHeaderSize = 16;
+const uint8_t kVersion = 1;
+const uint8_t kErasedSeq = 0xFF;
+
+uint16_t crcUpdate(uint16_t crc, uint8_t data) {
+    // CRC-16/CCITT-FALSE, _crc_xmodem_update() on the board
+    crc ^= (uint16_t)data << 8;
+    for (int i = 0; i < 8; i++) {
+        crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+uint16_t le16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+uint32_t le32(const uint8_t* p) { return le16(p) | ((uint32_t)le16(p + 2) << 16); }
+
+uint32_t decodeDelta(uint8_t delta) {
+    // EventLogger::_decodeDelta()
+    if (!(delta & 0x80)) return delta;
+    if (!(delta & 0x40)) return (delta & 0x3FU) * 60;
+    return (delta & 0x3FU) * 3600;
+}
+
+// Returns the frame size, or 0 if there is no valid frame at data
+size_t decodeFrame(const uint8_t* data, size_t size, unsigned frame) {
+    if (size < kHeaderSize + 2) return 0;
+    uint8_t version = data[4];
+    uint8_t recordSize = data[5];
+    uint16_t count = le16(data + 6);
+    if (version != kVersion || recordSize < 6) {
+        fprintf(stderr, "frame %u: unsupported version %u / record size %u\n",
+                frame, version, recordSize);
+        return 0;
+    }
+    size_t body = kHeaderSize + (size_t)count * recordSize;
+    if (size < body + 2) {
+        fprintf(stderr, "frame %u: truncated (%zu of %zu bytes)\n", frame, size, body + 2);
+        return 0;
+    }
+
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < body; i++) crc = crcUpdate(crc, data[i]);
+    if (crc != le16(data + body)) {
+        fprintf(stderr, "frame %u: CRC mismatch\n", frame);
+        return 0;
+    }
+
+    uint32_t time = le32(data + 8);
+    uint32_t uptime = le32(data + 12);
+    unsigned valid = 0;
+    for (uint16_t r = 0; r < count; r++) {
+        const uint8_t* rec = data + kHeaderSize + (size_t)r * recordSize;
+        uint8_t seq = rec[0];
+        uint8_t code = rec[1];
+        uint8_t flags = rec[3];
+        uint8_t n = flags & 0x7F;
+        if (seq == kErasedSeq || n == 0) continue;
+
+        bool boot = flags & 0x80;
+        time = (boot ? 0 : time) + decodeDelta(rec[2]);
+        int16_t value = (int16_t)le16(rec + 4);
+        if (code < kCodeCount) {
+            printf("%u,%u,%u,%d,%u,%s,%u,%d\n", frame, seq, time, boot, code,
+                   kCodeNames[code], n, value);
+        } else {
+            printf("%u,%u,%u,%d,%u,,%u,%d\n", frame, seq, time, boot, code, n, value);
+        }
+        valid++;
+    }
+    fprintf(stderr, "frame %u: %u records, device uptime %u s\n", frame, valid, uptime);
+    return body + 2;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc > 2 || (argc == 2 && strcmp(argv[1], "-h") == 0)) {
+        fprintf(stderr, "usage: %s [capture]\n", argv[0]);
+        return 2;
+    }
+    FILE* f = argc == 2 ? fopen(argv[1], "rb") : stdin;
+    if (!f) {
+        fprintf(stderr, "%s: cannot open\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<uint8_t> data;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+    if (f != stdin) fclose(f);
+
+    printf("frame,seq,time_s,boot,code,event,count,data\n");
+    unsigned frames = 0;
+    for (size_t i = 0; i + 4 <= data.size(); i++) {
+        if (memcmp(&data[i], "GLOG", 4) != 0) continue;
+        size_t used = decodeFrame(&data[i], data.size() - i, frames + 1);
+        if (used) {
+            frames++;
+            i += used - 1;
+        }
+    }
+    if (!frames) {
+        fprintf(stderr, "no valid log frame found\n");
+        return 1;
+    }
+    return 0;
+}